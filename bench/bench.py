@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+# usage: bench.py [options] <cc1> [-- cc1 options]
+# Compile throughput and scaling of cc1 on the synthetic corpora of corpus.py. Each dimension is doubled from its
+# default value while the others keep theirs, and for every size the best time of a few runs and the peak RSS are
+# measured. The cost is fitted as time = a + b * n^k, n being the number of tokens: the constant part a (the rest of
+# the corpus, the startup of cc1) cancels out of the increments between two sizes, and k is the slope of the
+# increments of time against the increments of n on a log-log scale, by least squares. A dimension whose k is above
+# the threshold costs more per token as it grows, it is reported as superlinear. The same is done for the peak RSS.
+# The long function check does the same on a single function whose statements double up to --function-statements
+# (100k by default): every list of the parser grows with the function, a copy of one of them on each reduction shows
+# there first.
+import argparse
+import math
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import corpus
+
+TOKEN = re.compile(r'[A-Za-z_]\w*|\d+|"(?:[^"\\]|\\.)*"|->|\+\+|--|<<|>>|[<>=!]=|&&|\|\||\S')
+
+# The peak RSS of a process counts the memory it had before exec, a copy of its parent: cc1 is started by a fresh
+# interpreter rather than by this one, which holds the corpora. Peaks under the size of that interpreter (about
+# 10 MB) are not measured.
+LAUNCHER = '''
+import os, sys, time
+start = time.perf_counter()
+pid = os.fork()
+if pid == 0:
+	os.execv(sys.argv[1], sys.argv[1:])
+_, status, usage = os.wait4(pid, 0)
+print(time.perf_counter() - start, usage.ru_maxrss * 1024, os.waitstatus_to_exitcode(status))
+'''
+
+
+def run(cc1, source, options, directory):
+	path = os.path.join(directory, 'input.c')
+	with open(path, 'w') as f:
+		f.write(source)
+	output = subprocess.run([sys.executable, '-c', LAUNCHER, cc1, *options, path, '-o', os.path.join(directory, 'output')],
+							stdout=subprocess.PIPE, check=True).stdout.split()
+	elapsed, rss, status = float(output[-3]), int(output[-2]), int(output[-1])
+	if status:
+		raise RuntimeError('cc1 failed with status %d on %s' % (status, path))
+	return elapsed, rss
+
+
+# exponent k of y = a + b * x^k, the first increment is left out when there are enough: the smallest sizes are
+# dominated by the granularity of the clock and of the allocator
+def exponent(xs, ys):
+	dx = [b - a for a, b in zip(xs, xs[1:])]
+	dy = [b - a for a, b in zip(ys, ys[1:])]
+	if len(dx) > 2:
+		dx, dy = dx[1:], dy[1:]
+	points = [(math.log(x), math.log(y)) for x, y in zip(dx, dy) if x > 0 and y > 0]
+	if len(points) < 2:
+		return None
+	mx = sum(p[0] for p in points) / len(points)
+	my = sum(p[1] for p in points) / len(points)
+	var = sum((p[0] - mx) ** 2 for p in points)
+	return sum((p[0] - mx) * (p[1] - my) for p in points) / var if var else None
+
+
+def main():
+	parser = argparse.ArgumentParser(description='compile throughput and scaling benchmark of cc1')
+	parser.add_argument('cc1')
+	parser.add_argument('options', nargs='*', help='options given to cc1 (after --)')
+	parser.add_argument('--dimensions', default=','.join(corpus.DEFAULTS), help='comma separated dimensions to scale, none if empty')
+	parser.add_argument('--points', type=int, default=5, help='sizes of each dimension, doubling from its default')
+	parser.add_argument('--repeat', type=int, default=3, help='runs of each size, the fastest is kept')
+	parser.add_argument('--threshold', type=float, default=1.15, help='exponent above which a dimension is flagged')
+	parser.add_argument('--strict', action='store_true', help='exit with status 1 when a dimension is flagged')
+	parser.add_argument('--function-statements', type=int, default=100000,
+						help='statements of the largest function of the long function check, 0 to skip it')
+	args = parser.parse_args()
+	if args.points < 3:
+		parser.error('at least 3 points are needed to fit the increments')
+	dimensions = [d for d in args.dimensions.split(',') if d]
+	for dimension in dimensions:
+		if dimension not in corpus.DEFAULTS:
+			parser.error('unknown dimension: ' + dimension)
+
+	cc1 = os.path.abspath(args.cc1)
+	flagged = []
+	with tempfile.TemporaryDirectory() as directory:
+		# prints the measures of each size and the fitted exponents, returns what is above the threshold
+		def measure(name, sizes):
+			print('%10s %10s %10s %10s %12s %12s %10s' % ('value', 'lines', 'tokens', 'time (s)', 'lines/s', 'tokens/s', 'RSS (MB)'))
+			tokens, times, memory = [], [], []
+			for value, params in sizes:
+				source = corpus.generate(**params)
+				lines = source.count('\n')
+				count = len(TOKEN.findall(source))
+				results = [run(cc1, source, args.options, directory) for _ in range(args.repeat)]
+				elapsed = min(r[0] for r in results)
+				rss = max(r[1] for r in results)
+				print('%10d %10d %10d %10.3f %12.0f %12.0f %10.1f' % (value, lines, count, elapsed, lines / elapsed, count / elapsed, rss / 2 ** 20))
+				tokens.append(count)
+				times.append(elapsed)
+				memory.append(rss)
+			verdicts, superlinear = [], []
+			for resource, k in (('time', exponent(tokens, times)), ('memory', exponent(tokens, memory))):
+				if k is None:
+					verdicts.append('%s: no growth' % resource)
+					continue
+				verdicts.append('%s ~ tokens^%.2f' % (resource, k))
+				if k > args.threshold:
+					verdicts[-1] += ' SUPERLINEAR'
+					superlinear.append('%s (%s)' % (name, resource))
+			print('   ' + ', '.join(verdicts))
+			return superlinear
+
+		print('cc1 ' + ' '.join(args.options))
+		for dimension in dimensions:
+			print('\n%s (others: %s)' % (dimension, ', '.join('%s=%d' % (k, v) for k, v in corpus.DEFAULTS.items() if k != dimension)))
+			flagged += measure(dimension, [(corpus.DEFAULTS[dimension] << i, {dimension: corpus.DEFAULTS[dimension] << i}) for i in range(args.points)])
+		if args.function_statements:
+			print('\nlong function (functions=1, statements up to %d)' % args.function_statements)
+			sizes = [args.function_statements >> i for i in reversed(range(args.points))]
+			flagged += measure('long function', [(n, {'functions': 1, 'statements': n}) for n in sizes])
+	if flagged:
+		print('\nsuperlinear: ' + ', '.join(flagged))
+		if args.strict:
+			return 1
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+# usage: corpus.py [--functions N] [--locals M] [--statements T] [--depth D] [--expression E] [--line L] [--strings S] > file.c
+# Synthetic C source for the benchmarks, every dimension can be scaled on its own:
+#   functions   number of function definitions
+#   locals      variables declared and assigned at the top of each function
+#   statements  assignments in each function, one per line
+#   depth       nested blocks in each function, each one declares a variable and reads the enclosing ones
+#   expression  depth of a parenthesized expression in each function
+#   line        statements written on a single line in each function
+#   strings     distinct string literals in each function
+# Only what the compiler supports is generated: declarations at the beginning of the blocks, int and char *.
+import argparse
+import sys
+
+DEFAULTS = {
+	'functions': 50,
+	'locals': 16,
+	'statements': 16,
+	'depth': 8,
+	'expression': 16,
+	'line': 16,
+	'strings': 16,
+}
+
+OPERATORS = ['+', '-', '*'] # the bitwise operators are not supported yet
+
+
+def expression(depth, locals):
+	e = 'v0'
+	for i in range(depth):
+		operand = 'v%d' % (i % locals) if i % 2 else str(i + 1)
+		e = '(%s %s %s)' % (e, OPERATORS[i % len(OPERATORS)], operand)
+	return e
+
+
+def function(index, p):
+	locals = max(p['locals'], 1)
+	out = ['int f%d(int x)' % index, '{']
+	out += ['\tint v%d;' % i for i in range(locals)]
+	if p['strings']:
+		out.append('\tchar *s;')
+	out.append('\tv0 = x;')
+	out += ['\tv%d = v%d + %d;' % (i, i - 1, i) for i in range(1, locals)]
+	out += ['\tv%d = v%d - %d;' % (i % locals, (i + 1) % locals, i) for i in range(p['statements'])]
+
+	indent = '\t'
+	# alternately an if and a while on the variable of the enclosing block, which the while increments at its end
+	for level in range(1, p['depth'] + 1):
+		if level % 2:
+			out.append(indent + 'if (x > %d) {' % level)
+		else:
+			out.append(indent + 'while (n%d < %d) {' % (level - 1, level * 10))
+		indent += '\t'
+		out.append(indent + 'int n%d;' % level)
+		out.append(indent + 'n%d = %s + v0;' % (level, 'n%d' % (level - 1) if level > 1 else 'x'))
+	for level in range(p['depth'], 0, -1):
+		if level > 1 and level % 2 == 0:
+			out.append(indent + 'n%d = n%d + 1;' % (level - 1, level - 1))
+		indent = indent[:-1]
+		out.append(indent + '}')
+
+	out.append('\tv0 = %s;' % expression(p['expression'], locals))
+	out += ['\ts = "f%d string %d";' % (index, i) for i in range(p['strings'])]
+	if p['line']:
+		out.append('\t' + ' '.join('v%d = v%d + %d;' % (i % locals, (i + 1) % locals, i) for i in range(p['line'])))
+	out.append('\treturn v0;')
+	out.append('}')
+	return '\n'.join(out)
+
+
+def generate(**params):
+	p = dict(DEFAULTS)
+	p.update(params)
+	return '\n\n'.join(function(i, p) for i in range(p['functions'])) + '\n'
+
+
+def main():
+	parser = argparse.ArgumentParser(description='generate a synthetic C corpus')
+	for name, value in DEFAULTS.items():
+		parser.add_argument('--' + name, type=int, default=value)
+	args = parser.parse_args()
+	sys.stdout.write(generate(**vars(args)))
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,37 @@
+/* chars computed from ints and passed along with ints: the registers of the temps must have a byte part */
+
+int	mix(char c, int n)
+{
+	return (c + n);
+}
+
+int	twice(int n)
+{
+	return (n * 2);
+}
+
+/* four sums live at once, the last ones get the registers without a byte part unless they are kept out of them */
+int	narrow(int a, int b, int d, int e)
+{
+	char	c;
+
+	c = (a + b) + (d + e);
+	return (c);
+}
+
+int	main(int ac, char **av)
+{
+	int	i;
+	int	total;
+
+	total = 0;
+	i = 0;
+	while (i < 3000000 + ac - 1)
+	{
+		/* the char argument is computed before the call to twice and is still live after it, the chars stay positive */
+		total = total + mix(i % 100 + 1, twice(i)) + narrow(i % 30, ac, i % 30, 3);
+		total = total % 65521;
+		i++;
+	}
+	return (total % 256);
+}
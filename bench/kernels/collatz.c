@@ -0,0 +1,48 @@
+/* division, modulo and unpredictable branches */
+
+int	collatz_steps(unsigned int n)
+{
+	int	steps;
+
+	steps = 0;
+	while (n != 1)
+	{
+		if (n % 2 == 0)
+			n = n / 2;
+		else
+			n = 3 * n + 1;
+		steps++;
+	}
+	return (steps);
+}
+
+/* the loops calling a function are split in blocks: the stack of the caller grows at each call until it returns */
+unsigned int	block(unsigned int first, unsigned int count)
+{
+	unsigned int	n;
+	unsigned int	total;
+
+	total = 0;
+	n = first;
+	while (n < first + count)
+	{
+		total = total + collatz_steps(n);
+		n++;
+	}
+	return (total);
+}
+
+int	main(int ac, char **av)
+{
+	unsigned int	i;
+	unsigned int	total;
+
+	total = 0;
+	i = 0;
+	while (i < 100 + ac - 1)
+	{
+		total = total + block(1 + i * 10000, 10000);
+		i++;
+	}
+	return (total % 256);
+}
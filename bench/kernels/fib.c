@@ -0,0 +1,13 @@
+/* recursive calls: prologues, epilogues and argument passing */
+
+int	fib(int n)
+{
+	if (n < 2)
+		return (n);
+	return (fib(n - 1) + fib(n - 2));
+}
+
+int	main(int ac, char **av)
+{
+	return (fib(37 + ac - 1) % 256);
+}
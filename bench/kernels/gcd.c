@@ -0,0 +1,45 @@
+/* Euclid in a double loop: modulo, swaps of locals and a call per pair */
+
+int	gcd(int a, int b)
+{
+	int	t;
+
+	while (b)
+	{
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return (a);
+}
+
+/* the inner loop is a function of its own: the stack of the caller grows at each call until it returns */
+int	row(int i)
+{
+	int	j;
+	int	total;
+
+	total = 0;
+	j = 1;
+	while (j < i)
+	{
+		total = total + gcd(i, j);
+		j++;
+	}
+	return (total);
+}
+
+int	main(int ac, char **av)
+{
+	int	i;
+	int	total;
+
+	total = 0;
+	i = 1;
+	while (i < 4000 + ac - 1)
+	{
+		total = total + row(i);
+		i++;
+	}
+	return (total % 256);
+}
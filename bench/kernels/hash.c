@@ -0,0 +1,45 @@
+/* djb2 over a string: a pointer walk with a multiply per character */
+
+unsigned int	hash(const char *s)
+{
+	unsigned int	h;
+
+	h = 5381;
+	while (*s)
+	{
+		h = h * 33 + *s;
+		s++;
+	}
+	return (h);
+}
+
+/* the loops calling a function are split in blocks: the stack of the caller grows at each call until it returns */
+unsigned int	block(unsigned int first, unsigned int count)
+{
+	unsigned int	total;
+	unsigned int	i;
+
+	total = 0;
+	i = first;
+	while (i < first + count)
+	{
+		total = total + hash("Sphinx of black quartz, judge my vow. Pack my box with five dozen liquor jugs." + i % 5) + i;
+		i++;
+	}
+	return (total);
+}
+
+int	main(int ac, char **av)
+{
+	unsigned int	total;
+	unsigned int	i;
+
+	total = 0;
+	i = 0;
+	while (i < 200 + ac - 1)
+	{
+		total = total + block(i * 10000, 10000);
+		i++;
+	}
+	return (total % 256);
+}
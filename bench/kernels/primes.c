@@ -0,0 +1,48 @@
+/* nested loops around a modulo: trial division */
+
+int	is_prime(int n)
+{
+	int	d;
+
+	if (n < 2)
+		return (0);
+	d = 2;
+	while (d * d <= n)
+	{
+		if (n % d == 0)
+			return (0);
+		d++;
+	}
+	return (1);
+}
+
+/* the loops calling a function are split in blocks: the stack of the caller grows at each call until it returns */
+int	block(int first, int count)
+{
+	int	n;
+	int	total;
+
+	total = 0;
+	n = first;
+	while (n < first + count)
+	{
+		total = total + is_prime(n);
+		n++;
+	}
+	return (total);
+}
+
+int	main(int ac, char **av)
+{
+	int	i;
+	int	count;
+
+	count = 0;
+	i = 0;
+	while (i < 200 + ac - 1)
+	{
+		count = count + block(i * 10000, 10000);
+		i++;
+	}
+	return (count % 256);
+}
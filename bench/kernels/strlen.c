@@ -0,0 +1,47 @@
+/* ft_strlen of samples/main.c: an indexed load and a compare per character */
+
+typedef unsigned long int size_t;
+
+/* not const: gcc would compute the lengths of the constant string at compile time */
+const char	*text = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. Excepteur sint occaecat cupidatat non proident, sunt in culpa qui officia deserunt.";
+
+size_t	ft_strlen(const char *str)
+{
+	size_t	a;
+
+	a = 0;
+	while (str[a] != '\0')
+		a++;
+	return (a);
+}
+
+/* the loops calling a function are split in blocks: the stack of the caller grows at each call until it returns */
+size_t	block(const char *s, int count)
+{
+	size_t	total;
+	int		i;
+
+	total = 0;
+	i = 0;
+	while (i < count)
+	{
+		total = total + ft_strlen(s + i % 7);
+		i++;
+	}
+	return (total);
+}
+
+int	main(int ac, char **av)
+{
+	size_t	total;
+	int		i;
+
+	total = 0;
+	i = 0;
+	while (i < 200 + ac - 1)
+	{
+		total = total + block(text + i % 5, 10000);
+		i++;
+	}
+	return (total % 256);
+}
@@ -0,0 +1,74 @@
+/* ft_strmapi and rot of samples/main.c: a call through a function pointer per character, which calls factorial */
+
+typedef unsigned long int size_t;
+
+int	factorial(unsigned int n)
+{
+	if (n)
+		return (n * factorial(n - 1));
+	return (1);
+}
+
+int	ft_isalpha(int c)
+{
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'));
+}
+
+char	rot(unsigned int n, char c)
+{
+	if (!ft_isalpha(c))
+		return (c);
+	if (c <= 'Z')
+		return ('A' + ((c - (unsigned int)'A') + factorial(n % 10) + n / 10) % 26);
+	else
+		return ('a' + ((c - (unsigned int)'a') + factorial(n % 10) + n / 10) % 26);
+}
+
+/* the mapped string is summed instead of being written, the kernels have no writable buffer */
+size_t	ft_strmapi_sum(char const *s, char (*f)(unsigned int, char))
+{
+	size_t	i;
+	size_t	sum;
+
+	if (!s || !f)
+		return (0);
+	i = 0;
+	sum = 0;
+	while (s[i])
+	{
+		sum = sum + (*f)(i, s[i]);
+		i++;
+	}
+	return (sum);
+}
+
+/* the loops calling a function are split in blocks: the stack of the caller grows at each call until it returns */
+size_t	block(int first, int count)
+{
+	size_t	total;
+	int		i;
+
+	total = 0;
+	i = first;
+	while (i < first + count)
+	{
+		total = total + ft_strmapi_sum("The quick brown fox jumps over the lazy dog" + i % 5, &rot);
+		i++;
+	}
+	return (total);
+}
+
+int	main(int ac, char **av)
+{
+	size_t	total;
+	int		i;
+
+	total = 0;
+	i = 0;
+	while (i < 40 + ac - 1)
+	{
+		total = total + block(i * 10000, 10000);
+		i++;
+	}
+	return (total % 256);
+}
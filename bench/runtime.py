@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+# usage: runtime.py [options] <cc1> [-- cc1 options]
+# Speed and size of the code generated by cc1 against gcc -m32 at -O0 and -O1, on the kernels of bench/kernels. Each
+# kernel is compiled to an object by each compiler, linked by the same command, and run a few times, the fastest run
+# is kept. The code size is the size of the executable sections of the object. A kernel returns a checksum of its work
+# as its exit status, a different status than the one of gcc -O0 is reported as a miscompilation. The results can be
+# saved and given back to a later run, which prints the change of each kernel since then.
+import argparse
+import glob
+import json
+import math
+import os
+import shlex
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+KERNELS = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'kernels')
+SHF_EXECINSTR = 0x4
+
+
+def code_size(path):
+	with open(path, 'rb') as f:
+		data = f.read()
+	if data[:4] != b'\x7fELF':
+		raise RuntimeError('%s is not an ELF object' % path)
+	if data[4] == 1:
+		shoff, = struct.unpack_from('<I', data, 0x20)
+		shentsize, shnum = struct.unpack_from('<HH', data, 0x2e)
+		section = lambda o: struct.unpack_from('<IIIIII', data, o)
+	else:
+		shoff, = struct.unpack_from('<Q', data, 0x28)
+		shentsize, shnum = struct.unpack_from('<HH', data, 0x3a)
+		section = lambda o: struct.unpack_from('<IIQQQQ', data, o)
+	size = 0
+	for i in range(shnum):
+		_, _, flags, _, _, sh_size = section(shoff + i * shentsize)
+		if flags & SHF_EXECINSTR:
+			size += sh_size
+	return size
+
+
+def run(path, repeat, timeout):
+	best, status = None, None
+	for _ in range(repeat):
+		start = time.perf_counter()
+		try:
+			status = subprocess.run([path], timeout=timeout).returncode
+		except subprocess.TimeoutExpired:
+			return None, 'timeout'
+		elapsed = time.perf_counter() - start
+		best = elapsed if best is None else min(best, elapsed)
+	return best, status
+
+
+def geomean(values):
+	values = [v for v in values if v]
+	return math.exp(sum(math.log(v) for v in values) / len(values)) if values else None
+
+
+def ratio(a, b):
+	return '%8.2f' % (a / b) if a and b else '%8s' % '-'
+
+
+def main():
+	parser = argparse.ArgumentParser(description='runtime benchmark of the code generated by cc1 against gcc')
+	parser.add_argument('cc1')
+	parser.add_argument('options', nargs='*', help='options given to cc1 (after --)')
+	parser.add_argument('--kernels', help='comma separated kernels to run, all of bench/kernels by default')
+	parser.add_argument('--gcc', default='gcc', help='reference compiler')
+	parser.add_argument('--link', default='gcc -m32 -z noexecstack', help='command linking an object, followed by the object, -o and the executable')
+	parser.add_argument('--repeat', type=int, default=3, help='runs of each executable, the fastest is kept')
+	parser.add_argument('--timeout', type=float, default=60, help='seconds after which a run is abandoned')
+	parser.add_argument('--save', help='write the results to this json file')
+	parser.add_argument('--compare', help='print the change since the results saved in this json file')
+	args = parser.parse_args()
+
+	sources = sorted(glob.glob(os.path.join(KERNELS, '*.c')))
+	names = [os.path.splitext(os.path.basename(s))[0] for s in sources]
+	if args.kernels:
+		for name in args.kernels.split(','):
+			if name not in names:
+				parser.error('unknown kernel: ' + name)
+		sources = [s for s, n in zip(sources, names) if n in args.kernels.split(',')]
+	previous = {}
+	if args.compare:
+		with open(args.compare) as f:
+			previous = json.load(f)
+
+	compilers = [
+		('cc1', [os.path.abspath(args.cc1), *args.options, '-c']),
+		('-O0', [args.gcc, '-m32', '-O0', '-c']),
+		('-O1', [args.gcc, '-m32', '-O1', '-c']),
+	]
+	results = {}
+	failed = []
+	with tempfile.TemporaryDirectory() as directory:
+		print('cc1 ' + ' '.join(args.options))
+		print('%-10s %9s %9s %9s %8s %8s %7s %7s %7s' % ('kernel', 'cc1 (s)', '-O0 (s)', '-O1 (s)', '/-O0', '/-O1', 'cc1 B', '-O0 B', '-O1 B'))
+		for source in sources:
+			name = os.path.splitext(os.path.basename(source))[0]
+			times, sizes, statuses = {}, {}, {}
+			for compiler, command in compilers:
+				base = os.path.join(directory, name + compiler)
+				try:
+					subprocess.run([*command, source, '-o', base + '.o'], check=True)
+					subprocess.run([*shlex.split(args.link), base + '.o', '-o', base], check=True)
+				except subprocess.CalledProcessError:
+					times[compiler], sizes[compiler], statuses[compiler] = None, None, 'build failed'
+					continue
+				sizes[compiler] = code_size(base + '.o')
+				times[compiler], statuses[compiler] = run(base, args.repeat, args.timeout)
+			if statuses['cc1'] != statuses['-O0']:
+				failed.append('%s (cc1: %s, gcc: %s)' % (name, statuses['cc1'], statuses['-O0']))
+				times['cc1'] = None
+			results[name] = {'time': times['cc1'], 'size': sizes['cc1'], 'ratio_O0': times['cc1'] and times['-O0'] and times['cc1'] / times['-O0'],
+							 'ratio_O1': times['cc1'] and times['-O1'] and times['cc1'] / times['-O1']}
+			print('%-10s %9s %9s %9s %s %s %7s %7s %7s' % (name, *('%9.3f' % times[c] if times[c] else '-' for c, _ in compilers),
+														   ratio(times['cc1'], times['-O0']), ratio(times['cc1'], times['-O1']),
+														   *(sizes[c] or '-' for c, _ in compilers)))
+	for key, label in (('ratio_O0', '-O0'), ('ratio_O1', '-O1')):
+		mean = geomean(r[key] for r in results.values())
+		if mean:
+			print('geometric mean of cc1 / gcc %s: %.2f' % (label, mean))
+
+	if previous:
+		print('\nsince %s:' % args.compare)
+		print('%-10s %9s %9s' % ('kernel', 'time', 'size'))
+		for name, r in results.items():
+			p = previous.get(name)
+			if not p:
+				continue
+			print('%-10s %9s %9s' % (name, '%+8.1f%%' % (100 * (r['time'] / p['time'] - 1)) if r['time'] and p['time'] else '-',
+									 '%+8.1f%%' % (100 * (r['size'] / p['size'] - 1)) if r['size'] and p['size'] else '-'))
+	if args.save:
+		with open(args.save, 'w') as f:
+			json.dump(results, f, indent=1)
+	if failed:
+		print('\nwrong results: ' + ', '.join(failed))
+		return 1
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
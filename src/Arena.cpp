@@ -0,0 +1,41 @@
+#include "Arena.hpp"
+#include <algorithm>
+
+static constexpr size_t first_block_size = 1 << 16;
+static constexpr size_t max_block_size = 1 << 24;
+
+Arena::Arena() : current(nullptr), end(nullptr), block_size(first_block_size), finalizers(nullptr) {}
+
+Arena::~Arena() {
+	this->clear();
+}
+
+void *Arena::allocate_block(size_t size, size_t alignment) {
+	// blocks double in size so that the number of blocks stays logarithmic in the size of the tree
+	if (!this->blocks.empty())
+		this->block_size = std::min(this->block_size * 2, max_block_size);
+	size_t needed = std::max(this->block_size, size + alignment);
+	this->blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[needed]), needed});
+	this->current = this->blocks.back().data.get();
+	this->end = this->current + needed;
+	return this->allocate(size, alignment);
+}
+
+void Arena::clear() {
+	for (Finalizer *f = this->finalizers; f; f = f->next)
+		f->destroy(f->object);
+	this->finalizers = nullptr;
+	if (this->blocks.empty())
+		return;
+	this->blocks.resize(1);
+	this->block_size = first_block_size;
+	this->current = this->blocks[0].data.get();
+	this->end = this->current + this->blocks[0].size;
+}
+
+size_t Arena::size() const {
+	size_t total = 0;
+	for (auto &block : this->blocks)
+		total += block.size;
+	return total;
+}
@@ -0,0 +1,93 @@
+#ifndef CC1_POC_ARENA_HPP
+#define CC1_POC_ARENA_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator: objects are carved one after the other out of large blocks and are never freed individually,
+// clear() destroys all of them (in reverse order of creation) and releases their memory at once.
+// The destructors of the objects which need one are chained through a small header placed before each of them.
+class Arena {
+private:
+	struct Finalizer {
+		void		(*destroy)(void *);
+		void		*object;
+		Finalizer	*next;
+	};
+
+	struct Block {
+		std::unique_ptr<std::byte[]>	data;
+		size_t							size;
+	};
+
+	std::vector<Block>	blocks;
+	std::byte		*current;
+	std::byte		*end;
+	size_t			block_size;
+	Finalizer		*finalizers;
+
+	void	*allocate_block(size_t size, size_t alignment);
+public:
+	Arena();
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	~Arena();
+
+	void	*allocate(size_t size, size_t alignment)
+	{
+		size_t padding = -reinterpret_cast<uintptr_t>(this->current) & (alignment - 1);
+		if (static_cast<size_t>(this->end - this->current) < padding + size)
+			return this->allocate_block(size, alignment);
+		void *p = this->current + padding;
+		this->current += padding + size;
+		return p;
+	}
+
+	template <typename T, typename... Args>
+	T		*make(Args &&... args)
+	{
+		if constexpr (std::is_trivially_destructible_v<T>)
+			return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		else
+		{
+			auto *finalizer = static_cast<Finalizer *>(this->allocate(sizeof(Finalizer), alignof(Finalizer)));
+			T *object = new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+			*finalizer = {[](void *p) {static_cast<T *>(p)->~T();}, object, this->finalizers};
+			this->finalizers = finalizer;
+			return object;
+		}
+	}
+
+	void	clear(); // destroy every object, the first block is kept for reuse
+	size_t	size() const; // bytes reserved from the system
+};
+
+// Allocator of the standard containers, for their elements to be carved out of an arena as well: deallocate does
+// nothing, the memory is given back when the arena is cleared, so the containers must be destroyed or cleared before.
+template <typename T, Arena &arena>
+struct ArenaAllocator {
+	typedef T	value_type;
+
+	template <typename U>
+	struct rebind {
+		typedef ArenaAllocator<U, arena>	other;
+	};
+
+	ArenaAllocator() = default;
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U, arena> &) {}
+
+	T		*allocate(size_t n) {return static_cast<T *>(arena.allocate(n * sizeof(T), alignof(T)));}
+	void	deallocate(T *, size_t) {}
+
+	template <typename U>
+	bool	operator==(const ArenaAllocator<U, arena> &) const {return true;}
+};
+
+extern Arena astArena; // nodes of the translation unit being parsed, see Ast.hpp
+
+#endif
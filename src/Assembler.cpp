@@ -0,0 +1,447 @@
+#include "Assembler.hpp"
+#include <elf.h>
+#include <cstring>
+
+namespace CodeGeneration
+{
+	// number of a register in the modrm/sib fields, only the registers which exist in 32 bit mode can be encoded
+	static int register_number(Register r)
+	{
+		static const int numbers[] = {
+			0, // a
+			3, // b
+			1, // c
+			2, // d
+			5, // bp
+			4, // sp
+			6, // si
+			7, // di
+		};
+		size_t base = static_cast<int>(r) / 4;
+		size_t size = REGISTER_SIZE(r);
+		if (base >= std::size(numbers) || size == 8 || (size == 1 && base >= 4))
+			throw std::runtime_error(std::string("assembler: register can't be encoded in 32 bit mode: ") + registers_strings[static_cast<int>(r)]);
+		return numbers[base];
+	}
+
+	static size_t operand_size(const Operand &o)
+	{
+		switch (o.type)
+		{
+			case Operand::REGISTER:
+				return REGISTER_SIZE(o.reg);
+			case Operand::INDIRECT:
+				return o.indirection->scale;
+			default:
+				return REG_SIZE;
+		}
+	}
+
+	static bool is_int8(int64_t n)
+	{
+		return n >= INT8_MIN && n <= INT8_MAX;
+	}
+
+	// sign extend an immediate truncated to the size of the operation
+	static int64_t truncate(uint64_t value, size_t size)
+	{
+		switch (size)
+		{
+			case 1:
+				return (int8_t)value;
+			case 2:
+				return (int16_t)value;
+			default:
+				return (int32_t)value;
+		}
+	}
+
+	static std::runtime_error invalid_operands(Opcode opcode)
+	{
+		return std::runtime_error(std::string("assembler: invalid operands for ") + opcodes_strings[static_cast<int>(opcode)]);
+	}
+
+	void Assembler::immediate(uint64_t value, size_t size) {
+		for (size_t i = 0; i < size; i++)
+			this->byte(value >> (i * 8));
+	}
+
+	void Assembler::prefix(size_t size) {
+		if (size == 2)
+			this->byte(0x66); // operand size override
+		else if (size == 8)
+			throw std::runtime_error("assembler: 64 bit operands can't be encoded in 32 bit mode");
+	}
+
+	// 32 bit field holding the address of a label
+	void Assembler::reference(const Operand &label, int32_t addend, uint8_t type) {
+		switch (label.label_type)
+		{
+			case Operand::SYMBOL:
+				this->relocations.push_back({(uint32_t)this->code.size(), type, Relocation::SYMBOL, label.symbol, 0});
+				break;
+			case Operand::CONSTANT:
+				this->relocations.push_back({(uint32_t)this->code.size(), type, Relocation::CONSTANT, nullptr, label.label});
+				break;
+			case Operand::LOCAL:
+				if (type != R_386_PC32)
+					throw std::runtime_error("assembler: the address of a local label can only be used as a jump target");
+				this->fixups.emplace_back(this->code.size(), label.label);
+				break;
+		}
+		this->immediate(addend, 4);
+	}
+
+	// modrm byte (and sib/displacement) for a register or memory operand, reg is the register field or the opcode extension
+	void Assembler::modrm(int reg, const Operand &rm) {
+		if (rm.type == Operand::REGISTER)
+			return this->byte(0xC0 | reg << 3 | register_number(rm.reg));
+		if (rm.type != Operand::INDIRECT)
+			throw std::runtime_error("assembler: expected a register or a memory operand");
+		const Indirection &i = *rm.indirection;
+		int32_t displacement = i.displacement;
+		int index = -1;
+		int scale = 0;
+		if (i.index.type == Operand::IMMEDIATE)
+			displacement += (int32_t)i.index.immediate_value * (int32_t)i.scale;
+		else if (i.index.type == Operand::REGISTER && REGISTER_SIZE(i.index.reg) == PTR_SIZE)
+		{
+			index = register_number(i.index.reg);
+			if (index == 4)
+				throw std::runtime_error("assembler: esp can't be used as an index");
+			while ((1u << scale) < i.scale)
+				scale++;
+			if ((1u << scale) != i.scale || scale > 3)
+				throw std::runtime_error("assembler: invalid scale " + std::to_string(i.scale));
+		}
+		else
+			throw std::runtime_error("assembler: invalid index");
+
+		if (i.base.type == Operand::DIRECT) // absolute address, mod 00 with no base
+		{
+			if (index < 0)
+				this->byte(reg << 3 | 0b101);
+			else
+			{
+				this->byte(reg << 3 | 0b100);
+				this->byte(scale << 6 | index << 3 | 0b101);
+			}
+			return this->reference(i.base, displacement, R_386_32);
+		}
+		if (i.base.type != Operand::REGISTER || REGISTER_SIZE(i.base.reg) != PTR_SIZE)
+			throw std::runtime_error("assembler: invalid base");
+		int base = register_number(i.base.reg);
+		int mod = 0b10;
+		if (displacement == 0 && base != 5) // [ebp] must be encoded with a displacement
+			mod = 0b00;
+		else if (is_int8(displacement))
+			mod = 0b01;
+		if (index < 0 && base != 4)
+			this->byte(mod << 6 | reg << 3 | base);
+		else // a sib byte is needed for an index and for an esp base
+		{
+			this->byte(mod << 6 | reg << 3 | 0b100);
+			this->byte(scale << 6 | (index < 0 ? 0b100 : index) << 3 | base);
+		}
+		if (mod == 0b01)
+			this->byte(displacement);
+		else if (mod == 0b10)
+			this->immediate(displacement, 4);
+	}
+
+	void Assembler::encode_mov(const Operand &dst, const Operand &src) {
+		size_t size = operand_size(dst);
+		if (src.type == Operand::DIRECT) // mov r/m32, OFFSET label
+		{
+			if (dst.type == Operand::REGISTER)
+				this->byte(0xB8 + register_number(dst.reg));
+			else
+			{
+				this->byte(0xC7);
+				this->modrm(0, dst);
+			}
+			return this->reference(src, 0, R_386_32);
+		}
+		this->prefix(size);
+		if (src.type == Operand::IMMEDIATE)
+		{
+			if (dst.type == Operand::REGISTER)
+				this->byte((size == 1 ? 0xB0 : 0xB8) + register_number(dst.reg));
+			else
+			{
+				this->byte(size == 1 ? 0xC6 : 0xC7);
+				this->modrm(0, dst);
+			}
+			return this->immediate(src.immediate_value, std::min<size_t>(size, 4));
+		}
+		if (src.type == Operand::REGISTER)
+		{
+			this->byte(size == 1 ? 0x88 : 0x89);
+			return this->modrm(register_number(src.reg), dst);
+		}
+		if (dst.type == Operand::REGISTER)
+		{
+			this->byte(size == 1 ? 0x8A : 0x8B);
+			return this->modrm(register_number(dst.reg), src);
+		}
+		throw invalid_operands(Opcode::MOV);
+	}
+
+	void Assembler::encode_extend(bool is_signed, const Operand &dst, const Operand &src) {
+		size_t src_size = operand_size(src);
+		if (dst.type != Operand::REGISTER || src.type == Operand::IMMEDIATE || src.type == Operand::DIRECT || src_size > 2)
+			throw invalid_operands(is_signed ? Opcode::MOVSX : Opcode::MOVZX);
+		this->prefix(operand_size(dst));
+		this->byte(0x0F);
+		this->byte((is_signed ? 0xBE : 0xB6) + (src_size == 2));
+		this->modrm(register_number(dst.reg), src);
+	}
+
+	// add, or, and, sub, xor and cmp share their encodings, the extension selects the operation
+	void Assembler::encode_alu(int extension, const Operand &dst, const Operand &src) {
+		size_t size = operand_size(dst);
+		if (src.type == Operand::DIRECT)
+		{
+			this->byte(0x81);
+			this->modrm(extension, dst);
+			return this->reference(src, 0, R_386_32);
+		}
+		this->prefix(size);
+		if (src.type == Operand::IMMEDIATE)
+		{
+			int64_t value = truncate(src.immediate_value, size);
+			if (size == 1 || is_int8(value))
+			{
+				this->byte(size == 1 ? 0x80 : 0x83);
+				this->modrm(extension, dst);
+				return this->byte(value);
+			}
+			this->byte(0x81);
+			this->modrm(extension, dst);
+			return this->immediate(value, size);
+		}
+		if (src.type == Operand::REGISTER)
+		{
+			this->byte(extension << 3 | (size == 1 ? 0 : 1));
+			return this->modrm(register_number(src.reg), dst);
+		}
+		if (dst.type == Operand::REGISTER)
+		{
+			this->byte(extension << 3 | (size == 1 ? 2 : 3));
+			return this->modrm(register_number(dst.reg), src);
+		}
+		throw std::runtime_error("assembler: invalid operands for an arithmetic instruction");
+	}
+
+	// not, neg, mul, imul, div, idiv
+	void Assembler::encode_unary(int extension, const Operand &o) {
+		size_t size = operand_size(o);
+		this->prefix(size);
+		this->byte(size == 1 ? 0xF6 : 0xF7);
+		this->modrm(extension, o);
+	}
+
+	void Assembler::encode_shift(int extension, const Operand &dst, const Operand &src) {
+		size_t size = operand_size(dst);
+		this->prefix(size);
+		if (src.type == Operand::REGISTER && src.reg == CL)
+		{
+			this->byte(size == 1 ? 0xD2 : 0xD3);
+			return this->modrm(extension, dst);
+		}
+		if (src.type == Operand::IMMEDIATE)
+		{
+			this->byte(size == 1 ? 0xC0 : 0xC1);
+			this->modrm(extension, dst);
+			return this->byte(src.immediate_value);
+		}
+		throw std::runtime_error("assembler: the shift count must be an immediate or cl");
+	}
+
+	void Assembler::encode_jump(const MachineInstruction &i) {
+		static const std::map<Opcode, uint8_t> conditions = {
+			{Opcode::JE, 0x4},
+			{Opcode::JNE, 0x5},
+			{Opcode::JG, 0xF},
+			{Opcode::JGE, 0xD},
+			{Opcode::JL, 0xC},
+			{Opcode::JLE, 0xE},
+		};
+		if (i.a.type != Operand::DIRECT)
+		{
+			if (i.opcode != Opcode::JMP)
+				throw invalid_operands(i.opcode);
+			this->byte(0xFF);
+			return this->modrm(4, i.a);
+		}
+		if (i.opcode == Opcode::JMP)
+			this->byte(0xE9);
+		else
+		{
+			this->byte(0x0F);
+			this->byte(0x80 | conditions.at(i.opcode));
+		}
+		this->reference(i.a, -4, R_386_PC32);
+	}
+
+	void Assembler::encode(const MachineInstruction &i) {
+		static const std::map<Opcode, uint8_t> set_conditions = {
+			{Opcode::SETE, 0x4},
+			{Opcode::SETNE, 0x5},
+			{Opcode::SETL, 0xC},
+			{Opcode::SETLE, 0xE},
+			{Opcode::SETG, 0xF},
+			{Opcode::SETGE, 0xD},
+			{Opcode::SETB, 0x2},
+			{Opcode::SETBE, 0x6},
+			{Opcode::SETA, 0x7},
+			{Opcode::SETAE, 0x3},
+		};
+		switch (i.opcode)
+		{
+			case Opcode::LABEL:
+				this->labels[i.a.label] = this->code.size();
+				break;
+			case Opcode::MOV:
+				this->encode_mov(i.a, i.b);
+				break;
+			case Opcode::MOVSX:
+			case Opcode::MOVZX:
+				this->encode_extend(i.opcode == Opcode::MOVSX, i.a, i.b);
+				break;
+			case Opcode::LEA:
+				if (i.a.type != Operand::REGISTER || i.b.type != Operand::INDIRECT)
+					throw invalid_operands(i.opcode);
+				this->prefix(operand_size(i.a));
+				this->byte(0x8D);
+				this->modrm(register_number(i.a.reg), i.b);
+				break;
+			case Opcode::ADD:
+				this->encode_alu(0, i.a, i.b);
+				break;
+			case Opcode::OR:
+				this->encode_alu(1, i.a, i.b);
+				break;
+			case Opcode::AND:
+				this->encode_alu(4, i.a, i.b);
+				break;
+			case Opcode::SUB:
+				this->encode_alu(5, i.a, i.b);
+				break;
+			case Opcode::XOR:
+				this->encode_alu(6, i.a, i.b);
+				break;
+			case Opcode::CMP:
+				this->encode_alu(7, i.a, i.b);
+				break;
+			case Opcode::NOT:
+				this->encode_unary(2, i.a);
+				break;
+			case Opcode::NEG:
+				this->encode_unary(3, i.a);
+				break;
+			case Opcode::MUL:
+				this->encode_unary(4, i.a);
+				break;
+			case Opcode::IMUL:
+				this->encode_unary(5, i.a);
+				break;
+			case Opcode::DIV:
+				this->encode_unary(6, i.a);
+				break;
+			case Opcode::IDIV:
+				this->encode_unary(7, i.a);
+				break;
+			case Opcode::SHL:
+				this->encode_shift(4, i.a, i.b);
+				break;
+			case Opcode::SHR:
+				this->encode_shift(5, i.a, i.b);
+				break;
+			case Opcode::SETE:
+			case Opcode::SETNE:
+			case Opcode::SETL:
+			case Opcode::SETLE:
+			case Opcode::SETG:
+			case Opcode::SETGE:
+			case Opcode::SETB:
+			case Opcode::SETBE:
+			case Opcode::SETA:
+			case Opcode::SETAE:
+				if (operand_size(i.a) != 1)
+					throw invalid_operands(i.opcode);
+				this->byte(0x0F);
+				this->byte(0x90 | set_conditions.at(i.opcode));
+				this->modrm(0, i.a);
+				break;
+			case Opcode::JMP:
+			case Opcode::JE:
+			case Opcode::JNE:
+			case Opcode::JG:
+			case Opcode::JGE:
+			case Opcode::JL:
+			case Opcode::JLE:
+				this->encode_jump(i);
+				break;
+			case Opcode::PUSH:
+				if (i.a.type == Operand::REGISTER && REGISTER_SIZE(i.a.reg) == REG_SIZE)
+					this->byte(0x50 + register_number(i.a.reg));
+				else if (i.a.type == Operand::IMMEDIATE)
+				{
+					this->byte(0x68);
+					this->immediate(i.a.immediate_value, 4);
+				}
+				else if (i.a.type == Operand::DIRECT)
+				{
+					this->byte(0x68);
+					this->reference(i.a, 0, R_386_32);
+				}
+				else if (i.a.type == Operand::INDIRECT && operand_size(i.a) == REG_SIZE)
+				{
+					this->byte(0xFF);
+					this->modrm(6, i.a);
+				}
+				else
+					throw invalid_operands(i.opcode);
+				break;
+			case Opcode::POP:
+				if (i.a.type == Operand::REGISTER && REGISTER_SIZE(i.a.reg) == REG_SIZE)
+					this->byte(0x58 + register_number(i.a.reg));
+				else if (i.a.type == Operand::INDIRECT && operand_size(i.a) == REG_SIZE)
+				{
+					this->byte(0x8F);
+					this->modrm(0, i.a);
+				}
+				else
+					throw invalid_operands(i.opcode);
+				break;
+			case Opcode::CALL:
+				if (i.a.type == Operand::DIRECT)
+				{
+					this->byte(0xE8);
+					this->reference(i.a, -4, R_386_PC32);
+				}
+				else
+				{
+					this->byte(0xFF);
+					this->modrm(2, i.a);
+				}
+				break;
+			case Opcode::RET:
+				this->byte(0xC3);
+				break;
+		}
+	}
+
+	void Assembler::resolve_labels() {
+		for (auto [offset, label] : this->fixups)
+		{
+			auto it = this->labels.find(label);
+			if (it == this->labels.end())
+				throw std::runtime_error("assembler: undefined label .L" + std::to_string(label));
+			int32_t rel = (int32_t)it->second - (int32_t)(offset + 4);
+			memcpy(&this->code[offset], &rel, 4);
+		}
+		this->fixups.clear();
+	}
+}
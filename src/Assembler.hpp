@@ -0,0 +1,37 @@
+#ifndef CC1_POC_ASSEMBLER_HPP
+#define CC1_POC_ASSEMBLER_HPP
+#include "CodeGeneration.hpp"
+#include "ElfWriter.hpp"
+
+namespace CodeGeneration
+{
+	// Encodes the machine instructions of one function into IA-32 machine code.
+	// Jumps to local labels always use a rel32 displacement and are patched by resolve_labels(), references to
+	// symbols and constants are left as relocations relative to the start of the code.
+	class Assembler {
+	private:
+		std::vector<uint8_t>			code;
+		std::vector<Relocation>			relocations;
+		std::map<int, uint32_t>			labels; // label id to offset in code
+		std::vector<std::pair<uint32_t, int>>	fixups; // rel32 fields to patch with the address of a label
+
+		void	byte(uint8_t b) { this->code.push_back(b); }
+		void	immediate(uint64_t value, size_t size);
+		void	prefix(size_t size);
+		void	reference(const Operand &label, int32_t addend, uint8_t type);
+		void	modrm(int reg, const Operand &rm);
+		void	encode_mov(const Operand &dst, const Operand &src);
+		void	encode_extend(bool is_signed, const Operand &dst, const Operand &src);
+		void	encode_alu(int extension, const Operand &dst, const Operand &src);
+		void	encode_unary(int extension, const Operand &);
+		void	encode_shift(int extension, const Operand &dst, const Operand &src);
+		void	encode_jump(const MachineInstruction &);
+	public:
+		void							encode(const MachineInstruction &);
+		void							resolve_labels();
+		const std::vector<uint8_t>		&get_code() const { return this->code; }
+		const std::vector<Relocation>	&get_relocations() const { return this->relocations; }
+	};
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "Ast.hpp"
 #include <iostream>
 #include <queue>
+#include <stack>
 #include <functional>
 
 namespace Ast {
@@ -27,7 +28,7 @@ namespace Ast {
 	}
 
 	Types::TagName parse_struct_or_union_specifier(const StructOrUnionSpecifier &s) {
-		std::string name;
+		Atom name;
 		if (s.tag)
 			name = s.tag.value();
 		else {
@@ -118,9 +119,9 @@ namespace Ast {
  *           int f(int)
  * return: (name, type, parameters)
  */
-	std::tuple<std::optional<std::string>, Types::CType, std::optional<std::list<std::string>>>
+	std::tuple<std::optional<Atom>, Types::CType, std::optional<IdentifierList>>
 	parse_declarator(Types::CType base, const Declarator *declarator) {
-		std::optional<std::list<std::string>> parameters = std::nullopt;
+		std::optional<IdentifierList> parameters = std::nullopt;
 		begin_declarator:
 		for (auto &p: declarator->pointer)
 			base = {
@@ -131,12 +132,12 @@ namespace Ast {
 
 		const auto *dd = &declarator->directDeclarator;
 		while (1) {
-			if (holds_alternative<std::string>(*dd))
-				return {get<std::string>(*dd), base, parameters};
+			if (holds_alternative<Atom>(*dd))
+				return {get<Atom>(*dd), base, parameters};
 			else if (holds_alternative<std::monostate>(*dd))
 				return {std::nullopt, base, parameters};
 			else if (holds_alternative<NestedDeclarator>(*dd)) {
-				declarator = get<NestedDeclarator>(*dd).get();
+				declarator = get<NestedDeclarator>(*dd);
 				goto begin_declarator;
 			} else if (holds_alternative<ArrayDeclarator>(*dd)) {
 				base = {
@@ -149,7 +150,7 @@ namespace Ast {
 				{
 					get<Types::Array>(base.type).size = (get<uintmax_t>(get<ArrayDeclarator>(*dd).constantExpression.value().constant.value()->value));
 				}
-				dd = get<ArrayDeclarator>(*dd).directDeclarator.get();
+				dd = get<ArrayDeclarator>(*dd).directDeclarator;
 			} else if (holds_alternative<FunctionDeclarator>(*dd)) {
 				auto &functionDeclarator = get<FunctionDeclarator>(*dd);
 
@@ -167,7 +168,7 @@ namespace Ast {
 						if (p.declarator)
 						{
 							SymbolTable::Ordinary base = parse_declaration_specifier_list(p.declarationSpecifierList);
-							auto [name, type, _] = parse_declarator(base.type, p.declarator.value().get());
+							auto [name, type, _] = parse_declarator(base.type, p.declarator.value());
 							functionType.parameters.emplace_back(type);
 							if (name) {
 								parameters->push_back(name.value());
@@ -185,7 +186,7 @@ namespace Ast {
 						functionType,
 						TypeQualifier::NONE
 				};
-				dd = functionDeclarator.directDeclarator.get();
+				dd = functionDeclarator.directDeclarator;
 			}
 		}
 	}
@@ -232,7 +233,7 @@ namespace Ast {
 			return base.type;
 	}
 
-	void init(const std::string &name, const Types::CType &type, const Ast::Initializer &init)
+	void init(Atom name, const Types::CType &type, const Ast::Initializer &init)
 	{
 		auto *o = symbolTable.retrieve_ordinary(name);
 
@@ -254,7 +255,7 @@ namespace Ast {
 			assert(0); // todo
 
 		Expression::DeduceType(n);
-		Expression::Node tmp{Expression::ASSIGNMENT, {{Expression::IDENTIFIER, {}, std::nullopt, std::nullopt, name, o->type, o}, n}};
+		Expression::Node tmp{Expression::ASSIGNMENT, Expression::make_operands(Expression::Node{Expression::IDENTIFIER, {}, std::nullopt, std::nullopt, name, o->type, o}, std::move(n))};
 
 		tmp.type = tmp.operands[0].type.value();
 
@@ -302,29 +303,34 @@ namespace Ast {
 	}
 
 	void Declare(const Declaration &declaration) {
-		SymbolTable::Ordinary base = parse_declaration_specifier_list(declaration.specifiers);
 		if (!declaration.init)
+		{
+			parse_declaration_specifier_list(declaration.specifiers);
 			return;
-		for (const auto &dcl: declaration.init.value()) {
-			auto [name, type, _] = parse_declarator(base.type, &dcl.declarator);
-			assert(!holds_alternative<Types::PlainType>(type.type) || get<Types::PlainType>(type.type).base != Types::PlainType::VOID);
-			if (name) {
-				if (!symbolTable.insert_ordinary(name.value(), {base.storage, type, name.value()}))
-					std::cout << "duplicate symbol: " << name.value() << std::endl;
-			}
-			if (dcl.initializer)
-			{
-				init(name.value(), type, dcl.initializer.value());
-			}
-			// todo duplicate
 		}
+		for (const auto &dcl: declaration.init.value())
+			Declare(declaration.specifiers, dcl);
+	}
+	void Declare(const DeclarationSpecifierList &specifiers, const InitDeclarator &dcl) {
+		SymbolTable::Ordinary base = parse_declaration_specifier_list(specifiers);
+		auto [name, type, _] = parse_declarator(base.type, &dcl.declarator);
+		assert(!holds_alternative<Types::PlainType>(type.type) || get<Types::PlainType>(type.type).base != Types::PlainType::VOID);
+		if (name) {
+			if (!symbolTable.insert_ordinary(name.value(), {base.storage, type, name.value()}))
+				std::cout << "duplicate symbol: " << name.value() << std::endl;
+		}
+		if (dcl.initializer)
+		{
+			init(name.value(), type, dcl.initializer.value());
+		}
+		// todo duplicate
 	}
-	void Declare(std::list<Declaration> &declaration) {
+	void Declare(DeclarationList &declaration) {
 		for (auto &d : declaration)
 			Declare(d);
 	}
 
-	std::string DeclareFunction(const FunctionDefinitionDeclaration &declaration) {
+	Atom DeclareFunction(const FunctionDefinitionDeclaration &declaration) {
 		Declaration tmp = {
 				declaration.declarationSpecifierList.value_or(
 						Ast::DeclarationSpecifierList {Ast::DeclarationSpecifier{Ast::TypeSpecifier{Ast::TypeSpecifier::INT}}}
@@ -337,7 +343,7 @@ namespace Ast {
 		// todo: check if type is a function
 		// todo: check if identifier_list and
 		assert(param_names);
-		assert(std::set<std::string>(param_names->begin(), param_names->end()).size() == param_names->size()); // duplicates params todo
+		assert(std::set<Atom>(param_names->begin(), param_names->end()).size() == param_names->size()); // duplicates params todo
 		if (!param_names->empty() && get<Types::FunctionType>(type.type).parameters.empty()) // identifier list
 		{
 			for (auto &n : param_names.value())
@@ -9,31 +9,38 @@
 #include <ranges>
 #include "SymbolTable.hpp"
 #include "Expression.hpp"
+#include "Arena.hpp"
 
+// Nodes which are referenced by other nodes (statements, nested declarators, ...) are allocated in astArena and linked
+// by plain pointers: the parser copies its semantic values freely, and all the nodes of the translation unit are
+// released together when the arena is cleared. The lists of the tree are carved out of it too.
 namespace Ast {
 
-	typedef std::vector<Expression::Node> ExpressionList;
+	template <typename T>
+	using List = std::list<T, ArenaAllocator<T, astArena>>;
+
+	typedef Expression::NodeVector ExpressionList;
 
 	typedef Expression::Node ConstantExpression;
 	struct StructDeclaration;
-	typedef std::list<std::shared_ptr<StructDeclaration>> StructDeclarationList;
+	typedef List<StructDeclaration *> StructDeclarationList;
 	enum StructOrUnion {
 		STRUCT,
 		UNION
 	};
 	struct StructOrUnionSpecifier {
 		StructOrUnion type;
-		std::optional<std::string> tag;
+		std::optional<Atom> tag;
 		std::optional<StructDeclarationList> declaration;
 	};
 
 	struct Enumerator {
-		std::string name;
+		Atom name;
 		std::optional<int> value;
 	};
-	typedef std::list<Enumerator> EnumeratorList;
+	typedef List<Enumerator> EnumeratorList;
 	struct EnumSpecifier {
-		std::optional<std::string> tag;
+		std::optional<Atom> tag;
 		std::optional<EnumeratorList> declaration;
 	};
 
@@ -54,29 +61,29 @@ namespace Ast {
 			Size
 		};
 		Type type;
-		std::variant<std::monostate, StructOrUnionSpecifier, EnumSpecifier, std::string> value;
+		std::variant<std::monostate, StructOrUnionSpecifier, EnumSpecifier, Atom> value;
 	};
 	typedef Types::CType::TypeQualifier TypeQualifier;
 	typedef SymbolTable::Ordinary::Storage StorageSpecifier;
 	typedef std::variant<StorageSpecifier, TypeSpecifier, TypeQualifier> DeclarationSpecifier;
-	typedef std::list<DeclarationSpecifier> DeclarationSpecifierList;
+	typedef List<DeclarationSpecifier> DeclarationSpecifierList;
 	typedef std::optional<DeclarationSpecifierList> DeclarationSpecifierListOpt;
 
 	// each element in the list represent a pointer with an optional qualifier
-	typedef std::list<std::optional<TypeQualifier>> Pointer;
+	typedef List<std::optional<TypeQualifier>> Pointer;
 
 	struct Declarator;
-	typedef std::shared_ptr<Declarator> NestedDeclarator;
+	typedef Declarator *NestedDeclarator;
 
 	struct FunctionDeclarator;
 	struct ArrayDeclarator {
-		std::shared_ptr<std::variant<
+		std::variant<
 		std::monostate,
-				std::string,
+				Atom,
 				NestedDeclarator,
 				ArrayDeclarator,
 				FunctionDeclarator
-		> > directDeclarator; // we cant forward declare that
+		> *directDeclarator; // we cant forward declare that
 		std::optional<ConstantExpression> constantExpression;
 	};
 
@@ -84,23 +91,23 @@ namespace Ast {
 		DeclarationSpecifierList		declarationSpecifierList;
 		std::optional<NestedDeclarator>	declarator;
 	};
-	typedef std::list<ParameterDeclaration> ParameterList;
+	typedef List<ParameterDeclaration> ParameterList;
 
 	struct ParameterTypeList {
 		ParameterList parameterList;
 		bool ellipsis;
 	};
 
-	typedef std::list<std::string> IdentifierList;
+	typedef List<Atom> IdentifierList;
 
 	struct FunctionDeclarator {
-		std::shared_ptr<std::variant<
+		std::variant<
 		std::monostate,
-				std::string,
+				Atom,
 				NestedDeclarator,
 				ArrayDeclarator,
 				FunctionDeclarator
-		> > directDeclarator; // we cant forward declare that
+		> *directDeclarator; // we cant forward declare that
 		std::variant<
 				std::monostate,
 				ParameterTypeList,
@@ -110,12 +117,12 @@ namespace Ast {
 
 	typedef std::variant<
 		std::monostate,
-		std::string,
+		Atom,
 		NestedDeclarator,
 		ArrayDeclarator,
 		FunctionDeclarator
 	> DirectDeclarator;
-	typedef std::shared_ptr<DirectDeclarator> DirectDeclaratorPointer;
+	typedef DirectDeclarator *DirectDeclaratorPointer;
 
 	struct Declarator {
 		Pointer				pointer;
@@ -131,7 +138,7 @@ namespace Ast {
 		std::optional<Declarator>			declarator;
 		std::optional<ConstantExpression>	bitfield;
 	};
-	typedef std::list<StructDeclarator> StructDeclaratorList;
+	typedef List<StructDeclarator> StructDeclaratorList;
 
 	struct StructDeclaration {
 		DeclarationSpecifierList	declarationSpecifierList;
@@ -141,34 +148,34 @@ namespace Ast {
 	struct Initializer {
 		std::variant<
 				Expression::Node,
-				std::list<Initializer>
+				List<Initializer>
 					> value;
 	};
 
-	typedef std::list<Initializer> InitializerList;
+	typedef List<Initializer> InitializerList;
 
 	struct InitDeclarator {
 		Declarator declarator;
 		std::optional<Initializer> initializer;
 	};
 
-	typedef std::list<InitDeclarator> InitDeclaratorList;
+	typedef List<InitDeclarator> InitDeclaratorList;
 
 	struct Declaration {
 		DeclarationSpecifierList			specifiers;
 		std::optional<InitDeclaratorList>	init;
 	};
-	typedef std::list<Declaration> DeclarationList;
+	typedef List<Declaration> DeclarationList;
 
 	struct Statement;
-	typedef std::shared_ptr<Statement> StatementPtr;
-	typedef std::list<Statement> StatementList;
+	typedef Statement *StatementPtr;
+	typedef List<Statement> StatementList;
 
 	struct LabeledStatement {
 		std::variant <
 		        std::monostate, // default
 				ConstantExpression, // case
-				std::string // label
+				Atom // label
 		        > name;
 		StatementPtr statement;
 	};
@@ -215,7 +222,7 @@ namespace Ast {
 		} type;
 		std::variant<
 			std::monostate,
-			std::string,
+			Atom,
 			Expression::Node
 			> value;
 	};
@@ -245,7 +252,7 @@ namespace Ast {
 
 	typedef std::variant<FunctionDefinition, Declaration> ExternalDeclaration;
 
-	typedef std::list<ExternalDeclaration> TranslationUnit;
+	typedef List<ExternalDeclaration> TranslationUnit;
 
 	Types::StructOrUnion parse_struct_declaration_list(const StructDeclarationList & l);
 
@@ -291,7 +298,7 @@ namespace Ast {
 
 		if (array[TypeSpecifier::TYPE_NAME])
 		{
-			const auto &s = std::get<std::string>((*std::find_if(type_specifier_range.begin(), type_specifier_range.end(), [](const TypeSpecifier &typeSpecifier) -> bool {return typeSpecifier.type == TypeSpecifier::TYPE_NAME;})).value);
+			const auto &s = std::get<Atom>((*std::find_if(type_specifier_range.begin(), type_specifier_range.end(), [](const TypeSpecifier &typeSpecifier) -> bool {return typeSpecifier.type == TypeSpecifier::TYPE_NAME;})).value);
 			ret = symbolTable.retrieve_ordinary(s)->type;
 		}
 		else if (array[TypeSpecifier::STRUCT_OR_UNION])
@@ -344,13 +351,14 @@ namespace Ast {
 
 //	int						evaluate_constant_expression(const ConstantExpression &ce);
 
-	std::tuple<std::optional<std::string>, Types::CType, std::optional<std::list<std::string>>>	parse_declarator(Types::CType base, const Declarator *declarator);
+	std::tuple<std::optional<Atom>, Types::CType, std::optional<IdentifierList>>	parse_declarator(Types::CType base, const Declarator *declarator);
 
 	Types::CType			parse_type_name(const TypeName &);
 
 	void					Declare(const Declaration &declaration);
-	void					Declare(std::list<Declaration> &declaration);
-	std::string				DeclareFunction(const FunctionDefinitionDeclaration &function);
+	void					Declare(const DeclarationSpecifierList &specifiers, const InitDeclarator &declarator); // one declarator, in place
+	void					Declare(DeclarationList &declaration);
+	Atom					DeclareFunction(const FunctionDefinitionDeclaration &function);
 }
 
 extern Ast::TranslationUnit tree;
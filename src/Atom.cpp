@@ -0,0 +1,55 @@
+#include "Atom.hpp"
+#include "MemoryReport.hpp"
+
+// FNV-1a
+static size_t	hash_name(std::string_view name)
+{
+	size_t h = 0xcbf29ce484222325;
+	for (unsigned char c : name)
+	{
+		h ^= c;
+		h *= 0x100000001b3;
+	}
+	return h;
+}
+
+AtomTable::AtomTable() : names{""}, hashes{hash_name("")}, slots(1024, 0) {}
+
+void AtomTable::grow() {
+	std::vector<uint32_t> slots(this->slots.size() * 2, 0);
+	size_t mask = slots.size() - 1;
+	for (uint32_t id = 1; id < this->names.size(); id++)
+	{
+		size_t i = this->hashes[id] & mask;
+		while (slots[i])
+			i = (i + 1) & mask;
+		slots[i] = id;
+	}
+	this->slots = std::move(slots);
+}
+
+uint32_t AtomTable::intern(std::string_view name) {
+	if (name.empty())
+		return 0;
+	size_t h = hash_name(name);
+	size_t mask = this->slots.size() - 1;
+	size_t i = h & mask;
+	for (; this->slots[i]; i = (i + 1) & mask)
+		if (this->hashes[this->slots[i]] == h && this->names[this->slots[i]] == name)
+			return this->slots[i];
+	MemoryReport::Scope memory(MemoryReport::ATOMS);
+	uint32_t id = this->names.size();
+	this->names.emplace_back(name);
+	this->hashes.push_back(h);
+	this->slots[i] = id;
+	if (this->names.size() * 2 > this->slots.size()) // keep the load factor under 1/2
+		this->grow();
+	return id;
+}
+
+std::ostream	&operator<<(std::ostream &os, Atom a)
+{
+	return os << a.str();
+}
+
+AtomTable	atomTable;
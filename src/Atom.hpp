@@ -0,0 +1,56 @@
+#ifndef CC1_POC_ATOM_HPP
+#define CC1_POC_ATOM_HPP
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <ostream>
+#include <cstdint>
+
+// Identifier interned in the global atom table: two atoms are equal if and only if their names are, so atoms are
+// compared and hashed as integers. The name of an atom is stored once and its address never changes.
+class Atom {
+private:
+	uint32_t	id;
+public:
+	Atom() : id(0) {} // empty name
+	Atom(std::string_view name);
+	Atom(const std::string &name) : Atom(std::string_view(name)) {}
+	Atom(const char *name) : Atom(std::string_view(name)) {}
+
+	uint32_t			get_id() const { return this->id; }
+	const std::string	&str() const;
+	bool				empty() const { return this->id == 0; }
+
+	friend bool operator==(Atom a, Atom b) { return a.id == b.id; }
+	friend auto operator<=>(Atom a, Atom b) { return a.id <=> b.id; } // order of interning, not alphabetical
+};
+
+std::ostream	&operator<<(std::ostream &, Atom);
+
+template <>
+struct std::hash<Atom> {
+	size_t operator()(Atom a) const { return a.get_id(); }
+};
+
+class AtomTable {
+private:
+	std::deque<std::string>	names; // by id
+	std::vector<size_t>		hashes; // by id, so that growing the table doesn't hash the names again
+	std::vector<uint32_t>	slots; // open addressing, id of the atom in each slot, 0 if empty
+
+	void	grow();
+public:
+	AtomTable();
+
+	uint32_t			intern(std::string_view name);
+	const std::string	&get_name(uint32_t id) const { return this->names[id]; }
+	size_t				size() const { return this->names.size(); }
+};
+
+extern AtomTable	atomTable;
+
+inline Atom::Atom(std::string_view name) : id(atomTable.intern(name)) {}
+inline const std::string &Atom::str() const { return atomTable.get_name(this->id); }
+
+#endif
@@ -1,4 +1,18 @@
 #include "CodeGeneration.hpp"
+#include "CommandLine.hpp"
+#include "Assembler.hpp"
+#include "CompilationCache.hpp"
+#include "TimeReport.hpp"
+#include "MemoryReport.hpp"
+#include <charconv>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+extern std::shared_ptr<CommandLine>	commandLine;
 
 namespace CodeGeneration
 {
@@ -7,122 +21,118 @@ namespace CodeGeneration
 		return BASE_REG(l) < BASE_REG(r);
 	}
 
-	FunctionGenerator::FunctionGenerator(const SymbolTable::Function &f, FileGenerator &fg) : function(f), gen(fg), frame_size(0), allocated_registers(&compare_reg), available_registers(&compare_reg) {}
+	FunctionGenerator::FunctionGenerator(const SymbolTable::Function &f, FileGenerator &fg, int first_label) : function(f), gen(fg), first_label(first_label), frame_size(0) {}
 	using enum Register;
 
-	std::string FunctionGenerator::indirection_to_string(const Indirection &i) {
-		if	((i.base.type != Operand::REGISTER && i.base.type != Operand::DIRECT) ||
-			(i.index.type != Operand::IMMEDIATE && i.index.type != Operand::REGISTER))
-			throw std::runtime_error("shouldn't be reached");
-		return "[" + operand_to_string(i.base, true) + "+" + operand_to_string(i.index, true) + "*" + std::to_string(i.scale) + "+" + std::to_string(i.displacement) + "]";
+	template <typename T>
+	static void	render_number(std::string &out, T n)
+	{
+		char buf[24];
+		out.append(buf, std::to_chars(buf, buf + sizeof(buf), n).ptr);
 	}
 
-	std::string FunctionGenerator::operand_to_string(const Operand &a, bool is_sub_operand = false) { // todo: bof bof
+	static void	render_operand(std::string &out, const Operand &a, bool is_sub_operand = false)
+	{
 		switch (a.type)
 		{
 			case Operand::REGISTER:
-				return registers_strings[static_cast<int>(a.reg)];
+				out += registers_strings[static_cast<int>(a.reg)];
+				break;
 			case Operand::INDIRECT: {
-				if ((a.indirection->base.type != Operand::REGISTER && a.indirection->base.type != Operand::DIRECT) ||
-					(a.indirection->index.type != Operand::IMMEDIATE &&
-							a.indirection->index.type != Operand::REGISTER))
+				const Indirection &i = *a.indirection;
+				if ((i.base.type != Operand::REGISTER && i.base.type != Operand::DIRECT) ||
+					(i.index.type != Operand::IMMEDIATE && i.index.type != Operand::REGISTER))
 					throw std::runtime_error("shouldn't be reached");
-				return operand_size_str[a.indirection->scale] + " PTR " + indirection_to_string(*a.indirection);
+				out += operand_size_str[i.scale];
+				out += " PTR [";
+				render_operand(out, i.base, true);
+				out += '+';
+				render_operand(out, i.index, true);
+				out += '*';
+				render_number(out, i.scale);
+				out += '+';
+				render_number(out, i.displacement);
+				out += ']';
+				break;
 			}
 			case Operand::DIRECT:
-				if (is_sub_operand)
-					return a.label;
-				else
-					return "OFFSET " + a.label;
+				if (!is_sub_operand)
+					out += "OFFSET ";
+				switch (a.label_type)
+				{
+					case Operand::SYMBOL:
+						out += *a.symbol;
+						break;
+					case Operand::LOCAL:
+						out += ".L";
+						render_number(out, a.label);
+						break;
+					case Operand::CONSTANT:
+						out += ".LC";
+						render_number(out, a.label);
+						break;
+				}
+				break;
 			case Operand::IMMEDIATE:
-				return std::to_string(a.immediate_value);
+				render_number(out, a.immediate_value);
+				break;
 			default:
 				throw std::runtime_error("shouldn't be reached");
 		}
 	}
 
-	void FunctionGenerator::put_instruction(const char *opcode, const Operand &a = {}, const Operand &b = {})
-	{
-		std::string line;
-		line += std::string(opcode) + " ";
-		if (a.type)
-			line += operand_to_string(a);
-		if (b.type)
-			line += ", " + operand_to_string(b);
-		this->gen.put(line);
-	}
-
-	void FunctionGenerator::init_registers() {
-		const auto registers = {
-				EDI,
-				ESI,
-				ECX,
-				EDX,
-		};
-//		this->available_registers = decltype(this->available_registers)(registers.begin(), registers.end(), &compare_reg);
+	// serialize the machine instructions of the function, this is the only place where text is produced
+	void FunctionGenerator::render(std::string &out) const {
+		auto end = this->instruction_to_asm.begin();
+		for (size_t j = 0; j <= this->code.size(); j++)
+		{
+			for (; end != this->instruction_to_asm.end() && *end == j; end++)
+				out += '\n';
+			if (j == this->code.size())
+				break;
+			const MachineInstruction &i = this->code[j];
+			if (i.opcode == Opcode::LABEL)
+			{
+				render_operand(out, i.a, true);
+				out += ":\n";
+				continue;
+			}
+			out += opcodes_strings[static_cast<int>(i.opcode)];
+			out += ' ';
+			if (i.a.type)
+				render_operand(out, i.a);
+			if (i.b.type)
+			{
+				out += ", ";
+				render_operand(out, i.b);
+			}
+			out += '\n';
+		}
 	}
 
-	void FunctionGenerator::spill(const CodeGeneration::Register &r) {
-//		printf("spill\n");
-		auto it = this->allocated_registers.find(r);
-		if (it == this->allocated_registers.end())
-			return;
-		this->put_instruction("push", r);
-		this->frame_size += 8;
-		this->map_variables[it->second] = Operand(new Indirection{GET_SUB_REG(RBP, REG_SIZE), 0, 8, -(ssize_t)this->frame_size});
-		this->allocated_registers.erase(r);
+	void FunctionGenerator::put_instruction(Opcode opcode, const Operand &a, const Operand &b)
+	{
+		this->code.push_back({opcode, a, b});
 	}
 
-	Register FunctionGenerator::alloc_register(const std::optional<Register> &reg) {
-		Register ret;
-		if (reg)
-		{
-			if (this->allocated_registers.contains(reg.value()))
-				this->spill(reg.value());
-			ret = reg.value();
-		}
-		else {
-			if (available_registers.empty())
-				throw std::runtime_error("no registers available");
-			ret = *available_registers.begin();
-		}
-		available_registers.erase(ret);
-		return ret;
+	void FunctionGenerator::put_label(int label)
+	{
+		this->code.push_back({Opcode::LABEL, Operand(Operand::LOCAL, label)});
 	}
 
-	void FunctionGenerator::free_register(Register r) {
-		available_registers.insert(r);
+	// map a tac label id to a file label id, in the order of their first use
+	int FunctionGenerator::get_label(const TAC::Label &l)
+	{
+		auto [it, inserted] = this->map_labels.insert({l, 0});
+		if (inserted)
+			it->second = this->first_label + this->map_labels.size() - 1;
+		return it->second;
 	}
 
+	// slot in the frame, below the saved registers
 	Operand FunctionGenerator::alloc_temporary(size_t size) {
-		Operand mapping;
-		try { // map on register
-			Register r = GET_SUB_REG(alloc_register(), size);
-//			printf("size: %zu %s\n", size, registers_strings[int(r)]);
-			mapping.type = Operand::REGISTER;
-			mapping.reg = r;
-		}
-		catch (std::exception&) // no more registers, map on stack
-		{
-//			this->put_instruction("push", 0); todo
-			mapping.type = Operand::INDIRECT;
-			this->frame_size += size;
-			auto *i = new Indirection {GET_SUB_REG(RBP, REG_SIZE), 0, size, -(ssize_t)this->frame_size};
-//			this->frame_size += PTR_SIZE;
-			mapping.indirection = std::shared_ptr<Indirection>(i);
-		}
-		return mapping;
-	}
-
-	Operand FunctionGenerator::temp_to_operand(int temp) {
-		if (holds_alternative<Types::FunctionType>(this->function.tac->temps[temp].type))
-			return alloc_temporary(PTR_SIZE); // todo
-		else
-		{
-			auto ret = alloc_temporary(symbolTable.size_of(this->function.tac->temps[temp]));
-			ret.is_signed = Types::is_signed(this->function.tac->temps[temp]);
-			return ret;
-		}
+		this->frame_size += size;
+		return Operand(new Indirection{GET_SUB_REG(RBP, REG_SIZE), 0, size, -(ssize_t)this->frame_size});
 	}
 
 	Operand FunctionGenerator::address_to_operand(const TAC::Address &addr) {
@@ -131,10 +141,8 @@ namespace CodeGeneration
 		{
 			default:
 			case 0:
+			case 1: // the temps are mapped before the translation
 				throw std::runtime_error("code generator: invalid operand");
-			case 1:
-				ret = temp_to_operand(get<int>(addr));
-				break;
 			case 2:
 			{
 				auto &o = get<SymbolTable::Ordinary *>(addr);
@@ -142,7 +150,7 @@ namespace CodeGeneration
 					ret = Operand(new Indirection{GET_SUB_REG(RBP, REG_SIZE), 0, symbolTable.size_of(o->type), -o->offset},
 								  Types::is_signed(o->type));
 				else
-					ret = Operand(new Indirection{o->name, 0, symbolTable.size_of(o->type), 0}, Types::is_signed(o->type));
+					ret = Operand(new Indirection{Operand(&o->name.str()), 0, symbolTable.size_of(o->type), 0}, Types::is_signed(o->type));
 			}
 				break;
 			case 3:
@@ -150,31 +158,27 @@ namespace CodeGeneration
 				const auto &constant = get<const SymbolTable::Constant *>(addr);
 				switch (constant->value.index()) {
 					case 0:
-						ret = {".LC" + std::to_string(constant->id), Types::is_signed(constant->type)};
+						ret = {Operand::CONSTANT, constant->id, Types::is_signed(constant->type)};
 				break;
 					case 1:
 						ret = {get<uintmax_t>(constant->value), Types::is_signed(constant->type)};
 				break;
 					case 2:
-						ret = {".LC" + std::to_string(constant->id), Types::is_signed(constant->type)};
+						ret = {Operand::CONSTANT, constant->id, Types::is_signed(constant->type)};
 					break;
 				}
 				break;
 			}
 			case 4:
-				if (!map_labels.contains(get<4>(addr)))
-					map_labels[get<4>(addr)] = gen.get_label();
-				ret = {".L" + std::to_string(map_labels[get<4>(addr)])};
+				ret = {Operand::LOCAL, this->get_label(get<4>(addr))};
 				break;
 			case 5:
 				Types::CType type = symbolTable.retrieve_ordinary(get<5>(addr))->type;
 //				symbolTable.sym
-				ret = Operand(new Indirection{get<5>(addr), 0, symbolTable.size_of(type), 0}, Types::is_signed(type));
+				ret = Operand(new Indirection{Operand(&get<5>(addr).str()), 0, symbolTable.size_of(type), 0}, Types::is_signed(type));
 //				ret = {"OFFSET " + get<5>(addr)};
 				break;
 		}
-		if (ret.type == Operand::REGISTER)
-			this->allocated_registers.insert({ret.reg, addr});
 		return ret;
 	}
 
@@ -189,17 +193,6 @@ namespace CodeGeneration
 		return add_mapping(addr, address_to_operand(addr))->second;
 	}
 
-	void FunctionGenerator::free_temp(int temp) {
-		if (auto it = this->map_variables.find(temp); it != this->map_variables.end())
-		{
-			if (it->second.type == Operand::REGISTER)
-				this->free_register(it->second.reg);
-			else
-				;//todo
-			this->map_variables.erase(temp);
-		}
-	}
-
 	void FunctionGenerator::translate_bop(const TAC::Instruction &i) {
 		Operand left(GET_SUB_REG(EAX, i.operation_size), i.operation_sign);
 		Operand right(GET_SUB_REG(EBX, i.operation_size), i.operation_sign);
@@ -211,99 +204,99 @@ namespace CodeGeneration
 		switch (i.op)
 		{
 			case TAC::ADD:
-				put_instruction("add", left, right);
+				put_instruction(Opcode::ADD, left, right);
 				break;
 			case TAC::SUB:
-				put_instruction("sub", left, right);
+				put_instruction(Opcode::SUB, left, right);
 				break;
 			case TAC::MUL:
-//				put_instruction("mov", GET_SUB_REG(EAX, i.operation_size), left); // todo ???
+//				put_instruction(Opcode::MOV, GET_SUB_REG(EAX, i.operation_size), left); // todo ???
 				if (i.operation_sign)
-					put_instruction("imul", right);
+					put_instruction(Opcode::IMUL, right);
 				else
-					put_instruction("mul", right);
+					put_instruction(Opcode::MUL, right);
 //				this->move(ret, GET_SUB_REG(EAX, size_of(i.ret)))
 				break;
 			case TAC::DIV:
-				put_instruction("xor", GET_SUB_REG(EDX, size_of(i.ret)), GET_SUB_REG(EDX, size_of(i.ret)));
-//				put_instruction("mov", GET_SUB_REG(EAX, size_of(i.ret)), left); // todo ???
+				put_instruction(Opcode::XOR, GET_SUB_REG(EDX, size_of(i.ret)), GET_SUB_REG(EDX, size_of(i.ret)));
+//				put_instruction(Opcode::MOV, GET_SUB_REG(EAX, size_of(i.ret)), left); // todo ???
 				if (i.operation_sign)
-					put_instruction("idiv", right);
+					put_instruction(Opcode::IDIV, right);
 				else
-					put_instruction("div", right);
-//				put_instruction("mov", left, GET_SUB_REG(EAX, size_of(i.ret)));
+					put_instruction(Opcode::DIV, right);
+//				put_instruction(Opcode::MOV, left, GET_SUB_REG(EAX, size_of(i.ret)));
 				break;
 			case TAC::MOD:
-				put_instruction("xor", GET_SUB_REG(EDX, size_of(i.ret)), GET_SUB_REG(EDX, size_of(i.ret)));
-//				put_instruction("mov", GET_SUB_REG(EAX, size_of(i.ret)), left);
+				put_instruction(Opcode::XOR, GET_SUB_REG(EDX, size_of(i.ret)), GET_SUB_REG(EDX, size_of(i.ret)));
+//				put_instruction(Opcode::MOV, GET_SUB_REG(EAX, size_of(i.ret)), left);
 				if (i.operation_sign)
-					put_instruction("idiv", right);
+					put_instruction(Opcode::IDIV, right);
 				else
-					put_instruction("div", right);
-//				put_instruction("mov", left, GET_SUB_REG(EDX, size_of(i.ret)));
+					put_instruction(Opcode::DIV, right);
+//				put_instruction(Opcode::MOV, left, GET_SUB_REG(EDX, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(EDX, size_of(i.ret)));
 				break;
 			case TAC::SHIFT_LEFT:
-				put_instruction("shl", left, right);
+				put_instruction(Opcode::SHL, left, right);
 				break;
 			case TAC::SHIFT_RIGHT:
-				put_instruction("shr", left, right);
+				put_instruction(Opcode::SHR, left, right);
 				break;
 			case TAC::BITWISE_AND:
-				put_instruction("and", left, right);
+				put_instruction(Opcode::AND, left, right);
 				break;
 			case TAC::BITWISE_XOR:
-				put_instruction("xor", left, right);
+				put_instruction(Opcode::XOR, left, right);
 				break;
 			case TAC::BITWISE_OR:
-				put_instruction("or", left, right);
+				put_instruction(Opcode::OR, left, right);
 				break;
 			case TAC::LESSER:
-				put_instruction("cmp", left, right);
+				put_instruction(Opcode::CMP, left, right);
 				if (i.operation_sign)
-					put_instruction("setl", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETL, GET_SUB_REG(left.reg, 1));
 				else
-					put_instruction("setb", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETB, GET_SUB_REG(left.reg, 1));
 				ret = Operand(GET_SUB_REG(left.reg, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(left.reg, 1));
 				break;
 			case TAC::LESSER_EQUAL:
-				put_instruction("cmp", left, right);
+				put_instruction(Opcode::CMP, left, right);
 				if (i.operation_sign)
-					put_instruction("setle", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETLE, GET_SUB_REG(left.reg, 1));
 				else
-					put_instruction("setbe", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETBE, GET_SUB_REG(left.reg, 1));
 				ret = Operand(GET_SUB_REG(left.reg, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(left.reg, 1));
 				break;
 			case TAC::GREATER:
-				put_instruction("cmp", left, right);
+				put_instruction(Opcode::CMP, left, right);
 				if (i.operation_sign)
-					put_instruction("setg", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETG, GET_SUB_REG(left.reg, 1));
 				else
-					put_instruction("seta", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETA, GET_SUB_REG(left.reg, 1));
 				ret = Operand(GET_SUB_REG(left.reg, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(left.reg, 1));
 				break;
 			case TAC::GREATER_EQUAL:
-				put_instruction("cmp", left, right);
+				put_instruction(Opcode::CMP, left, right);
 				if (i.operation_sign)
-					put_instruction("setge", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETGE, GET_SUB_REG(left.reg, 1));
 				else
-					put_instruction("setae", GET_SUB_REG(left.reg, 1));
+					put_instruction(Opcode::SETAE, GET_SUB_REG(left.reg, 1));
 //				this->move(left, GET_SUB_REG(left, 1)) todo ?
 				ret = Operand(GET_SUB_REG(left.reg, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(left.reg, 1));
 				break;
 			case TAC::EQUAL:
-				put_instruction("cmp", left, right);
-				put_instruction("sete", GET_SUB_REG(left.reg, 1));
+				put_instruction(Opcode::CMP, left, right);
+				put_instruction(Opcode::SETE, GET_SUB_REG(left.reg, 1));
 				ret = Operand(GET_SUB_REG(left.reg, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(left.reg, 1));
 				break;
 			case TAC::NOT_EQUAL:
-				put_instruction("cmp", left, right);
-				put_instruction("setne", GET_SUB_REG(left.reg, 1));
+				put_instruction(Opcode::CMP, left, right);
+				put_instruction(Opcode::SETNE, GET_SUB_REG(left.reg, 1));
 				ret = Operand(GET_SUB_REG(left.reg, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(left.reg, 1));
 //				this->move(left, GET_SUB_REG(left.reg, 1));
@@ -323,16 +316,16 @@ namespace CodeGeneration
 		switch (i.op)
 		{
 			case TAC::LOGICAL_NOT:
-				put_instruction("cmp", reg, 0);
-				put_instruction("sete", GET_SUB_REG(reg.reg, 1));
+				put_instruction(Opcode::CMP, reg, 0);
+				put_instruction(Opcode::SETE, GET_SUB_REG(reg.reg, 1));
 				ret = Operand(GET_SUB_REG(reg.reg, size_of(i.ret)));
 				this->move(ret, GET_SUB_REG(reg.reg, 1));
 				break;
 			case TAC::BITWISE_NOT:
-				put_instruction("not", reg);
+				put_instruction(Opcode::NOT, reg);
 				break;
 			case TAC::NEG:
-				put_instruction("neg", reg);
+				put_instruction(Opcode::NEG, reg);
 				break;
 			default:
 				std::cerr << "unknown tac instruction!" << std::endl;
@@ -346,30 +339,30 @@ namespace CodeGeneration
 		{
 			case TAC::LOGICAL_AND: // todo
 			{
-				put_instruction("cmp", get_address_location(i.oper1), 0);
-				put_instruction("setne", AL);
-				put_instruction("cmp", get_address_location(i.oper2), 0);
-				put_instruction("setne", BL);
-				put_instruction("and", AL, BL);
+				put_instruction(Opcode::CMP, get_address_location(i.oper1), 0);
+				put_instruction(Opcode::SETNE, AL);
+				put_instruction(Opcode::CMP, get_address_location(i.oper2), 0);
+				put_instruction(Opcode::SETNE, BL);
+				put_instruction(Opcode::AND, AL, BL);
 				this->move(GET_SUB_REG(RAX, REG_SIZE), AL);
 				this->store(i.ret, GET_SUB_REG(RAX, REG_SIZE));
 				break;
 			}
 			case TAC::LOGICAL_OR: // todo
 			{
-				put_instruction("cmp", get_address_location(i.oper1), 0);
-				put_instruction("setne", AL);
-				put_instruction("cmp", get_address_location(i.oper2), 0);
-				put_instruction("setne", BL);
-				put_instruction("or", AL, BL);
+				put_instruction(Opcode::CMP, get_address_location(i.oper1), 0);
+				put_instruction(Opcode::SETNE, AL);
+				put_instruction(Opcode::CMP, get_address_location(i.oper2), 0);
+				put_instruction(Opcode::SETNE, BL);
+				put_instruction(Opcode::OR, AL, BL);
 				this->move(GET_SUB_REG(RAX, REG_SIZE), AL);
 				this->store(i.ret, GET_SUB_REG(RAX, REG_SIZE));
 				break;
 			}
 			case TAC::LOGICAL_NOT:
 			{
-				put_instruction("cmp", get_address_location(i.oper1), 0);
-				put_instruction("sete", AL);
+				put_instruction(Opcode::CMP, get_address_location(i.oper1), 0);
+				put_instruction(Opcode::SETE, AL);
 				this->move(GET_SUB_REG(RAX, REG_SIZE), AL);
 				this->store(i.ret, GET_SUB_REG(RAX, REG_SIZE));
 				break;
@@ -388,18 +381,18 @@ namespace CodeGeneration
 			Operand right(GET_SUB_REG(EBX, i.operation_size), i.operation_sign);
 			load(left, i.oper1);
 			load(right, i.oper2);
-			this->put_instruction("cmp", left, right);
-		}
-		std::string opcodes[] = { // todo sign
-				"jmp",
-				"je",
-				"jne",
-				"jg",
-				"jge",
-				"jl",
-				"jle"
+			this->put_instruction(Opcode::CMP, left, right);
+		}
+		static const Opcode opcodes[] = { // todo sign
+				Opcode::JMP,
+				Opcode::JE,
+				Opcode::JNE,
+				Opcode::JG,
+				Opcode::JGE,
+				Opcode::JL,
+				Opcode::JLE
 		};
-		this->put_instruction(opcodes[i.op - TAC::JUMP].c_str(), get_address_location(i.ret));
+		this->put_instruction(opcodes[i.op - TAC::JUMP], get_address_location(i.ret));
 	}
 
 	void FunctionGenerator::add_param(const TAC::Instruction &i) {
@@ -437,23 +430,22 @@ namespace CodeGeneration
 
 		size_t padding = (16 - (this->frame_size % 16)) % 16;
 //		if (padding)
-//			this->put_instruction("sub", GET_SUB_REG(RSP, REG_SIZE), padding); // todo
-		this->put_instruction("sub", GET_SUB_REG(RSP, REG_SIZE), frame_size + padding);
+//			this->put_instruction(Opcode::SUB, GET_SUB_REG(RSP, REG_SIZE), padding); // todo
+		this->put_instruction(Opcode::SUB, GET_SUB_REG(RSP, REG_SIZE), frame_size + padding);
 
+		size_t pushed = this->stack_args.size() * REG_SIZE;
 		for (;!this->stack_args.empty(); this->stack_args.pop())
 		{
 			this->load({GET_SUB_REG(RBX, this->stack_args.top().operation_size), this->stack_args.top().operation_sign}, this->stack_args.top().oper1);
-			this->put_instruction("push", GET_SUB_REG(RBX, REG_SIZE));
+			this->put_instruction(Opcode::PUSH, GET_SUB_REG(RBX, REG_SIZE));
 		}
-		this->put_instruction("call", GET_SUB_REG(RAX, REG_SIZE));
+		this->put_instruction(Opcode::CALL, GET_SUB_REG(RAX, REG_SIZE));
 
 //		if (padding)
-//			this->put_instruction("add", GET_SUB_REG(RSP, REG_SIZE), padding);
-		this->put_instruction("add", GET_SUB_REG(RSP, REG_SIZE), frame_size + padding);
+//			this->put_instruction(Opcode::ADD, GET_SUB_REG(RSP, REG_SIZE), padding);
+		// the stack pointer is back where the prologue left it, for the registers it saved to be popped
+		this->put_instruction(Opcode::ADD, GET_SUB_REG(RSP, REG_SIZE), frame_size + padding + pushed);
 
-//		for (;param_pos > 0; param_pos--)
-//			this->put_instruction("pop", param_registers[param_pos - 1]); //todo: reload spilled
-		this->param_pos = 0;
 		if (!holds_alternative<std::monostate>(i.ret))
 			this->store(i.ret, GET_SUB_REG(RAX, REG_SIZE));
 	}
@@ -470,7 +462,7 @@ namespace CodeGeneration
 			if (location.indirection->base.type == Operand::INDIRECT || location.indirection->index.type == Operand::INDIRECT)
 			{
 				this->load(GET_SUB_REG(reg.reg, REG_SIZE), location.indirection->base);
-//				put_instruction("mov", GET_SUB_REG(reg, REG_SIZE), location.indirection->base); // todo:  32bit
+//				put_instruction(Opcode::MOV, GET_SUB_REG(reg, REG_SIZE), location.indirection->base); // todo:  32bit
 //				this->map(location.indirection->base, GET_SUB_REG(reg, REG_SIZE));
 
 				location.indirection.reset(new Indirection(*location.indirection)); // todo: AAAAAAAAAAAAAAAAHHHHHHH!!!!!!!!!
@@ -480,11 +472,11 @@ namespace CodeGeneration
 				// todo: redo
 			}
 			move(reg, location);
-//			put_instruction("mov", GET_SUB_REG(reg, this->size_of(location)), location);
+//			put_instruction(Opcode::MOV, GET_SUB_REG(reg, this->size_of(location)), location);
 		}
 		else
 			move(reg, location);
-//			put_instruction("mov", GET_SUB_REG(reg, this->size_of(location)), location);
+//			put_instruction(Opcode::MOV, GET_SUB_REG(reg, this->size_of(location)), location);
 	}
 
 	void FunctionGenerator::load(const Operand &reg, const TAC::Address &addr) {
@@ -493,7 +485,7 @@ namespace CodeGeneration
 
 	void FunctionGenerator::store(const TAC::Address &address, const CodeGeneration::Operand &reg) {
 		assert(reg.type == Operand::REGISTER); // todo
-		const auto &location = get_address_location(address);
+		auto location = get_address_location(address);
 		if (location.type == Operand::INDIRECT)
 		{
 //			const auto &l_base = get_address_location(location.indirection->base);
@@ -501,15 +493,16 @@ namespace CodeGeneration
 			if (location.indirection->base.type == Operand::INDIRECT || location.indirection->index.type == Operand::INDIRECT)
 			{
 				this->load(GET_SUB_REG(RBX, PTR_SIZE), location.indirection->base); // todo: RBX?
+				location.indirection.reset(new Indirection(*location.indirection)); // the mapping keeps the pointer in memory
 				location.indirection->base = GET_SUB_REG(RBX, PTR_SIZE);
 
 			}
 			move(location, reg);
-//			put_instruction("mov", location, GET_SUB_REG(reg, this->size_of(location)));
+//			put_instruction(Opcode::MOV, location, GET_SUB_REG(reg, this->size_of(location)));
 		}
 		else
 			move(location, reg);
-//			put_instruction("mov", location, GET_SUB_REG(reg, this->size_of(location)));
+//			put_instruction(Opcode::MOV, location, GET_SUB_REG(reg, this->size_of(location)));
 	}
 
 //	void FunctionGenerator::move(const TAC::Address &dst, const TAC::Address &src) {
@@ -517,14 +510,14 @@ namespace CodeGeneration
 		// todo check for address - address mov
 //		auto l1 = get_address_location(dst);
 //		auto l2 = get_address_location(src);
-		std::string opcode = "mov";
+		Opcode opcode = Opcode::MOV;
 
 		if (size_of(l1) > size_of(l2))
 		{
 			if (l2.is_signed)
-				opcode = "movsx"; // todo ?
+				opcode = Opcode::MOVSX; // todo ?
 			else
-				opcode = "movzx";
+				opcode = Opcode::MOVZX;
 		}
 		else if (size_of(l1) < size_of(l2))
 		{
@@ -546,12 +539,10 @@ namespace CodeGeneration
 		}
 		// todo else?
 
-		put_instruction(opcode.c_str(), l1, l2);
+		put_instruction(opcode, l1, l2);
 	}
 
 	void FunctionGenerator::translate_instruction(const TAC::Instruction& i) {
-		this->instruction_to_asm.emplace_back(this->gen.get_lineno());
-
 //		i.print();
 
 		if (i.op == TAC::LOGICAL_AND || i.op == TAC::LOGICAL_OR || i.op == TAC::LOGICAL_NOT)
@@ -580,12 +571,9 @@ namespace CodeGeneration
 			this->call(i);
 		else if (i.op == TAC::DEREFERENCE)
 		{
+			// the temp is mapped on the object pointed, through the location of the pointer
 			this->load(GET_SUB_REG(RAX, size_of(i.oper1)), i.oper1);
-
-			auto op = alloc_temporary(PTR_SIZE);
-			move(op, GET_SUB_REG(RAX, size_of(i.oper1)));
-			size_t s = symbolTable.size_of(this->function.tac->temps[get<int>(i.ret)]);
-			this->add_mapping(i.ret, Operand(new Indirection{op, 0, s, 0}));
+			move(get_address_location(i.ret).indirection->base, GET_SUB_REG(RAX, size_of(i.oper1)));
 		}
 		else if (i.op == TAC::ADDRESS)
 		{
@@ -594,25 +582,15 @@ namespace CodeGeneration
 			if (location.indirection->base.type == Operand::INDIRECT)
 			{
 				this->load(GET_SUB_REG(RAX, PTR_SIZE), location.indirection->base);
+				location.indirection.reset(new Indirection(*location.indirection));
 				location.indirection->base = GET_SUB_REG(RAX, PTR_SIZE);
 			}
-			this->put_instruction("lea", GET_SUB_REG(RAX, PTR_SIZE), location);
+			this->put_instruction(Opcode::LEA, GET_SUB_REG(RAX, PTR_SIZE), location);
 			this->store(i.ret, GET_SUB_REG(RAX, PTR_SIZE));
 		}
 
-		this->gen.put("");
-	}
-
-	auto	FunctionGenerator::get_last_usage_pqueue() const
-	{
-		std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::function<bool(const std::pair<int, int> &, const std::pair<int, int> &)>> ret([](const std::pair<int, int> &l, const std::pair<int, int> &r) -> bool {return r.first < l.first;});
-		const auto &v = function.tac->get_last_usages();
-		for (size_t i = 0; i < v.size(); i++)
-		{
-//			std::cout << "last usage of t" << i << " at line " << v[i] << std::endl;
-			ret.emplace(v[i], i);
-		}
-		return ret;
+		if (commandLine->verbose_asm)
+			this->instruction_to_asm.emplace_back(this->code.size());
 	}
 
 	auto	FunctionGenerator::get_labels_pqueue() const
@@ -627,20 +605,6 @@ namespace CodeGeneration
 		return ret;
 	}
 
-	void FunctionGenerator::map(const TAC::Address &a, const CodeGeneration::Operand &o) { //todo duplicate with add_mapping?
-		if(this->map_variables[a].type == Operand::REGISTER)
-		{
-			this->allocated_registers.erase(this->map_variables[a].reg);
-			this->available_registers.insert(this->map_variables[a].reg);
-		}
-		this->map_variables[a] = o;
-		if (o.type == Operand::REGISTER)
-		{
-			this->available_registers.erase(o.reg);
-			this->allocated_registers.insert({o.reg, this->map_variables.find(a)->first});
-		}
-	}
-
 	void FunctionGenerator::map_params() {
 		int i = 0;
 		for (auto *o : this->function.params)
@@ -651,74 +615,181 @@ namespace CodeGeneration
 		}
 	}
 
-	void FunctionGenerator::translate() {
-		this->init_registers();
-		this->map_variables["@rbp"] = GET_SUB_REG(RBP, REG_SIZE); // todo: try to remove and see if it break
+	// each temp is in its register or in its slot of the frame for the whole function, a dereference is the object
+	// at the address in the location of its pointer
+	void FunctionGenerator::map_temps() {
+		const auto &temps = this->function.tac->temps;
+		for (size_t t = 0; t < temps.size(); t++)
+		{
+			if (!this->registers.used[t])
+				continue;
+			bool dereference = this->registers.dereferences[t];
+			size_t size = PTR_SIZE;
+			bool is_signed = false;
+			if (!dereference && !holds_alternative<Types::FunctionType>(temps[t]->type))
+			{
+				size = symbolTable.size_of(temps[t]);
+				is_signed = Types::is_signed(temps[t]);
+			}
+			Operand location;
+			if (this->registers.registers[t])
+				location = Operand(GET_SUB_REG(this->registers.registers[t].value(), size), is_signed);
+			else
+			{
+				location = this->alloc_temporary(size);
+				location.is_signed = is_signed;
+			}
+			if (dereference)
+				location = Operand(new Indirection{location, 0, symbolTable.size_of(temps[t]), 0});
+			this->map_variables[(int)t] = location;
+		}
+	}
+
+	void FunctionGenerator::translate(FunctionCode &out) {
+		static const Atom rbp("@rbp"); // interned once, the functions may be translated by several threads
+		this->registers = allocate_registers(*this->function.tac);
+		this->map_variables[rbp] = GET_SUB_REG(RBP, REG_SIZE); // todo: try to remove and see if it break
 		this->map_params();
 		const auto & instructions = function.tac->get_instructions();
-		auto lupq = get_last_usage_pqueue();
 		auto lpq = get_labels_pqueue();
 		this->put_name();
 		this->enter();
-//		this->spill_params();
+		this->map_temps();
 		for ( size_t i = 0; i < instructions.size(); i++)
 		{
 			while (!lpq.empty() && lpq.top().first <= i)
 			{
-				if (!map_labels.contains(lpq.top().second))
-					map_labels[lpq.top().second] = gen.get_label();
-				this->gen.put(".L" + std::to_string(map_labels[lpq.top().second]) + ":");
+				this->put_label(this->get_label(lpq.top().second));
 				lpq.pop();
 			}
-			std::cout.flush();
 			this->translate_instruction(instructions[i]);
-			while (!lupq.empty() && lupq.top().first < i)
-			{
-//				printf("free %d\n", lupq.top().second);
-//				this->free_temp(lupq.top().second); todo
-				lupq.pop();
-			}
 		}
 		while (!lpq.empty())
 		{
-			if (!map_labels.contains(lpq.top().second))
-				map_labels[lpq.top().second] = gen.get_label();
-			this->gen.put(".L" + std::to_string(map_labels[lpq.top().second]) + ":");
+			this->put_label(this->get_label(lpq.top().second));
 			lpq.pop();
 		}
 		this->leave();
+
+		if (this->gen.object)
+		{
+			Assembler assembler;
+			for (auto &i : this->code)
+				assembler.encode(i);
+			assembler.resolve_labels();
+			out.bytes = assembler.get_code();
+			out.relocations = assembler.get_relocations();
+			return;
+		}
+		out.text.reserve(this->code.size() * 32);
+		this->render(out.text);
 	}
 
 	void FunctionGenerator::enter() {
-		this->put_instruction("push", GET_SUB_REG(RBP, REG_SIZE));
-		this->put_instruction("mov", GET_SUB_REG(RBP, REG_SIZE), GET_SUB_REG(RSP, REG_SIZE));
-		this->put_instruction("sub", GET_SUB_REG(RSP, REG_SIZE), this->function.frame_size);
-		this->put_instruction("push", GET_SUB_REG(RBX, REG_SIZE));
-		this->frame_size += REG_SIZE + this->function.frame_size;
+		this->put_instruction(Opcode::PUSH, GET_SUB_REG(RBP, REG_SIZE));
+		this->put_instruction(Opcode::MOV, GET_SUB_REG(RBP, REG_SIZE), GET_SUB_REG(RSP, REG_SIZE));
+		this->put_instruction(Opcode::SUB, GET_SUB_REG(RSP, REG_SIZE), this->function.frame_size);
+		this->put_instruction(Opcode::PUSH, GET_SUB_REG(RBX, REG_SIZE));
+		for (Register r : this->registers.callee_saved)
+			this->put_instruction(Opcode::PUSH, r);
+		this->frame_size += REG_SIZE * (1 + this->registers.callee_saved.size()) + this->function.frame_size;
 	}
 
 	void FunctionGenerator::leave() {
-		this->put_instruction("pop", GET_SUB_REG(RBX, REG_SIZE));
-		this->put_instruction("mov", GET_SUB_REG(RSP, REG_SIZE), GET_SUB_REG(RBP, REG_SIZE));
-		this->put_instruction("pop", GET_SUB_REG(RBP, REG_SIZE));
-		this->put_instruction("ret");
+		for (auto it = this->registers.callee_saved.rbegin(); it != this->registers.callee_saved.rend(); it++)
+			this->put_instruction(Opcode::POP, *it);
+		this->put_instruction(Opcode::POP, GET_SUB_REG(RBX, REG_SIZE));
+		this->put_instruction(Opcode::MOV, GET_SUB_REG(RSP, REG_SIZE), GET_SUB_REG(RBP, REG_SIZE));
+		this->put_instruction(Opcode::POP, GET_SUB_REG(RBP, REG_SIZE));
+		this->put_instruction(Opcode::RET);
 	}
 
 	void FunctionGenerator::put_name() {
 	}
 
 
-	FileGenerator::FileGenerator(std::ostream &o) : out(o), line(0) {}
+	FileGenerator::FileGenerator(OutputBuffer &o) : out(o), line(0), section(ElfWriter::SECTION_COUNT) {
+		if (commandLine->emit_obj)
+			this->object.reset(new ElfWriter);
+	}
+
+	std::string decode_string_literal(const std::string &literal)
+	{
+		std::string ret;
+		size_t i = literal.find('"') + 1;
+		while (i < literal.size() - 1)
+		{
+			if (literal[i] != '\\')
+			{
+				ret += literal[i++];
+				continue;
+			}
+			i++;
+			switch (char c = literal[i++])
+			{
+				case 'a': ret += '\a'; break;
+				case 'b': ret += '\b'; break;
+				case 'f': ret += '\f'; break;
+				case 'n': ret += '\n'; break;
+				case 'r': ret += '\r'; break;
+				case 't': ret += '\t'; break;
+				case 'v': ret += '\v'; break;
+				case 'x':
+				{
+					int n = 0;
+					for (; i < literal.size() - 1 && isxdigit(literal[i]); i++)
+						n = n * 16 + (isdigit(literal[i]) ? literal[i] - '0' : tolower(literal[i]) - 'a' + 10);
+					ret += (char)n;
+					break;
+				}
+				default:
+					if (c >= '0' && c <= '7')
+					{
+						int n = c - '0';
+						for (int j = 0; j < 2 && literal[i] >= '0' && literal[i] <= '7'; j++)
+							n = n * 8 + literal[i++] - '0';
+						ret += (char)n;
+					}
+					else // \\ \' \" \?
+						ret += c;
+			}
+		}
+		ret += '\0';
+		return ret;
+	}
 
+	// the floating constants are doubles, in the ieee 754 format of the target
 	void FileGenerator::put_constant(const SymbolTable::Constant *c) {
 		if (holds_alternative<uintmax_t>(c->value))
 			return;
-		this->put(".section .rodata");
+		this->set_section(ElfWriter::RODATA);
+		uint64_t bits = 0;
+		if (holds_alternative<long double>(c->value))
+		{
+			double d = get<long double>(c->value);
+			memcpy(&bits, &d, sizeof(bits));
+		}
+		if (this->object)
+		{
+			this->object->define_constant(c->id);
+			switch (c->value.index())
+			{
+				case 0:
+					return this->object->put_value<uint64_t>(bits);
+				case 2:
+				{
+					std::string s = decode_string_literal(get<2>(c->value));
+					return this->object->put_bytes(s.data(), s.size());
+				}
+				default:
+					throw std::runtime_error("shouldn't be reached");
+			}
+		}
 		this->put(".LC" + std::to_string(c->id) + ":");
 		switch (c->value.index())
 		{
 			case 0:
-				return this->put( ".long " + std::to_string(*(long int *)&get<1>(c->value)));
+				return this->put(".quad " + std::to_string(bits));
 			case 2:
 				return this->put( ".string " + get<2>(c->value));
 			default:
@@ -726,9 +797,94 @@ namespace CodeGeneration
 		}
 	}
 
+	// String literals are grouped in the mergeable string section, where a string which ends another one is only an
+	// alias inside it. Strings containing a null byte can't be merged and are put in .rodata with the other constants.
+	void FileGenerator::put_constants() {
+		struct String {
+			std::string						bytes;
+			const SymbolTable::Constant		*constant;
+			int								owner; // id of the string containing this one, -1 if it is stored
+			size_t							offset; // in the owner
+		};
+		std::vector<String> strings;
+		for (auto &c : symbolTable.constants)
+		{
+			if (!holds_alternative<std::string>(c.value))
+			{
+				this->put_constant(&c);
+				continue;
+			}
+			std::string bytes = decode_string_literal(get<std::string>(c.value));
+			if (bytes.find('\0') != bytes.size() - 1)
+				this->put_constant(&c);
+			else
+				strings.push_back({std::move(bytes), &c, -1, 0});
+		}
+
+		// in decreasing order of the reversed bytes, a string ending another one comes after it with only strings
+		// ending it too in between, so it ends the last stored string
+		std::sort(strings.begin(), strings.end(), [](const String &a, const String &b) {
+			return std::lexicographical_compare(b.bytes.rbegin(), b.bytes.rend(), a.bytes.rbegin(), a.bytes.rend());
+		});
+		const String *owner = nullptr;
+		for (auto &s : strings)
+			if (owner && owner->bytes.ends_with(s.bytes))
+			{
+				s.owner = owner->constant->id;
+				s.offset = owner->bytes.size() - s.bytes.size();
+			}
+			else
+				owner = &s;
+
+		// stored strings in the order of the source, then the aliases which refer to them
+		std::sort(strings.begin(), strings.end(), [](const String &a, const String &b) {
+			if ((a.owner < 0) != (b.owner < 0))
+				return a.owner < 0;
+			return a.constant->id < b.constant->id;
+		});
+		if (!strings.empty())
+			this->set_section(ElfWriter::RODATA_STR);
+		for (auto &s : strings)
+		{
+			int id = s.constant->id;
+			if (this->object)
+			{
+				if (s.owner < 0)
+				{
+					this->object->define_constant(id);
+					this->object->put_bytes(s.bytes.data(), s.bytes.size());
+				}
+				else
+					this->object->alias_constant(id, s.owner, s.offset);
+			}
+			else if (s.owner < 0)
+			{
+				this->put(".LC" + std::to_string(id) + ":");
+				this->put(".string " + get<std::string>(s.constant->value));
+			}
+			else
+				this->put(".set .LC" + std::to_string(id) + ", .LC" + std::to_string(s.owner) + "+" + std::to_string(s.offset));
+		}
+	}
+
 	void FileGenerator::put_ordinary(const SymbolTable::Ordinary *o) {
 		int size = symbolTable.size_of(o->type);
 		// todo: align
+		if (this->object)
+		{
+			if (!o->init)
+				return this->object->put_zero(size);
+			auto init = o->init.value();
+			switch (init->value.index())
+			{
+				case 0:
+					return this->object->put_value<double>(get<0>(init->value));
+				case 1:
+					return this->object->put_value<uint32_t>(get<1>(init->value));
+				case 2:
+					return this->object->put_reference({0, 0, Relocation::CONSTANT, nullptr, init->id});
+			}
+		}
 		if (!o->init)
 			this->put(".zero " + std::to_string(size));
 		else
@@ -749,9 +905,209 @@ namespace CodeGeneration
 		}
 	}
 
+	void FileGenerator::set_section(ElfWriter::SectionId section) {
+		static const char *directives[] = {
+			".text",
+			".data", // todo: bss
+			".section .rodata",
+			".section .rodata.str1.1,\"aMS\",@progbits,1",
+		};
+		if (section == this->section)
+			return;
+		this->section = section;
+		if (this->object)
+			this->object->set_section(section);
+		else
+			this->put(directives[section]);
+	}
+
+	void FileGenerator::put_function(const FunctionCode &code) {
+		if (this->object)
+			return this->object->put_code(code.bytes, code.relocations);
+		this->out.write(code.text);
+		this->line += std::count(code.text.begin(), code.text.end(), '\n');
+	}
+
+	// the labels of a cached assembly are renumbered from the first label of the function in this file
+	static std::string relabel(std::string_view text, int from, int to) {
+		std::string ret;
+		ret.reserve(text.size());
+		size_t i = 0;
+		for (size_t found; (found = text.find(".L", i)) != std::string_view::npos;)
+		{
+			found += 2;
+			ret.append(text, i, found - i);
+			i = found;
+			if (found < text.size() && isdigit(text[found]))
+			{
+				int label = 0;
+				auto [end, error] = std::from_chars(text.data() + found, text.data() + text.size(), label);
+				ret += std::to_string(label - from + to);
+				i = end - text.data();
+			}
+		}
+		ret.append(text, i);
+		return ret;
+	}
+
+	// the symbols of the relocations are the names of the globals and functions used by the tac
+	static const std::string *find_symbol(const SymbolTable::Function &f, std::string_view name) {
+		for (auto &i : f.tac->get_instructions())
+			for (auto *a : {&i.ret, &i.oper1, &i.oper2})
+				if (holds_alternative<SymbolTable::Ordinary *>(*a) && get<SymbolTable::Ordinary *>(*a)->name.str() == name)
+					return &get<SymbolTable::Ordinary *>(*a)->name.str();
+				else if (holds_alternative<Atom>(*a) && get<Atom>(*a).str() == name)
+					return &get<Atom>(*a).str();
+		return nullptr;
+	}
+
+	// A function is looked up in the cache by its tac and the layout of what it refers to. The object code doesn't
+	// depend on the numbers of the labels, which are resolved by the assembler, and the assembly is stored with the
+	// number of its first label so that it is reused when the functions before it change.
+	void FileGenerator::get_function_code(const SymbolTable::Function &f, int first_label, FunctionCode &code) {
+		TimeReport::Scope timer(TimeReport::CODE_GENERATION, f.name);
+		MemoryReport::Scope memory(MemoryReport::BACKEND);
+		if (!CompilationCache::enabled())
+			return FunctionGenerator(f, *this, first_label).translate(code);
+		Hash h = CompilationCache::new_key("function");
+		h.put(f.name.str()).put(f.frame_size).put(f.params.size());
+		for (auto *o : f.params)
+			h.put(o->name.str()).put(symbolTable.size_of(o->type)).put(Types::is_signed(o->type));
+		f.tac->hash(h);
+		std::string key = h.finish();
+
+		std::string data;
+		if (CompilationCache::load(key, data))
+		{
+			std::string_view p = data;
+			auto get = [&p]() {
+				uint32_t v = 0;
+				if (p.size() >= sizeof(v))
+					memcpy(&v, p.data(), sizeof(v));
+				p.remove_prefix(std::min(p.size(), sizeof(v)));
+				return v;
+			};
+			auto get_string = [&p, &get]() {
+				std::string_view s = p.substr(0, get());
+				p.remove_prefix(s.size());
+				return s;
+			};
+			bool valid = true;
+			if (!this->object)
+			{
+				int from = get();
+				code.text = relabel(get_string(), from, first_label);
+			}
+			else
+			{
+				std::string_view bytes = get_string();
+				code.bytes.assign(bytes.begin(), bytes.end());
+				code.relocations.resize(get());
+				for (auto &r : code.relocations)
+				{
+					r.offset = get();
+					r.type = get();
+					r.target = static_cast<Relocation::Target>(get());
+					std::string_view symbol = get_string();
+					r.symbol = r.target == Relocation::SYMBOL ? find_symbol(f, symbol) : nullptr;
+					r.constant = get();
+					valid = valid && (r.target != Relocation::SYMBOL || r.symbol);
+				}
+			}
+			if (valid && p.empty())
+				return;
+			code = FunctionCode();
+		}
+
+		FunctionGenerator(f, *this, first_label).translate(code);
+		data.clear();
+		auto put = [&data](uint32_t v) { data.append(reinterpret_cast<const char *>(&v), sizeof(v)); };
+		auto put_string = [&data, &put](std::string_view s) { put(s.size()); data += s; };
+		if (!this->object)
+		{
+			put(first_label);
+			put_string(code.text);
+		}
+		else
+		{
+			put_string(std::string_view(reinterpret_cast<const char *>(code.bytes.data()), code.bytes.size()));
+			put(code.relocations.size());
+			for (auto &r : code.relocations)
+			{
+				put(r.offset);
+				put(r.type);
+				put(r.target);
+				put_string(r.symbol ? std::string_view(*r.symbol) : std::string_view());
+				put(r.constant);
+			}
+		}
+		CompilationCache::store(key, data);
+	}
+
+	// -j: the functions are shared between the threads, each one takes the next function not translated yet.
+	// The translation of a function only reads the symbol table, and writes nothing but its own FunctionCode.
+	void FileGenerator::translate_functions(std::vector<std::pair<const SymbolTable::Function *, int>> &functions,
+											std::vector<FunctionCode> &codes) {
+		std::atomic<size_t>				next = 0;
+		std::vector<std::exception_ptr>	errors(functions.size());
+		auto worker = [&]() {
+			for (size_t i; (i = next++) < functions.size();)
+				try {
+					this->get_function_code(*functions[i].first, functions[i].second, codes[i]);
+				} catch (...) {
+					errors[i] = std::current_exception();
+				}
+		};
+		std::vector<std::thread> threads;
+		for (int i = 1; i < std::min<int>(commandLine->jobs, functions.size()); i++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto &t : threads)
+			t.join();
+		for (auto &e : errors) // the error of the first function, as in a serial run
+			if (e)
+				std::rethrow_exception(e);
+	}
+
+	void FileGenerator::put_symbol(const SymbolTable::Symbol &sym) {
+		if (this->object)
+			return this->object->define_symbol(sym.name.str(), sym.visibility == SymbolTable::Symbol::GLOBAL,
+											   holds_alternative<SymbolTable::Function*>(sym.value), sym.size);
+		if (sym.size)
+			this->put(".size " + sym.name.str() + ", " + std::to_string(sym.size));
+
+		//todo: asm type:
+		if (sym.visibility == SymbolTable::Symbol::GLOBAL)
+		{
+			this->put(".globl " + sym.name.str());
+		}
+		else
+			this->put(".local " + sym.name.str());
+		this->put(sym.name.str() + ":");
+	}
+
 	void FileGenerator::generate() {
-		this->put(".intel_syntax noprefix");
-		this->put(".text");
+		// labels are numbered across the file, each function starts after the labels of the previous ones
+		std::vector<std::pair<const SymbolTable::Function *, int>> functions;
+		int first_label = 0;
+		for (auto &sym : symbolTable.symbols)
+			if (sym.visibility != SymbolTable::Symbol::NONE && holds_alternative<SymbolTable::Function*>(sym.value))
+			{
+				auto *f = get<SymbolTable::Function*>(sym.value);
+				functions.emplace_back(f, first_label);
+				first_label += f->tac->get_label_count();
+			}
+		std::vector<FunctionCode> codes;
+		if (commandLine->jobs > 1 && functions.size() > 1)
+		{
+			codes.resize(functions.size());
+			this->translate_functions(functions, codes);
+		}
+
+		if (!this->object)
+			this->put(".intel_syntax noprefix");
+		this->set_section(ElfWriter::TEXT);
+		size_t function_index = 0;
 		for (auto &sym : symbolTable.symbols)
 		{
 			if (sym.visibility == SymbolTable::Symbol::NONE)
@@ -759,21 +1115,10 @@ namespace CodeGeneration
 
 //			std::cout << sym.name << std::endl;
 			if (holds_alternative<SymbolTable::Function*>(sym.value))
-				this->put(".text");
+				this->set_section(ElfWriter::TEXT);
 			else
-				this->put(".data"); // todo: bss
-
-			if (sym.size)
-				this->put(".size " + sym.name + ", " + std::to_string(sym.size));
-
-			//todo: asm type:
-			if (sym.visibility == SymbolTable::Symbol::GLOBAL)
-			{
-				this->put(".globl " + sym.name);
-			}
-			else
-				this->put(".local " + sym.name);
-			this->put(sym.name + ":");
+				this->set_section(ElfWriter::DATA);
+			this->put_symbol(sym);
 			switch (sym.value.index())
 			{
 				case 0:
@@ -782,7 +1127,14 @@ namespace CodeGeneration
 //					std::cout << "============= TAC CODE ==============" << std::endl;
 //					get<SymbolTable::Function*>(sym.value)->tac->print();
 //					std::cout << "========== END OF TAC CODE ==========" << std::endl;
-					CodeGeneration::FunctionGenerator(*get<SymbolTable::Function*>(sym.value), *this).translate();
+					if (!codes.empty())
+					{
+						this->put_function(codes[function_index++]);
+						break;
+					}
+					FunctionCode code;
+					this->get_function_code(*get<SymbolTable::Function*>(sym.value), functions[function_index++].second, code);
+					this->put_function(code);
 				}
 				break;
 				case 1:
@@ -792,12 +1144,13 @@ namespace CodeGeneration
 				break;
 			}
 		}
-		for (auto &c : symbolTable.constants)
-			this->put_constant(&c);
+		this->put_constants();
+		if (this->object)
+			this->object->write(this->out);
 	}
 
-	void FileGenerator::put(const std::string &s) {
-		out << s << std::endl;
+	void FileGenerator::put(std::string_view s) {
+		out << s << '\n';
 		line++;
 	}
 
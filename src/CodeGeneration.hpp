@@ -1,13 +1,16 @@
 #ifndef CC1_POC_CODEGENERATION_HPP
 #define CC1_POC_CODEGENERATION_HPP
 #include "TAC.hpp"
+#include "OutputBuffer.hpp"
+#include "ElfWriter.hpp"
 #include <queue>
+#include <stack>
 #include <functional>
 #include <iostream>
 #define REGISTER_SIZE(R) (1 << (static_cast<int>(R) % 4))
 #define BASE_REG(R) static_cast<Register>((static_cast<int>(R) & ~0b11))
 #define GET_SUB_REG(R, SIZE) static_cast<Register>(static_cast<int>(BASE_REG(R)) + ((SIZE) >= 2) + ((SIZE) >= 4) + ((SIZE) >= 8))
-#define CLEAN_REG(R) do {this->put_instruction("xor", GET_SUB_REG((R), 8), GET_SUB_REG((R), 8));} while(0)
+#define CLEAN_REG(R) do {this->put_instruction(Opcode::XOR, GET_SUB_REG((R), 8), GET_SUB_REG((R), 8));} while(0)
 #define REG_SIZE 4
 
 namespace CodeGeneration
@@ -52,7 +55,7 @@ namespace CodeGeneration
 		"r15b",	"r15w",	"r15d",	"r15",
 	};
 
-	static const std::string operand_size_str[] = {
+	static const char *operand_size_str[] = {
 			"",
 			"BYTE",
 			"WORD",
@@ -64,6 +67,92 @@ namespace CodeGeneration
 			"QWORD",
 	};
 
+	enum class Opcode {
+		LABEL, // pseudo instruction, operand a is the label
+		MOV,
+		MOVSX,
+		MOVZX,
+		LEA,
+		ADD,
+		SUB,
+		MUL,
+		IMUL,
+		DIV,
+		IDIV,
+		AND,
+		OR,
+		XOR,
+		NOT,
+		NEG,
+		SHL,
+		SHR,
+		CMP,
+		SETE,
+		SETNE,
+		SETL,
+		SETLE,
+		SETG,
+		SETGE,
+		SETB,
+		SETBE,
+		SETA,
+		SETAE,
+		JMP,
+		JE,
+		JNE,
+		JG,
+		JGE,
+		JL,
+		JLE,
+		PUSH,
+		POP,
+		CALL,
+		RET,
+	};
+
+	static const char *opcodes_strings[] = {
+		"",
+		"mov",
+		"movsx",
+		"movzx",
+		"lea",
+		"add",
+		"sub",
+		"mul",
+		"imul",
+		"div",
+		"idiv",
+		"and",
+		"or",
+		"xor",
+		"not",
+		"neg",
+		"shl",
+		"shr",
+		"cmp",
+		"sete",
+		"setne",
+		"setl",
+		"setle",
+		"setg",
+		"setge",
+		"setb",
+		"setbe",
+		"seta",
+		"setae",
+		"jmp",
+		"je",
+		"jne",
+		"jg",
+		"jge",
+		"jl",
+		"jle",
+		"push",
+		"pop",
+		"call",
+		"ret",
+	};
+
 	struct Indirection;
 	struct Operand {
 		enum Type {
@@ -73,11 +162,18 @@ namespace CodeGeneration
 			DIRECT,
 			IMMEDIATE
 		};
+		enum LabelType {
+			SYMBOL, // named symbol
+			LOCAL, // .L<n>
+			CONSTANT // .LC<n>
+		};
 		Type		type;
 
 		Register	reg;
 
-		std::string	label;
+		LabelType			label_type;
+		const std::string	*symbol; // owned by the symbol table or the tac, must outlive the generated code
+		int					label;
 
 		uint64_t	immediate_value;
 
@@ -91,7 +187,8 @@ namespace CodeGeneration
 		// init indirection
 		explicit Operand(Indirection * const & i, bool is_s = false) : type(INDIRECT), indirection(i), is_signed(is_s) {};
 		// init direct
-		Operand(const std::string &s, bool is_s = false) : type(DIRECT), label(s), is_signed(is_s) {};
+		explicit Operand(const std::string *s, bool is_s = false) : type(DIRECT), label_type(SYMBOL), symbol(s), is_signed(is_s) {};
+		Operand(LabelType t, int l, bool is_s = false) : type(DIRECT), label_type(t), label(l), is_signed(is_s) {};
 		// init immediate
 		Operand(const uint64_t &i, bool is_s = false) : type(IMMEDIATE), immediate_value(i), is_signed(is_s) {};
 	};
@@ -104,16 +201,46 @@ namespace CodeGeneration
 		ssize_t			displacement;
 	};
 
+	struct MachineInstruction {
+		Opcode	opcode;
+		Operand	a;
+		Operand	b;
+	};
+
+	// translation of a function, produced independently of the other functions so that they can be translated in
+	// parallel and written in the order of the symbols afterwards
+	struct FunctionCode {
+		std::string				text; // assembly
+		std::vector<uint8_t>	bytes; // with -c, the encoded instructions and their relocations
+		std::vector<Relocation>	relocations;
+	};
+
+	// where the temps of a function are kept, decided before it is translated (RegisterAllocation.cpp)
+	struct RegisterAssignment {
+		std::vector<std::optional<Register>>	registers; // by temp, none for a temp kept in the frame
+		std::vector<bool>						dereferences; // temps defined by a dereference: their register holds the pointer
+		std::vector<bool>						used; // temps mentioned by an instruction
+		std::vector<Register>					callee_saved; // allocated registers the prologue saves, in the order they are pushed
+	};
+	RegisterAssignment	allocate_registers(const TAC::TacFunction &);
+
 	class FileGenerator {
 	private:
-		std::ostream			&out;
+		OutputBuffer			&out;
 		int						line;
-		void					put(const std::string &);
+		std::unique_ptr<ElfWriter>	object; // -c: the code is assembled into an object file instead of being printed
+		ElfWriter::SectionId	section; // SECTION_COUNT before the first directive
+		void					put(std::string_view);
+		void					set_section(ElfWriter::SectionId);
+		void					put_symbol(const SymbolTable::Symbol &);
 		void					put_constant(const SymbolTable::Constant *);
+		void					put_constants();
 		void					put_ordinary(const SymbolTable::Ordinary *);
-		int						get_label() {static int current = 0; return current++;};
+		void					put_function(const FunctionCode &);
+		void					get_function_code(const SymbolTable::Function &, int first_label, FunctionCode &);
+		void					translate_functions(std::vector<std::pair<const SymbolTable::Function *, int>> &, std::vector<FunctionCode> &);
 	public:
-		FileGenerator(std::ostream &);
+		FileGenerator(OutputBuffer &);
 		void			generate();
 		int				get_lineno() const;
 		friend class FunctionGenerator;
@@ -123,30 +250,23 @@ namespace CodeGeneration
 	private:
 		const SymbolTable::Function &function;
 		FileGenerator				&gen;
+		int							first_label; // file labels of the function are numbered from first_label
 
-		std::map<int, Register>															temp_to_register; // store the current register where is the temp
-		std::map<TAC::Address, Operand>													map_variables; // store the current register where is the temp
-		std::map<Register, const TAC::Address &, std::function<decltype(compare_reg)>>	allocated_registers; // todo rename
-		std::set<Register, std::function<decltype(compare_reg)> >						available_registers;
-		std::map<int, int>																map_labels; // map tac label id to file label id
+		RegisterAssignment					registers;
+		std::map<TAC::Address, Operand>		map_variables; // store the current register where is the temp
+		std::map<int, int>					map_labels; // map tac label id to file label id
 
 		size_t								frame_size;
 
-		std::vector<int>					instruction_to_asm; // store the position in the file of an instruction
-		int									param_pos = 0;
+		std::vector<MachineInstruction>		code;
+		std::vector<size_t>					instruction_to_asm; // index in code of the end of the translation of each tac instruction
 		std::stack<TAC::Instruction>		stack_args;
-		void		init_registers();
 		std::map<TAC::Address, Operand>::iterator	add_mapping(const TAC::Address &addr, Operand &&op);
 		void		map_params();
-		void		map(const TAC::Address &, const Operand &);
-		Register	alloc_register(const std::optional<Register> & = std::nullopt);
-		void 		spill(const Register&);
-		void		free_register(Register);
+		void		map_temps();
 		Operand 	alloc_temporary(size_t size);
-		Operand		temp_to_operand(int);
 		Operand		get_address_location(const TAC::Address &);
 		Operand		address_to_operand(const TAC::Address &);
-		void		free_temp(int);
 		void		translate_instruction(const TAC::Instruction&);
 		void		translate_bop(const TAC::Instruction &);
 		void		translate_logical_operator(const TAC::Instruction &);
@@ -158,10 +278,10 @@ namespace CodeGeneration
 		void		load(const Operand &, Operand);
 		void		store(const TAC::Address &, const Operand &);
 		void		translate_jump(const TAC::Instruction &);
-		std::string	operand_to_string(const Operand &a, bool);
-		std::string	indirection_to_string(const Indirection &);
-		std::string	operand_to_string(const TAC::Address &a);
-		void		put_instruction(const char *opcode, const Operand &a, const Operand &b);
+		void		put_instruction(Opcode opcode, const Operand &a = {}, const Operand &b = {});
+		void		put_label(int label);
+		int			get_label(const TAC::Label &);
+		void		render(std::string &) const;
 		void		enter();
 		void		leave();
 		void		put_name();
@@ -169,14 +289,14 @@ namespace CodeGeneration
 		size_t		size_of(const TAC::Address &o);
 
 		auto	get_labels_pqueue() const;
-		auto	get_last_usage_pqueue() const;
 
 	public:
-		FunctionGenerator(const SymbolTable::Function &, FileGenerator &);
-		void	translate();
+		FunctionGenerator(const SymbolTable::Function &, FileGenerator &, int first_label);
+		void	translate(FunctionCode &);
 	};
 
-	void	translate(const TAC::TacFunction &, std::ostream &);
+	void		translate(const TAC::TacFunction &, std::ostream &);
+	std::string	decode_string_literal(const std::string &literal); // bytes of the token in memory, with the terminating null byte
 }
 
 #endif
@@ -1,28 +1,166 @@
 #include "CommandLine.hpp"
-#include <unistd.h>
+#include <getopt.h>
 #include <iostream>
+#include <cstdlib>
+#include <map>
 
 CommandLine::CommandLine(int argc, char **argv) :
 	input_file(""),
-	output_file("out.s")
+	output_file(""),
+	verbose_asm(false),
+	time_report(false),
+	mem_report(false),
+	mem_report_phases(false),
+	emit_obj(false),
+	preprocess_only(false),
+	dependencies(false),
+	jobs(1),
+	emit_pch(false),
+	emit_tac(false),
+	run_tac(false),
+	fold_pure_calls(false),
+	sccp(false)
 {
+	enum {
+		OPT_MD = 256,
+		OPT_MF,
+		OPT_SERVER,
+		OPT_EMIT_PCH,
+		OPT_INCLUDE_PCH,
+		OPT_CACHE_DIR,
+		OPT_EMIT_TAC,
+		OPT_RUN_TAC,
+	};
+	static const option long_options[] = {
+		{"emit-obj", no_argument, nullptr, 'c'},
+		{"MD", no_argument, nullptr, OPT_MD},
+		{"MF", required_argument, nullptr, OPT_MF},
+		{"server", required_argument, nullptr, OPT_SERVER},
+		{"emit-pch", no_argument, nullptr, OPT_EMIT_PCH},
+		{"include-pch", required_argument, nullptr, OPT_INCLUDE_PCH},
+		{"cache-dir", required_argument, nullptr, OPT_CACHE_DIR},
+		{"emit-tac", no_argument, nullptr, OPT_EMIT_TAC},
+		{"run-tac", no_argument, nullptr, OPT_RUN_TAC},
+		{nullptr, 0, nullptr, 0},
+	};
+	optind = 0; // start over, the server parses the command line of each job
+	// long options are also accepted with a single dash, as -MD and -MF
 	while (1)
-		switch (getopt(argc, argv, "-o:"))
+		switch (getopt_long_only(argc, argv, "-cEo:f:I:D:U:j:", long_options, nullptr))
 		{
+			case 'c':
+				this->emit_obj = true;
+				break;
+			case 'E':
+				this->preprocess_only = true;
+				break;
+			case 'I':
+				this->include_paths.push_back(optarg);
+				break;
+			case 'D':
+				this->macros.push_back("D" + std::string(optarg));
+				break;
+			case 'U':
+				this->macros.push_back("U" + std::string(optarg));
+				break;
+			case OPT_MD:
+				this->dependencies = true;
+				break;
+			case OPT_MF:
+				this->dependency_file = optarg;
+				break;
+			case OPT_EMIT_PCH:
+				this->emit_pch = true;
+				break;
+			case OPT_INCLUDE_PCH:
+				this->pch_file = optarg;
+				break;
+			case OPT_EMIT_TAC:
+				this->emit_tac = true;
+				break;
+			case OPT_RUN_TAC:
+				this->run_tac = true;
+				break;
+			case OPT_CACHE_DIR:
+				this->cache_directory = optarg;
+				break;
+			case OPT_SERVER:
+				this->server_socket = optarg;
+				break;
+			case 'j':
+			{
+				char *end;
+				long n = strtol(optarg, &end, 10);
+				if (*end || n < 1)
+				{
+					std::cerr << "invalid number of jobs: " << optarg << std::endl;
+					exit(1);
+				}
+				this->jobs = n;
+				break;
+			}
 			case 'o':
 				this->output_file = optarg;
 				break;
+			case 'f':
+				if (std::string(optarg) == "verbose-asm")
+					this->verbose_asm = true;
+				else if (std::string(optarg) == "time-report")
+					this->time_report = true;
+				else if (std::string(optarg) == "mem-report")
+					this->mem_report = true;
+				else if (std::string(optarg) == "mem-report-phases")
+					this->mem_report = this->mem_report_phases = true;
+				else if (std::string(optarg) == "fold-pure-calls")
+					this->fold_pure_calls = true;
+				else if (std::string(optarg) == "sccp")
+					this->sccp = true;
+				else
+				{
+					std::cerr << "unrecognized command-line option: -f" << optarg << std::endl;
+					exit(1);
+				}
+				break;
 			case 1:
-				this->input_file = optarg;
+				this->input_files.push_back(optarg);
 				break;
 			case '?':
 				exit(1);
 			case -1:
-				if (this->input_file.empty())
+				if (!this->server_socket.empty())
+					return;
+				if (this->input_files.empty())
 				{
 					std::cerr << "Missing operand" << std::endl;
 					exit(1);
 				}
+				if (this->input_files.size() > 1)
+				{
+					if (!this->output_file.empty() || !this->dependency_file.empty())
+					{
+						std::cerr << "cannot specify " << (this->output_file.empty() ? "-MF" : "-o") << " with multiple files" << std::endl;
+						exit(1);
+					}
+					// the children would write the same file at once, and one of the outputs would be lost
+					std::map<std::string, std::string> outputs;
+					for (auto &input : this->input_files)
+						if (auto [it, inserted] = outputs.emplace(this->get_output_file(input), input); !inserted)
+						{
+							std::cerr << it->second << " and " << input << " would both be compiled to " << it->first << std::endl;
+							exit(1);
+						}
+					return;
+				}
+				this->input_file = this->input_files.front();
+				if (this->output_file.empty())
+					this->output_file = this->preprocess_only ? "out.i" : this->emit_pch ? "out.pch" : this->emit_tac ? "out.tac" : this->emit_obj ? "out.o" : "out.s";
 				return;
 		}
-}
\ No newline at end of file
+}
+
+std::string CommandLine::get_output_file(const std::string &input) const {
+	std::string name = input.substr(input.find_last_of('/') + 1);
+	if (size_t dot = name.find_last_of('.'); dot != std::string::npos && dot != 0)
+		name.erase(dot);
+	return name + (this->preprocess_only ? ".i" : this->emit_pch ? ".pch" : this->emit_tac ? ".tac" : this->emit_obj ? ".o" : ".s");
+}
@@ -1,11 +1,33 @@
 #ifndef FT_YACC_POC_COMMANDLINE_HPP
 #define FT_YACC_POC_COMMANDLINE_HPP
 #include <string>
+#include <vector>
 
 struct CommandLine {
-	std::string input_file;
+	std::string input_file; // file being compiled
 	std::string output_file;
+	std::vector<std::string>	input_files; // all the operands, compiled in parallel when there are several
+	bool		verbose_asm; // -fverbose-asm: keep a blank line between the translation of each tac instruction
+	bool		time_report; // -ftime-report: print the time spent in each phase and by the slowest functions
+	bool		mem_report; // -fmem-report: print the heap memory used by each subsystem at the end
+	bool		mem_report_phases; // -fmem-report-phases: same as -fmem-report, also after each phase
+	bool		emit_obj; // -c, --emit-obj: write an ELF32 relocatable object instead of assembly
+	bool		preprocess_only; // -E: write the preprocessed source
+	bool		dependencies; // -MD: write the included files as a make rule
+	std::string	dependency_file; // -MF: default is the output file with a .d extension
+	std::vector<std::string>	include_paths; // -I
+	std::vector<std::string>	macros; // -D and -U in order, as "Dname=value" or "Uname"
+	int			jobs; // -j: number of threads translating the functions, or of files compiled at once
+	bool		emit_pch; // --emit-pch: write the state of the compiler after the input, a header, instead of code
+	std::string	pch_file; // -include-pch: start from the state saved in this file
+	bool		emit_tac; // --emit-tac: write the tac of the input in the binary format of TacFile instead of code
+	bool		run_tac; // --run-tac: run main through the tac interpreter, the input can also be a tac file
+	bool		fold_pure_calls; // -ffold-pure-calls: replace the calls to pure functions with constant arguments by their result
+	bool		sccp; // -fsccp: propagate the constants through the ssa form of the functions and remove the branches they decide
+	std::string	cache_directory; // --cache-dir: reuse the outputs of the files and functions already compiled
+	std::string	server_socket; // --server: stay resident and compile the jobs sent on this unix socket
 	CommandLine(int argc, char **argv);
+	std::string	get_output_file(const std::string &input) const; // with several inputs: name of the input in the current directory, with the extension of the output
 };
 
 
@@ -0,0 +1,81 @@
+#include "CompilationCache.hpp"
+#include "CommandLine.hpp"
+#include <memory>
+#include <cerrno>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern std::shared_ptr<CommandLine>	commandLine;
+
+namespace CompilationCache {
+
+	// entries are spread in 256 sub-directories named by the first 2 digits of the key
+	static std::string get_path(const std::string &key) {
+		return commandLine->cache_directory + "/" + key.substr(0, 2) + "/" + key.substr(2);
+	}
+
+	bool enabled() {
+		return !commandLine->cache_directory.empty();
+	}
+
+	Hash new_key(std::string_view kind) {
+		// a new build of the compiler may translate differently, it is recognized by the size and date of the binary
+		static const struct stat compiler = [] {
+			struct stat st = {};
+			stat("/proc/self/exe", &st);
+			return st;
+		}();
+		Hash h;
+		h.put("cc1 cache 1").put(kind);
+		h.put(compiler.st_size).put(compiler.st_mtim.tv_sec).put(compiler.st_mtim.tv_nsec);
+		h.put(commandLine->emit_obj).put(commandLine->verbose_asm).put(commandLine->fold_pure_calls).put(commandLine->sccp);
+		return h;
+	}
+
+	bool load(const std::string &key, std::string &data) {
+		int fd = open(get_path(key).c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+		data.clear();
+		char buf[1 << 16];
+		ssize_t ret;
+		while ((ret = read(fd, buf, sizeof(buf))) != 0)
+		{
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret < 0)
+			{
+				close(fd);
+				return false;
+			}
+			data.append(buf, ret);
+		}
+		close(fd);
+		return true;
+	}
+
+	void store(const std::string &key, std::string_view data) {
+		std::string path = get_path(key);
+		std::string directory = path.substr(0, path.rfind('/'));
+		mkdir(commandLine->cache_directory.c_str(), 0755);
+		mkdir(directory.c_str(), 0755);
+		std::string tmp = directory + "/.tmp.XXXXXX";
+		int fd = mkstemp(tmp.data());
+		if (fd < 0)
+			return;
+		size_t written = 0;
+		while (written < data.size())
+		{
+			ssize_t ret = write(fd, data.data() + written, data.size() - written);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				break;
+			written += ret;
+		}
+		fchmod(fd, 0644);
+		if (close(fd) < 0 || written != data.size() || rename(tmp.c_str(), path.c_str()) < 0)
+			unlink(tmp.c_str());
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef CC1_POC_COMPILATIONCACHE_HPP
+#define CC1_POC_COMPILATIONCACHE_HPP
+#include "Hash.hpp"
+#include <string>
+#include <string_view>
+
+// On-disk cache of compilation results in the directory given by --cache-dir, an entry is named by the hash of
+// everything its content depends on. Whole translation units are keyed by their preprocessed text and the options
+// which change the output, functions by their tac and the layout of the objects they use (see
+// FileGenerator::get_function_code). Entries are written to a temporary file then renamed, so concurrent compilers
+// sharing the directory only ever see complete entries.
+namespace CompilationCache {
+	bool	enabled();
+	Hash	new_key(std::string_view kind); // hash of the compiler itself and of the options which change the output
+	bool	load(const std::string &key, std::string &data);
+	void	store(const std::string &key, std::string_view data); // failures are ignored, the cache is only an optimization
+}
+
+#endif
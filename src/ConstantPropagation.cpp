@@ -0,0 +1,437 @@
+#include "ConstantPropagation.hpp"
+#include "Interpreter.hpp"
+#include "Ssa.hpp"
+#include <algorithm>
+#include <array>
+
+namespace TAC {
+	struct Lattice {
+		enum State {
+			TOP, // not defined yet
+			CONSTANT,
+			BOTTOM, // not a constant
+		};
+		State		state = TOP;
+		uintmax_t	value = 0;
+
+		friend bool operator==(const Lattice &, const Lattice &) = default;
+	};
+
+	static const Lattice	bottom{Lattice::BOTTOM};
+
+	// size and signedness of the variables whose values are tracked, a size of 0 for the others
+	struct Scalar {
+		size_t	size = 0;
+		bool	sign = false;
+	};
+
+	static Scalar	scalar(const Types::CType &t) {
+		if (auto *name = get_if<Types::Typename>(&t.type))
+		{
+			auto *o = symbolTable.retrieve_ordinary(name->name);
+			return o && o->storage == SymbolTable::Ordinary::TYPEDEF ? scalar(o->type) : Scalar{};
+		}
+		if (auto *plain = get_if<Types::PlainType>(&t.type))
+		{
+			if (plain->base != Types::PlainType::CHAR && plain->base != Types::PlainType::SHORT_INT &&
+				plain->base != Types::PlainType::INT && plain->base != Types::PlainType::LONG_INT)
+				return {};
+		}
+		else if (!holds_alternative<Types::Pointer>(t.type))
+			return {};
+		size_t size = symbolTable.size_of(t);
+		if (size != 1 && size != 2 && size != 4)
+			return {};
+		return {size, Types::is_signed(t)};
+	}
+
+	class ConstantPropagation {
+	private:
+		TacFunction						&function;
+		const std::vector<Instruction>	&instructions;
+		SsaForm							ssa;
+		const ControlFlowGraph			&cfg;
+		std::vector<Scalar>				variables;
+		std::vector<Lattice>			values;
+		std::vector<std::vector<int>>	users; // instructions reading each value, and the phis as -1 - phi
+		std::vector<bool>				executable; // blocks
+		std::vector<std::vector<bool>>	executable_edges; // from each predecessor of each block, then from the entry
+		std::vector<int>				block_worklist;
+		std::vector<int>				value_worklist;
+
+		Lattice	operand(size_t index, int operand, size_t size, bool sign) const;
+		Lattice	truth(size_t index, int operand) const;
+		Lattice	evaluate(size_t index) const;
+		Lattice	condition(size_t index) const;
+		int		target(size_t index) const;
+		int		next(int block) const;
+		void	set(int value, Lattice);
+		void	add_edge(int from, int to);
+		void	visit_phi(int phi);
+		void	visit_instruction(size_t index);
+		void	propagate();
+		bool	rewrite();
+	public:
+		explicit ConstantPropagation(TacFunction &);
+
+		bool	run(); // true if the function changed
+	};
+
+	ConstantPropagation::ConstantPropagation(TacFunction &f) :
+		function(f),
+		instructions(f.get_instructions()),
+		ssa(f),
+		cfg(ssa.get_cfg())
+	{
+		for (auto &a : this->ssa.get_variables())
+			this->variables.push_back(holds_alternative<int>(a) ? scalar(*f.get_temps()[get<int>(a)]) : scalar(get<SymbolTable::Ordinary *>(a)->type));
+		this->values.resize(this->ssa.get_values().size());
+		for (size_t v = 0; v < this->variables.size(); v++)
+			this->values[v] = bottom; // the values on entry, parameters or not initialized
+		this->users.resize(this->values.size());
+		for (size_t i = 0; i < this->instructions.size(); i++)
+			for (int k = 0; k < 2; k++)
+				if (int v = this->ssa.get_use(i, k); v >= 0)
+					this->users[v].push_back(i);
+		for (size_t p = 0; p < this->ssa.get_phis().size(); p++)
+			for (int v : this->ssa.get_phis()[p].operands)
+				if (v >= 0)
+					this->users[v].push_back(-1 - (int)p);
+		const auto &blocks = this->cfg.get_blocks();
+		this->executable.resize(blocks.size());
+		for (size_t b = 0; b < blocks.size(); b++)
+			this->executable_edges.emplace_back(blocks[b].predecessors.size() + (b == 0));
+	}
+
+	// value of an operand loaded in size bytes
+	Lattice ConstantPropagation::operand(size_t index, int operand, size_t size, bool sign) const {
+		const Address &a = operand ? this->instructions[index].oper2 : this->instructions[index].oper1;
+		if (auto *c = get_if<const SymbolTable::Constant *>(&a))
+			return (*c)->value.index() == 1 ? Lattice{Lattice::CONSTANT, normalize(get<uintmax_t>((*c)->value), size, sign)} : bottom;
+		int v = this->ssa.get_use(index, operand);
+		if (v < 0)
+			return bottom;
+		Lattice ret = this->values[v];
+		if (ret.state == Lattice::CONSTANT)
+			ret.value = normalize(ret.value, size, sign);
+		return ret;
+	}
+
+	// whether an operand of a logical operator is not 0, it is compared in place whatever the size of the operation
+	Lattice ConstantPropagation::truth(size_t index, int operand) const {
+		Lattice ret = this->operand(index, operand, PTR_SIZE, false);
+		ret.value = ret.value != 0;
+		return ret;
+	}
+
+	// result of an instruction as the generated code computes it, before it is stored
+	Lattice ConstantPropagation::evaluate(size_t index) const {
+		const Instruction &i = this->instructions[index];
+		size_t size = i.operation_size;
+		bool sign = i.operation_sign;
+
+		if (i.op == LOGICAL_AND || i.op == LOGICAL_OR)
+		{
+			Lattice a = this->truth(index, 0), b = this->truth(index, 1);
+			uintmax_t absorbing = i.op == LOGICAL_OR;
+			if ((a.state == Lattice::CONSTANT && a.value == absorbing) || (b.state == Lattice::CONSTANT && b.value == absorbing))
+				return {Lattice::CONSTANT, absorbing};
+			if (a.state != Lattice::CONSTANT || b.state != Lattice::CONSTANT)
+				return a.state == Lattice::BOTTOM || b.state == Lattice::BOTTOM ? bottom : Lattice{};
+			return {Lattice::CONSTANT, !absorbing};
+		}
+		if (i.op == LOGICAL_NOT)
+		{
+			Lattice a = this->truth(index, 0);
+			a.value = !a.value;
+			return a;
+		}
+		if (size != 1 && size != 2 && size != 4)
+			return bottom;
+		if (i.op == ASSIGN || i.op == NEG || i.op == BITWISE_NOT)
+		{
+			Lattice a = this->operand(index, 0, size, sign);
+			if (i.op == NEG)
+				a.value = -a.value;
+			else if (i.op == BITWISE_NOT)
+				a.value = ~a.value;
+			a.value = normalize(a.value, size, sign);
+			return a;
+		}
+		if (!i.is_bop())
+			return bottom;
+		Lattice a = this->operand(index, 0, size, sign), b = this->operand(index, 1, size, sign);
+		if (a.state != Lattice::CONSTANT || b.state != Lattice::CONSTANT)
+			return a.state == Lattice::BOTTOM || b.state == Lattice::BOTTOM ? bottom : Lattice{};
+		// the generated division zero extends the dividend, and a byte one uses a stale AH
+		if ((i.op == DIV || i.op == MOD) && (size == 1 || !b.value || (sign && (intmax_t)a.value < 0)))
+			return bottom;
+		uintmax_t r = TAC::evaluate(i.op, a.value, b.value, size, sign);
+		if (i.op >= LESSER && i.op <= NOT_EQUAL)
+			return {Lattice::CONSTANT, r};
+		return {Lattice::CONSTANT, normalize(r, size, sign)};
+	}
+
+	// whether a conditional jump is taken, only the equality ones are translated right
+	Lattice ConstantPropagation::condition(size_t index) const {
+		const Instruction &i = this->instructions[index];
+		if ((i.op != JUMP_EQUAL && i.op != JUMP_NOT_EQUAL) || (i.operation_size != 1 && i.operation_size != 2 && i.operation_size != 4))
+			return bottom;
+		Lattice a = this->operand(index, 0, i.operation_size, i.operation_sign);
+		Lattice b = this->operand(index, 1, i.operation_size, i.operation_sign);
+		if (a.state != Lattice::CONSTANT || b.state != Lattice::CONSTANT)
+			return a.state == Lattice::BOTTOM || b.state == Lattice::BOTTOM ? bottom : Lattice{};
+		return {Lattice::CONSTANT, (a.value == b.value) == (i.op == JUMP_EQUAL)};
+	}
+
+	// block jumped to, -1 when the jump leaves the function
+	int ConstantPropagation::target(size_t index) const {
+		int position = this->function.get_labels()[get<Label>(this->instructions[index].ret)];
+		return position >= 0 && position < (int)this->instructions.size() ? this->cfg.get_block(position) : -1;
+	}
+
+	// block following another in the instructions, -1 after the last one
+	int ConstantPropagation::next(int block) const {
+		size_t end = this->cfg.get_blocks()[block].end;
+		return end < this->instructions.size() ? this->cfg.get_block(end) : -1;
+	}
+
+	// the values only go down the lattice, which bounds the number of times they change
+	void ConstantPropagation::set(int value, Lattice l) {
+		Lattice &current = this->values[value];
+		if (current.state == Lattice::BOTTOM || l.state == Lattice::TOP || current == l)
+			return;
+		if (current.state == Lattice::CONSTANT)
+			l = bottom;
+		current = l;
+		this->value_worklist.push_back(value);
+	}
+
+	void ConstantPropagation::add_edge(int from, int to) {
+		if (to < 0)
+			return;
+		const auto &predecessors = this->cfg.get_blocks()[to].predecessors;
+		size_t edge = std::find(predecessors.begin(), predecessors.end(), from) - predecessors.begin();
+		if (this->executable_edges[to][edge])
+			return;
+		this->executable_edges[to][edge] = true;
+		this->block_worklist.push_back(to);
+	}
+
+	void ConstantPropagation::visit_phi(int p) {
+		const SsaForm::Phi &phi = this->ssa.get_phis()[p];
+		Lattice l;
+		for (size_t edge = 0; edge < phi.operands.size(); edge++)
+		{
+			if (!this->executable_edges[phi.block][edge])
+				continue;
+			const Lattice &operand = this->values[phi.operands[edge]];
+			if (operand.state == Lattice::BOTTOM || (l.state == Lattice::CONSTANT && operand.state == Lattice::CONSTANT && operand.value != l.value))
+			{
+				l = bottom;
+				break;
+			}
+			if (operand.state == Lattice::CONSTANT)
+				l = operand;
+		}
+		this->set(phi.value, l);
+	}
+
+	void ConstantPropagation::visit_instruction(size_t index) {
+		const Instruction &i = this->instructions[index];
+		if (int value = this->ssa.get_definition(index); value >= 0)
+		{
+			const Scalar &variable = this->variables[this->ssa.get_values()[value].variable];
+			Lattice l = variable.size ? this->evaluate(index) : bottom;
+			if (l.state == Lattice::CONSTANT) // stored in the variable as it is loaded back
+				l.value = normalize(l.value, variable.size, variable.sign);
+			this->set(value, l);
+		}
+
+		int block = this->cfg.get_block(index);
+		if (index + 1 != this->cfg.get_blocks()[block].end || i.op == RETURN)
+			return;
+		if (i.op == JUMP)
+			this->add_edge(block, this->target(index));
+		else if (i.is_jump())
+		{
+			Lattice taken = this->condition(index);
+			if (taken.state != Lattice::CONSTANT || taken.value)
+				this->add_edge(block, this->target(index));
+			if (taken.state != Lattice::CONSTANT || !taken.value)
+				this->add_edge(block, this->next(block));
+		}
+		else
+			this->add_edge(block, this->next(block));
+	}
+
+	void ConstantPropagation::propagate() {
+		const auto &blocks = this->cfg.get_blocks();
+		this->executable_edges[0].back() = true;
+		this->block_worklist.push_back(0);
+		while (!this->block_worklist.empty() || !this->value_worklist.empty())
+		{
+			while (!this->block_worklist.empty())
+			{
+				int b = this->block_worklist.back();
+				this->block_worklist.pop_back();
+				for (int p : this->ssa.get_block_phis(b))
+					this->visit_phi(p);
+				if (this->executable[b])
+					continue;
+				this->executable[b] = true;
+				for (size_t i = blocks[b].begin; i < blocks[b].end; i++)
+					this->visit_instruction(i);
+			}
+			while (!this->value_worklist.empty())
+			{
+				int v = this->value_worklist.back();
+				this->value_worklist.pop_back();
+				for (int user : this->users[v])
+					if (user < 0 && this->executable[this->ssa.get_phis()[-1 - user].block])
+						this->visit_phi(-1 - user);
+					else if (user >= 0 && this->executable[this->cfg.get_block(user)])
+						this->visit_instruction(user);
+			}
+		}
+	}
+
+	bool ConstantPropagation::rewrite() {
+		const auto &blocks = this->cfg.get_blocks();
+		const auto &ssa_values = this->ssa.get_values();
+		std::vector<bool> erased(this->instructions.size());
+		std::vector<std::array<bool, 2>> used(this->instructions.size(), {true, true}); // the operands still read
+		bool changed = false;
+
+		for (size_t b = 0; b < blocks.size(); b++)
+			if (!this->executable[b])
+				for (size_t i = blocks[b].begin; i < blocks[b].end; i++)
+					erased[i] = changed = true;
+
+		for (size_t index = 0; index < this->instructions.size(); index++)
+		{
+			if (erased[index])
+				continue;
+			Instruction i = this->instructions[index];
+			if (i.is_jump() && i.op != JUMP)
+			{
+				Lattice taken = this->condition(index);
+				if (taken.state == Lattice::CONSTANT)
+				{
+					if (taken.value)
+					{
+						Instruction jump{};
+						jump.ret = i.ret;
+						jump.op = JUMP;
+						this->function.set_instruction(index, jump);
+					}
+					else
+						erased[index] = true;
+					used[index] = {false, false};
+					changed = true;
+					continue;
+				}
+			}
+			if (int value = this->ssa.get_definition(index); value >= 0 && this->values[value].state == Lattice::CONSTANT)
+			{
+				const Scalar &variable = this->variables[ssa_values[value].variable];
+				const SymbolTable::Constant *c = CONST(normalize(this->values[value].value, variable.size, false));
+				if (i.op != ASSIGN || i.oper1 != Address(c) || i.operation_size != variable.size)
+				{
+					this->function.set_instruction(index, {i.ret, ASSIGN, c, {}, variable.size, variable.sign});
+					changed = true;
+				}
+				used[index] = {false, false};
+				continue;
+			}
+			// the constants read by the operations which load their operands in registers
+			bool loaded = (i.is_bop() && i.op != LOGICAL_AND && i.op != LOGICAL_OR) || i.op == JUMP_EQUAL || i.op == JUMP_NOT_EQUAL ||
+				i.op == ASSIGN || i.op == RETURN || i.op == PARAM || i.op == NEG || i.op == BITWISE_NOT;
+			if (!loaded || (i.operation_size != 1 && i.operation_size != 2 && i.operation_size != 4))
+				continue;
+			bool substituted = false;
+			for (int k = 0; k < 2; k++)
+			{
+				int v = this->ssa.get_use(index, k);
+				if (v < 0 || this->values[v].state != Lattice::CONSTANT)
+					continue;
+				(k ? i.oper2 : i.oper1) = CONST(normalize(this->values[v].value, i.operation_size, false));
+				used[index][k] = false;
+				substituted = true;
+			}
+			if (substituted)
+			{
+				this->function.set_instruction(index, i);
+				changed = true;
+			}
+		}
+
+		// mark and sweep of the values: the definitions without side effects of values nothing reads go away
+		std::vector<bool> live(ssa_values.size());
+		std::vector<int> worklist;
+		auto mark_operands = [&](size_t index) {
+			for (int k = 0; k < 2; k++)
+				if (int v = this->ssa.get_use(index, k); v >= 0 && used[index][k] && !live[v])
+				{
+					live[v] = true;
+					worklist.push_back(v);
+				}
+		};
+		auto removable = [&](size_t index) {
+			Operation op = this->instructions[index].op;
+			return this->ssa.get_definition(index) >= 0 && op >= ADD && op <= ADDRESS && op != DEREFERENCE;
+		};
+		for (size_t index = 0; index < this->instructions.size(); index++)
+			if (!erased[index] && !removable(index))
+				mark_operands(index);
+		while (!worklist.empty())
+		{
+			const SsaForm::Value &value = ssa_values[worklist.back()];
+			worklist.pop_back();
+			if (value.instruction >= 0)
+				mark_operands(value.instruction);
+			else if (value.phi >= 0)
+			{
+				const SsaForm::Phi &phi = this->ssa.get_phis()[value.phi];
+				for (size_t edge = 0; edge < phi.operands.size(); edge++)
+					if (int v = phi.operands[edge]; v >= 0 && this->executable_edges[phi.block][edge] && !live[v])
+					{
+						live[v] = true;
+						worklist.push_back(v);
+					}
+			}
+		}
+		for (size_t index = 0; index < this->instructions.size(); index++)
+			if (!erased[index] && removable(index) && !live[this->ssa.get_definition(index)])
+				erased[index] = changed = true;
+		if (!changed)
+			return false;
+		this->function.erase_instructions(erased);
+
+		// the jumps left to the next instruction
+		const auto &labels = this->function.get_labels();
+		for (bool jumps = true; jumps;)
+		{
+			jumps = false;
+			std::vector<bool> next(this->instructions.size());
+			for (size_t index = 0; index < this->instructions.size(); index++)
+				if (this->instructions[index].op == JUMP && labels[get<Label>(this->instructions[index].ret)] == (int)index + 1)
+					next[index] = jumps = true;
+			if (jumps)
+				this->function.erase_instructions(next);
+		}
+		return true;
+	}
+
+	bool ConstantPropagation::run() {
+		if (this->instructions.empty())
+			return false;
+		this->propagate();
+		return this->rewrite();
+	}
+
+	void propagate_constants() {
+		for (auto &f : functions)
+			ConstantPropagation(f).run();
+	}
+}
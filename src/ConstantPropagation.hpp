@@ -0,0 +1,15 @@
+#ifndef CC1_POC_CONSTANTPROPAGATION_HPP
+#define CC1_POC_CONSTANTPROPAGATION_HPP
+#include "TAC.hpp"
+
+namespace TAC {
+
+	// Sparse conditional constant propagation (Wegman and Zadeck) on the ssa form of each function: a value is assumed
+	// undefined until an executable instruction defines it, a block unreachable until an executable edge enters it, so
+	// that a constant which decides a branch makes the other side dead. The constant values replace their definitions
+	// and their uses, then the dead blocks and branches and the definitions left unused are removed.
+	// The arithmetic is folded as the generated code computes it, on the integers and pointers of 1, 2 or 4 bytes.
+	void	propagate_constants();
+}
+
+#endif
@@ -0,0 +1,154 @@
+#include "ControlFlow.hpp"
+#include <algorithm>
+
+namespace TAC {
+	ControlFlowGraph::ControlFlowGraph(const TacFunction &f) {
+		const auto &instructions = f.get_instructions();
+		const auto &labels = f.get_labels();
+		size_t size = instructions.size();
+
+		std::vector<bool> leader(size + 1);
+		leader[0] = true;
+		for (int l : labels)
+			if (l >= 0)
+				leader[l] = true;
+		for (size_t i = 0; i < size; i++)
+			if (instructions[i].is_jump() || instructions[i].op == RETURN)
+				leader[i + 1] = true;
+
+		this->block_of.resize(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			if (leader[i])
+				this->blocks.push_back({i, i, {}, {}});
+			this->blocks.back().end = i + 1;
+			this->block_of[i] = this->blocks.size() - 1;
+		}
+
+		for (size_t b = 0; b < this->blocks.size(); b++)
+		{
+			const Instruction &last = instructions[this->blocks[b].end - 1];
+			auto add_edge = [&](size_t to) {
+				if (to >= size)
+					return;
+				int successor = this->block_of[to];
+				this->blocks[b].successors.push_back(successor);
+				this->blocks[successor].predecessors.push_back(b);
+			};
+			if (last.is_jump() && labels[get<Label>(last.ret)] >= 0)
+				add_edge(labels[get<Label>(last.ret)]);
+			if (last.op != JUMP && last.op != RETURN && !(last.is_jump() && labels[get<Label>(last.ret)] == (int)this->blocks[b].end))
+				add_edge(this->blocks[b].end);
+		}
+		this->compute_dominators();
+	}
+
+	void ControlFlowGraph::compute_dominators() {
+		this->immediate_dominators.assign(this->blocks.size(), -1);
+		if (this->blocks.empty())
+			return;
+
+		// postorder without recursion, a block is left when its last successor has been visited
+		std::vector<bool> visited(this->blocks.size());
+		std::vector<std::pair<int, size_t>> stack{{0, 0}};
+		visited[0] = true;
+		while (!stack.empty())
+		{
+			auto &[b, next] = stack.back();
+			if (next < this->blocks[b].successors.size())
+			{
+				int s = this->blocks[b].successors[next++];
+				if (!visited[s])
+				{
+					visited[s] = true;
+					stack.push_back({s, 0});
+				}
+				continue;
+			}
+			this->order.push_back(b);
+			stack.pop_back();
+		}
+		std::reverse(this->order.begin(), this->order.end());
+		std::vector<int> position(this->blocks.size());
+		for (size_t i = 0; i < this->order.size(); i++)
+			position[this->order[i]] = i;
+
+		auto &idom = this->immediate_dominators;
+		auto intersect = [&](int a, int b) {
+			while (a != b)
+			{
+				while (position[a] > position[b])
+					a = idom[a];
+				while (position[b] > position[a])
+					b = idom[b];
+			}
+			return a;
+		};
+		idom[0] = 0;
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+			for (size_t i = 1; i < this->order.size(); i++)
+			{
+				int b = this->order[i];
+				int dominator = -1;
+				for (int p : this->blocks[b].predecessors)
+					if (idom[p] >= 0)
+						dominator = dominator < 0 ? p : intersect(p, dominator);
+				if (idom[b] != dominator)
+				{
+					idom[b] = dominator;
+					changed = true;
+				}
+			}
+		}
+		idom[0] = -1;
+	}
+
+	const std::vector<ControlFlowGraph::Block> &ControlFlowGraph::get_blocks() const {
+		return this->blocks;
+	}
+
+	int ControlFlowGraph::get_block(size_t instruction) const {
+		return this->block_of[instruction];
+	}
+
+	const std::vector<int> &ControlFlowGraph::get_reverse_postorder() const {
+		return this->order;
+	}
+
+	bool ControlFlowGraph::is_reachable(int block) const {
+		return block == 0 || this->immediate_dominators[block] >= 0;
+	}
+
+	int ControlFlowGraph::get_immediate_dominator(int block) const {
+		return this->immediate_dominators[block];
+	}
+
+	std::vector<std::vector<int>> ControlFlowGraph::get_dominator_tree() const {
+		std::vector<std::vector<int>> children(this->blocks.size());
+		for (int b : this->order)
+			if (this->immediate_dominators[b] >= 0)
+				children[this->immediate_dominators[b]].push_back(b);
+		return children;
+	}
+
+	// the blocks where the dominance of each block ends: a join reached from a block it doesn't dominate
+	std::vector<std::vector<int>> ControlFlowGraph::get_dominance_frontiers() const {
+		std::vector<std::vector<int>> frontiers(this->blocks.size());
+		for (int b : this->order)
+		{
+			if (this->blocks[b].predecessors.size() < 2)
+				continue;
+			for (int p : this->blocks[b].predecessors)
+				for (int runner = p; this->is_reachable(p) && runner != this->immediate_dominators[b]; runner = this->immediate_dominators[runner])
+				{
+					if (std::find(frontiers[runner].begin(), frontiers[runner].end(), b) == frontiers[runner].end())
+						frontiers[runner].push_back(b);
+					if (runner == 0)
+						break;
+				}
+		}
+		return frontiers;
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef CC1_POC_CONTROLFLOW_HPP
+#define CC1_POC_CONTROLFLOW_HPP
+#include "TAC.hpp"
+
+namespace TAC {
+
+	// Basic blocks of a function, in the order of the instructions: a block starts at the first instruction, at a
+	// label and after a jump or a return. A jump to a label which is past the last instruction leaves the function.
+	// The dominators are computed as by Cooper, Harvey and Kennedy, on the blocks reachable from the first one.
+	class ControlFlowGraph {
+	public:
+		struct Block {
+			size_t				begin; // index of the first instruction
+			size_t				end; // index past the last instruction
+			std::vector<int>	successors;
+			std::vector<int>	predecessors;
+		};
+	private:
+		std::vector<Block>	blocks;
+		std::vector<int>	block_of; // block of each instruction
+		std::vector<int>	order; // reachable blocks in reverse postorder
+		std::vector<int>	immediate_dominators; // -1 for the first block and the unreachable ones
+
+		void	compute_dominators();
+	public:
+		explicit ControlFlowGraph(const TacFunction &);
+
+		const std::vector<Block>	&get_blocks() const;
+		int							get_block(size_t instruction) const;
+		const std::vector<int>		&get_reverse_postorder() const;
+		bool						is_reachable(int block) const;
+		int							get_immediate_dominator(int block) const;
+		std::vector<std::vector<int>>	get_dominator_tree() const; // children of each block
+		std::vector<std::vector<int>>	get_dominance_frontiers() const;
+	};
+}
+
+#endif
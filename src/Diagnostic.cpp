@@ -1,35 +1,33 @@
 #include "Diagnostic.hpp"
-#include <stack>
 #include <map>
 #include <memory>
 #include "CommandLine.hpp"
-#include "scanner.yy.hpp"
+#include "SourceFile.hpp"
 
 extern std::shared_ptr<CommandLine>	commandLine;
-extern std::shared_ptr<yyLexer>		lexer;
+extern std::shared_ptr<SourceFile>	source;
 
 Diagnostic::Error::Error(std::string f, std::string fl, size_t l, size_t c, std::string d, Diagnostic::Error::Severity s) : file(f), full_line(fl), lineno(l), column(c), description(d), severity(s) {}
 
 static std::string	get_full_line()
 {
-	std::string current_line = lexer->yyline_begin + lexer->text();
-	std::stack<char> unput_stack;
-	while (!current_line.ends_with('\n'))
-	{
-		char c = lexer->input();
-		current_line.push_back(c);
-		unput_stack.push(c);
-	}
-	for (;!unput_stack.empty();unput_stack.pop())
-		lexer->unput(unput_stack.top());
-	return current_line;
+	std::string line(source->get_line(source->get_token_offset()));
+	if (!line.ends_with('\n'))
+		line.push_back('\n');
+	return line;
+}
+
+static std::string	get_file_name()
+{
+	std::string_view name = source->get_filename(source->get_token_offset());
+	return name.empty() ? commandLine->input_file : std::string(name);
 }
 
 Diagnostic::Error::Error(std::string d, Error::Severity s) {
-	file = commandLine->input_file;
+	file = get_file_name();
 	full_line =  get_full_line();
-	lineno = lexer->yylineno;
-	column = lexer->yycolno;
+	lineno = source->get_lineno(source->get_token_offset());
+	column = source->get_column(source->get_token_offset());
 	description = d;
 	severity = s;
 }
@@ -39,7 +37,7 @@ int Diagnostic::Error::print() const {
 	margin += 8 - (margin + 1) % 8;
 	return printf("%*s:%zu:%zu: %s\n", margin,this->file.c_str(), this->lineno, this->column, this->description.c_str())
 	+ printf("%*zu |%s", margin - 1, this->lineno, this->full_line.c_str())
-	+ printf("%*c |%*c", margin - 1, ' ', this->column + 1, '^');
+	+ printf("%*c |%*c", margin - 1, ' ', (int)this->column + 1, '^');
 }
 
 
@@ -47,10 +45,10 @@ int Diagnostic::Error::print() const {
 void Diagnostic::emit_error(std::string description, Error::Severity severity)
 {
 	Error e{
-		commandLine->input_file,
+		get_file_name(),
 		get_full_line(),
-		lexer->yylineno,
-		lexer->yycolno,
+		source->get_lineno(source->get_token_offset()),
+		source->get_column(source->get_token_offset()),
 		description,
 		severity
 	};
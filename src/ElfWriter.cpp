@@ -0,0 +1,224 @@
+#include "ElfWriter.hpp"
+#include <elf.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace CodeGeneration
+{
+	ElfWriter::ElfWriter() :
+		sections{
+			{".text", SHF_ALLOC | SHF_EXECINSTR, 16, 0, {}, {}},
+			{".data", SHF_ALLOC | SHF_WRITE, 4, 0, {}, {}},
+			{".rodata", SHF_ALLOC, 1, 0, {}, {}},
+			{".rodata.str1.1", SHF_ALLOC | SHF_MERGE | SHF_STRINGS, 1, 1, {}, {}},
+		},
+		current(TEXT)
+	{}
+
+	void ElfWriter::set_section(SectionId s) {
+		this->current = s;
+	}
+
+	void ElfWriter::define_symbol(const std::string &name, bool global, bool function, size_t size) {
+		this->symbols.push_back({name, this->current, (uint32_t)this->section().bytes.size(), (uint32_t)size, global, function});
+	}
+
+	void ElfWriter::define_constant(int id) {
+		this->constants[id] = {this->current, (uint32_t)this->section().bytes.size()};
+	}
+
+	void ElfWriter::alias_constant(int id, int target, uint32_t offset) {
+		ConstantLocation location = this->constants.at(target);
+		this->constants[id] = {location.section, location.offset + offset};
+	}
+
+	void ElfWriter::put_bytes(const void *data, size_t size) {
+		auto &bytes = this->section().bytes;
+		bytes.insert(bytes.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+	}
+
+	void ElfWriter::put_zero(size_t size) {
+		this->section().bytes.resize(this->section().bytes.size() + size);
+	}
+
+	// 4 bytes absolute address of a symbol or a constant
+	void ElfWriter::put_reference(const Relocation &r) {
+		Relocation reloc = r;
+		reloc.offset = this->section().bytes.size();
+		reloc.type = R_386_32;
+		this->section().relocations.push_back(reloc);
+		this->put_value<uint32_t>(0);
+	}
+
+	// append the code of a function to .text, the offsets of its relocations are relative to the start of the code
+	void ElfWriter::put_code(const std::vector<uint8_t> &code, const std::vector<Relocation> &relocations) {
+		Section &text = this->sections[TEXT];
+		uint32_t base = text.bytes.size();
+		text.bytes.insert(text.bytes.end(), code.begin(), code.end());
+		for (auto r : relocations)
+		{
+			r.offset += base;
+			text.relocations.push_back(r);
+		}
+	}
+
+	static uint32_t align(uint32_t n, uint32_t a) {
+		return (n + a - 1) & ~(a - 1);
+	}
+
+	static uint32_t add_string(std::string &table, const std::string &s) {
+		uint32_t ret = table.size();
+		table += s;
+		table += '\0';
+		return ret;
+	}
+
+	void ElfWriter::write(OutputBuffer &out) {
+		// section header indexes, the first sections are the ones of SectionId shifted by one
+		enum {
+			NULL_SECTION,
+			REL_TEXT = SECTION_COUNT + 1,
+			REL_DATA,
+			SYMTAB,
+			STRTAB,
+			NOTE_STACK,
+			SHSTRTAB,
+			SECTION_HEADERS_COUNT
+		};
+
+		// symbol table: null symbol, section symbols, locals then globals
+		std::string strtab(1, '\0');
+		std::vector<Elf32_Sym> symtab(1 + SECTION_COUNT, Elf32_Sym{});
+		for (int s = 0; s < SECTION_COUNT; s++)
+		{
+			symtab[1 + s].st_info = ELF32_ST_INFO(STB_LOCAL, STT_SECTION);
+			symtab[1 + s].st_shndx = 1 + s;
+		}
+		std::map<std::string_view, uint32_t> indexes;
+		uint32_t first_global = 0;
+		for (int global = 0; global < 2; global++)
+		{
+			if (global)
+				first_global = symtab.size();
+			for (auto &s : this->symbols)
+			{
+				if (s.global != (bool)global)
+					continue;
+				Elf32_Sym sym{};
+				sym.st_name = add_string(strtab, s.name);
+				sym.st_value = s.value;
+				sym.st_size = s.size;
+				sym.st_info = ELF32_ST_INFO(global ? STB_GLOBAL : STB_LOCAL, s.function ? STT_FUNC : STT_OBJECT);
+				sym.st_shndx = 1 + s.section;
+				indexes[s.name] = symtab.size();
+				symtab.push_back(sym);
+			}
+		}
+
+		// relocations, symbols which are referenced but not defined are undefined globals
+		std::vector<Elf32_Rel> rels[SECTION_COUNT];
+		for (int s = 0; s < SECTION_COUNT; s++)
+			for (auto &r : this->sections[s].relocations)
+			{
+				uint32_t sym;
+				if (r.target == Relocation::CONSTANT)
+				{
+					auto it = this->constants.find(r.constant);
+					if (it == this->constants.end())
+						throw std::runtime_error("object writer: undefined constant .LC" + std::to_string(r.constant));
+					uint32_t addend;
+					memcpy(&addend, &this->sections[s].bytes[r.offset], 4);
+					addend += it->second.offset;
+					memcpy(&this->sections[s].bytes[r.offset], &addend, 4);
+					sym = 1 + it->second.section;
+				}
+				else
+				{
+					auto [it, inserted] = indexes.insert({*r.symbol, symtab.size()});
+					if (inserted)
+					{
+						Elf32_Sym undefined{};
+						undefined.st_name = add_string(strtab, *r.symbol);
+						undefined.st_info = ELF32_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+						undefined.st_shndx = SHN_UNDEF;
+						symtab.push_back(undefined);
+					}
+					sym = it->second;
+				}
+				rels[s].push_back({r.offset, ELF32_R_INFO(sym, r.type)});
+			}
+
+		// section headers and file layout
+		std::string shstrtab(1, '\0');
+		Elf32_Shdr headers[SECTION_HEADERS_COUNT] = {};
+		const void *contents[SECTION_HEADERS_COUNT] = {};
+		uint32_t offset = sizeof(Elf32_Ehdr);
+		auto set_header = [&](int i, uint32_t name, uint32_t type, uint32_t flags, const void *data, uint32_t size, uint32_t a) {
+			headers[i].sh_name = name;
+			headers[i].sh_type = type;
+			headers[i].sh_flags = flags;
+			headers[i].sh_addralign = a;
+			headers[i].sh_size = size;
+			offset = align(offset, a);
+			headers[i].sh_offset = offset;
+			offset += size;
+			contents[i] = data;
+		};
+		for (int s = 0; s < SECTION_COUNT; s++)
+		{
+			set_header(1 + s, add_string(shstrtab, this->sections[s].name), SHT_PROGBITS, this->sections[s].flags, this->sections[s].bytes.data(),
+					   this->sections[s].bytes.size(), this->sections[s].align);
+			headers[1 + s].sh_entsize = this->sections[s].entsize;
+		}
+		for (int s = TEXT; s <= DATA; s++)
+		{
+			int i = s == TEXT ? REL_TEXT : REL_DATA;
+			set_header(i, add_string(shstrtab, std::string(".rel") + this->sections[s].name), SHT_REL, SHF_INFO_LINK, rels[s].data(),
+					   rels[s].size() * sizeof(Elf32_Rel), 4);
+			headers[i].sh_link = SYMTAB;
+			headers[i].sh_info = 1 + s;
+			headers[i].sh_entsize = sizeof(Elf32_Rel);
+		}
+		set_header(SYMTAB, add_string(shstrtab, ".symtab"), SHT_SYMTAB, 0, symtab.data(), symtab.size() * sizeof(Elf32_Sym), 4);
+		headers[SYMTAB].sh_link = STRTAB;
+		headers[SYMTAB].sh_info = first_global;
+		headers[SYMTAB].sh_entsize = sizeof(Elf32_Sym);
+		set_header(STRTAB, add_string(shstrtab, ".strtab"), SHT_STRTAB, 0, strtab.data(), strtab.size(), 1);
+		set_header(NOTE_STACK, add_string(shstrtab, ".note.GNU-stack"), SHT_PROGBITS, 0, nullptr, 0, 1); // non executable stack
+		uint32_t shstrtab_name = add_string(shstrtab, ".shstrtab");
+		set_header(SHSTRTAB, shstrtab_name, SHT_STRTAB, 0, shstrtab.data(), shstrtab.size(), 1);
+		uint32_t headers_offset = align(offset, 4);
+
+		Elf32_Ehdr ehdr{};
+		memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+		ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+		ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+		ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+		ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+		ehdr.e_type = ET_REL;
+		ehdr.e_machine = EM_386;
+		ehdr.e_version = EV_CURRENT;
+		ehdr.e_shoff = headers_offset;
+		ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+		ehdr.e_shentsize = sizeof(Elf32_Shdr);
+		ehdr.e_shnum = SECTION_HEADERS_COUNT;
+		ehdr.e_shstrndx = SHSTRTAB;
+
+		uint32_t written = 0;
+		auto pad_to = [&](uint32_t o) {
+			for (; written < o; written++)
+				out.put('\0');
+		};
+		out.write((const char *)&ehdr, sizeof(ehdr));
+		written = sizeof(ehdr);
+		for (int i = 1; i < SECTION_HEADERS_COUNT; i++)
+		{
+			pad_to(headers[i].sh_offset);
+			if (headers[i].sh_size)
+				out.write((const char *)contents[i], headers[i].sh_size);
+			written += headers[i].sh_size;
+		}
+		pad_to(headers_offset);
+		out.write((const char *)headers, sizeof(headers));
+	}
+}
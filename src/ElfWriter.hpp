@@ -0,0 +1,80 @@
+#ifndef CC1_POC_ELFWRITER_HPP
+#define CC1_POC_ELFWRITER_HPP
+#include "OutputBuffer.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdint>
+
+namespace CodeGeneration
+{
+	// a 32 bit field that must be patched by the linker, the addend is stored in the field itself (SHT_REL)
+	struct Relocation {
+		enum Target {
+			SYMBOL,
+			CONSTANT // .LC<n>, resolved to the section of the constant when the file is written
+		};
+		uint32_t			offset; // in the section (or in the code chunk before it is appended)
+		uint8_t				type; // R_386_32 or R_386_PC32
+		Target				target;
+		const std::string	*symbol; // owned by the symbol table, must outlive the writer
+		int					constant;
+	};
+
+	// Builds an ELF32 relocatable object for i386 in memory and serializes it once everything is generated.
+	class ElfWriter {
+	public:
+		enum SectionId {
+			TEXT,
+			DATA,
+			RODATA,
+			RODATA_STR, // null terminated strings, merged by the linker across objects
+			SECTION_COUNT
+		};
+	private:
+		struct Section {
+			const char				*name;
+			uint32_t				flags;
+			uint32_t				align;
+			uint32_t				entsize;
+			std::vector<uint8_t>	bytes;
+			std::vector<Relocation>	relocations;
+		};
+		struct Symbol {
+			std::string	name;
+			SectionId	section;
+			uint32_t	value;
+			uint32_t	size;
+			bool		global;
+			bool		function;
+		};
+
+		struct ConstantLocation {
+			SectionId	section;
+			uint32_t	offset;
+		};
+
+		Section							sections[SECTION_COUNT];
+		SectionId						current;
+		std::vector<Symbol>				symbols;
+		std::map<int, ConstantLocation>	constants; // by constant id
+
+		Section		&section() { return this->sections[this->current]; }
+	public:
+		ElfWriter();
+
+		void		set_section(SectionId);
+		void		define_symbol(const std::string &name, bool global, bool function, size_t size);
+		void		define_constant(int id);
+		void		alias_constant(int id, int target, uint32_t offset); // id is located offset bytes inside target
+		void		put_bytes(const void *data, size_t size);
+		void		put_zero(size_t size);
+		template <typename T>
+		void		put_value(T value) { this->put_bytes(&value, sizeof(value)); } // host is little endian like the target
+		void		put_reference(const Relocation &);
+		void		put_code(const std::vector<uint8_t> &code, const std::vector<Relocation> &relocations);
+		void		write(OutputBuffer &);
+	};
+}
+
+#endif
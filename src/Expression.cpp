@@ -1,66 +1,17 @@
 #include "Expression.hpp"
+#include "TimeReport.hpp"
 #include <queue>
-#include "Expression.hpp"
+#include <span>
+#include <vector>
 
 namespace Expression {
 
-	bool	type_equivalence(const Types::CType &t1, const Types::CType &t2, bool ignore_qualifier = true)
+	// lvalue-ness is never part of the comparison
+	bool	type_equivalence(Types::TypeId t1, Types::TypeId t2, bool ignore_qualifier)
 	{
-		std::queue<std::pair<const Types::CType*, const Types::CType*>> q;
-		q.emplace(&t1, &t2);
-
-		while (!q.empty())
-		{
-			auto [a, b] = q.front();
-			if (a->type.index() != b->type.index())
-				return false;
-			if (!ignore_qualifier && a->qualifier != b->qualifier)
-				return false;
-			switch (a->type.index())
-			{
-				case 0: // PlainType
-				if (get<Types::PlainType>(a->type) != get<Types::PlainType>(b->type))
-				{
-					if (get<Types::PlainType>(a->type).base != Types::PlainType::VOID || get<Types::PlainType>(b->type).base != Types::PlainType::VOID) // todo
-						return false;
-				}
-				break;
-				case 1: // TagName
-				if (get<Types::TagName>(a->type) != get<Types::TagName>(b->type))
-					return false;
-				break;
-				case 2: // Pointer
-					q.emplace(get<Types::Pointer>(a->type).pointed_type.get(),get<Types::Pointer>(b->type).pointed_type.get());
-				break;
-				case 3: // FunctionType
-					if (get<Types::FunctionType>(a->type).parameters.size() != get<Types::FunctionType>(b->type).parameters.size())
-						return false;
-					q.emplace(get<Types::FunctionType>(a->type).return_type.get(), get<Types::FunctionType>(b->type).return_type.get());
-					for (auto it1 = get<Types::FunctionType>(a->type).parameters.begin(), it2 = get<Types::FunctionType>(b->type).parameters.begin();; it1++, it2++)
-					{
-						if (it1 == get<Types::FunctionType>(a->type).parameters.end())
-						{
-							if (it2 == get<Types::FunctionType>(b->type).parameters.end())
-								break;
-							else
-								return false;
-						}
-						q.emplace(&*it1, &*it2);
-					}
-				break;
-				case 4: // Array
-					if (get<Types::Array>(a->type).size != get<Types::Array>(b->type).size)
-						return false;
-					q.emplace(get<Types::Array>(a->type).value_type.get(),get<Types::Array>(b->type).value_type.get());
-				break;
-				case 5: // Typename
-					if (get<Types::Typename>(a->type).name != get<Types::Typename>(b->type).name)
-						return false;
-				break;
-			}
-			q.pop();
-		}
-		return true;
+		if (ignore_qualifier)
+			return t1.unqualified() == t2.unqualified();
+		return t1.with_lvalue(false) == t2.with_lvalue(false);
 	}
 
 	bool	is_null(const Node &n)
@@ -210,12 +161,13 @@ namespace Expression {
 		return {PlainType{PlainType::INT, true}};
 	}
 
+	// n is moved into the product, which replaces it
 	Node	scale_offset(Node &n, int scale)
 	{
 		auto constant_sym = symbolTable.new_constant(scale);
 		Node constant{CONSTANT,{},{}, constant_sym, {}, constant_sym->type, constant_sym};
 //		DeduceOneType(constant);
-		Node ret(Operation::MUL, {n, constant});
+		Node ret{MUL, make_operands(std::move(n), std::move(constant))};
 		DeduceOneType(ret);
 		return ret;
 	}
@@ -231,13 +183,12 @@ namespace Expression {
 			case CALL:
 				;// todo
 			{
-				Node function_ptr = n.operands.front();
-				std::vector<Node> operands(n.operands.begin() + 1, n.operands.end());
+				Node &function_ptr = n.operands.front();
+				std::span<const Node> operands(n.operands.begin() + 1, n.operands.end());
 				if (!holds_alternative<Types::Pointer>(function_ptr.type.value().type))
 				{
-					function_ptr = {ADDRESS, {function_ptr}};
+					function_ptr = {ADDRESS, make_operands(std::move(function_ptr))};
 					DeduceOneType(function_ptr);
-					n.operands.front() = function_ptr;
 				}
 
 				assert(holds_alternative<Types::Pointer>(function_ptr.type.value().type));
@@ -281,7 +232,7 @@ namespace Expression {
 				assert(n.operands.front().type->is_lvalue);
 
 				n.type = n.operands.front().type.value();
-				n.type->is_lvalue = false;
+				n.type = n.type.with_lvalue(false);
 				// todo: pointers
 				break;
 			}
@@ -292,7 +243,7 @@ namespace Expression {
 				// todo: lvalue
 				// todo: pointers
 				n.type = n.operands.front().type.value();
-				n.type->is_lvalue = false;
+				n.type = n.type.with_lvalue(false);
 				break;
 			}
 			case ADDRESS:
@@ -304,7 +255,7 @@ namespace Expression {
 				assert(is_pointer(n.operands.front().type.value()));
 				//todo
 				n.type = *get<Types::Pointer>(n.operands.front().type.value().type).pointed_type;
-				n.type->is_lvalue = true;
+				n.type = n.type.with_lvalue(true);
 				break;
 			case UPLUS:
 			case UMINUS:
@@ -433,7 +384,7 @@ namespace Expression {
 				assert(!(n.operands[0].type.value().qualifier & Types::CType::CONST));
 
 				n.type = n.operands[0].type.value();
-				n.type->is_lvalue = false;
+				n.type = n.type.with_lvalue(false);
 
 				break;
 			case MUL_ASSIGNMENT:
@@ -451,7 +402,7 @@ namespace Expression {
 
 				n.operand_types = {usual_arithmetic_conversion(n.operands[0].type.value(), n.operands[1].type.value())};
 				n.type = n.operands[0].type.value();
-				n.type->is_lvalue = false;
+				n.type = n.type.with_lvalue(false);
 
 				break;
 			case COMMA:
@@ -488,8 +439,8 @@ namespace Expression {
 			case CALL:
 				;// todo
 			{
-				Node function_ptr = n.operands.front();
-				std::vector<Node> operands(n.operands.begin() + 1, n.operands.end());
+				const Node &function_ptr = n.operands.front();
+				std::span<const Node> operands(n.operands.begin() + 1, n.operands.end());
 
 				// todo: function pointer
 				const auto &f = get<Types::FunctionType>(std::get<Types::Pointer>(function_ptr.type.value().type).pointed_type->type);
@@ -502,7 +453,7 @@ namespace Expression {
 					TAC::Instruction ins{{}, TAC::PARAM, operands[i].ret_address, {}, operation_size, operation_sign};
 					TAC::currentFunction->add_instruction(ins);
 				}
-				if (!type_equivalence(*f.return_type, {Types::PlainType{{Types::PlainType::VOID}}}))
+				if (!type_equivalence(*f.return_type, CTYPE_VOID))
 					n.ret_address = TAC::currentFunction->new_temp(*f.return_type);
 				TAC::currentFunction->add_instruction({n.ret_address, TAC::CALL, function_ptr.ret_address});
 				break;
@@ -705,52 +656,65 @@ namespace Expression {
 		}
 	}
 
-	void	EmitTac(Expression::Node &n)
+	// Post-order walk shared by DeduceType and EmitTac. Each frame keeps the index of the next operand to visit, and
+	// the subtrees already done are recognized by their type (or their emitted bit), so the walk needs no other
+	// bookkeeping. When emitting, the type of each node is deduced (and its constants folded) right before its tac is
+	// emitted. Deducing a node may wrap some of its operands in new nodes (pointer scaling, function designators), so
+	// its operands are scanned once more before it is emitted.
+	static void	walk(Expression::Node &root, bool emit)
 	{
-		std::stack<Node*>	stack;
-		std::set<Node*>		filter;
-		stack.push(&n);
+		struct Frame {
+			Node	*node;
+			size_t	next; // next operand to visit
+			bool	deduced;
+		};
+		thread_local std::vector<Frame>	stack; // kept between the calls, expressions are lowered one at a time
+		TimeReport::Scope				timer(emit ? TimeReport::TAC : TimeReport::TYPING);
+
+		stack.clear();
+		stack.push_back({&root, 0, root.type.has_value()});
 		while (!stack.empty())
 		{
-			Node &current = *stack.top();
-
-			bool is_ready = true;
-			for (auto &operand : std::ranges::subrange(current.operands.rbegin(), current.operands.rend())) {
-				if (!filter.contains(&operand)) {
-					stack.push(&operand);
-					filter.insert(&operand);
-					is_ready = false;
+			Frame &frame = stack.back();
+			Node &current = *frame.node;
+
+			if (frame.next < current.operands.size())
+			{
+				Node &operand = current.operands[frame.next++];
+				if (emit ? !operand.emitted : !operand.type)
+					stack.push_back({&operand, 0, operand.type.has_value()});
+				continue;
+			}
+			if (!frame.deduced)
+			{
+				{
+					TimeReport::Scope typing(TimeReport::TYPING);
+					DeduceOneType(current);
+				}
+				frame.deduced = true;
+				if (emit)
+				{
+					frame.next = 0;
+					continue;
 				}
 			}
-			if (is_ready)
+			if (emit)
 			{
 				EmitOneTAC(current);
-				stack.pop();
+				current.emitted = true;
 			}
+			stack.pop_back();
 		}
 	}
 
-	void	DeduceType(Expression::Node &n)
+	void	EmitTac(Expression::Node &n)
 	{
-		std::stack<Node*> stack;
-		stack.push(&n);
-		while (!stack.empty())
-		{
-			Node &current = *stack.top();
+		walk(n, true);
+	}
 
-			bool is_ready = true;
-			for (auto &operand : current.operands) {
-				if (!operand.type) {
-					stack.push(&operand);
-					is_ready = false;
-				}
-			}
-			if (is_ready)
-			{
-				DeduceOneType(current);
-				stack.pop();
-			}
-		}
+	void	DeduceType(Expression::Node &n)
+	{
+		walk(n, false);
 	}
 
 	void		evaluate_constant_expression(Expression::Node &n)
@@ -3,6 +3,7 @@
 #include "SymbolTable.hpp"
 #include <functional>
 #include "TAC.hpp"
+#include "Arena.hpp"
 
 namespace Expression {
 
@@ -73,23 +74,38 @@ namespace Expression {
 		CALL,
 	};
 
+	struct Node;
+	// the nodes are parts of the tree, their operands are carved out of astArena with it
+	typedef std::vector<Node, ArenaAllocator<Node, astArena>>	NodeVector;
+
 	struct Node {
 		Operation									operation;
-		std::vector<Node>							operands;
-		std::optional<Types::CType>					typeArg; // used only by cast and sizeof
+		NodeVector									operands;
+		Types::TypeId								typeArg; // used only by cast and sizeof
 		std::optional<const SymbolTable::Constant*>	constant;
-		std::optional<std::string>					identifier;
+		std::optional<Atom>							identifier;
 
-		std::optional<Types::CType>	type; // result type of the expression
+		Types::TypeId				type; // result type of the expression
 		TAC::Address						ret_address;
-		std::vector<Types::CType>	operand_types; // types
+		std::vector<Types::TypeId, ArenaAllocator<Types::TypeId, astArena>>	operand_types; // types
+		bool						emitted = false; // the tac of this node has been emitted
 	};
 
-	bool	type_equivalence(const Types::CType &t1, const Types::CType &t2, bool ignore_const);
+	// operands of a new node, moved into place (a braced list would copy every sub-expression)
+	template <typename... Nodes>
+	NodeVector	make_operands(Nodes &&... nodes)
+	{
+		NodeVector operands;
+		operands.reserve(sizeof...(nodes));
+		(operands.push_back(std::forward<Nodes>(nodes)), ...);
+		return operands;
+	}
+
+	bool	type_equivalence(Types::TypeId t1, Types::TypeId t2, bool ignore_qualifier = true);
 	bool	is_null(const Node &n);
 	void	DeduceOneType(Expression::Node &n);
-	void	DeduceType(Expression::Node &);
-	void	EmitTac(Expression::Node &n);
+	void	DeduceType(Expression::Node &); // deduce the types and fold the constants of a whole expression
+	void	EmitTac(Expression::Node &n); // same as DeduceType, and emit the tac of each node in the same walk
 	bool	is_convertible_to(const Types::CType &dst, const Types::CType &src);
 	void	evaluate_constant_expression(Expression::Node &n);
 }
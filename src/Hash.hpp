@@ -0,0 +1,34 @@
+#ifndef CC1_POC_HASH_HPP
+#define CC1_POC_HASH_HPP
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <type_traits>
+
+// SHA-256 of a sequence of bytes fed in pieces, used to name the entries of the compilation cache. Strings are fed
+// with their length so that the boundaries between the pieces are part of the hash.
+class Hash {
+private:
+	uint32_t	state[8];
+	uint8_t		block[64];
+	size_t		used; // bytes in block
+	uint64_t	length; // bytes hashed so far
+
+	void	compress();
+	void	update(const void *data, size_t size);
+public:
+	Hash();
+
+	template <typename T>
+	Hash	&put(T value) requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+	{
+		this->update(&value, sizeof(value));
+		return *this;
+	}
+	Hash		&put(std::string_view s) { this->put(s.size()); this->update(s.data(), s.size()); return *this; }
+	Hash		&put(const char *s) { return this->put(std::string_view(s)); }
+	Hash		&put(const std::string &s) { return this->put(std::string_view(s)); }
+	std::string	finish(); // 64 hex digits, the hash can't be used anymore
+};
+
+#endif
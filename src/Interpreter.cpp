@@ -0,0 +1,555 @@
+#include "Interpreter.hpp"
+#include "CodeGeneration.hpp"
+#include <iostream>
+#include <cstring>
+#include <optional>
+
+namespace TAC {
+	static const uint32_t	text_base = 0x1000; // addresses of the functions, 16 bytes apart
+	static const uint32_t	rodata_base = 0x100000;
+	static const uint32_t	data_base = 0x10000000;
+	static const uint32_t	stack_top = 0x80000000;
+	static const size_t		stack_size = 8 << 20;
+	static const size_t		data_size = 256 << 20; // at most, the heap included
+	static const size_t		fold_steps = 1000000; // instructions run to fold one call
+	static const size_t		max_depth = 2000; // nested calls, each one recurses on the stack of the compiler
+
+	uintmax_t	normalize(uintmax_t v, size_t size, bool sign) {
+		if (size >= sizeof(uintmax_t))
+			return v;
+		uintmax_t mask = ((uintmax_t)1 << size * 8) - 1;
+		v &= mask;
+		if (sign && v >> (size * 8 - 1))
+			v |= ~mask;
+		return v;
+	}
+
+	struct Interpreter::Frame {
+		const SymbolTable::Function				&function;
+		uint32_t								bp;
+		std::vector<uintmax_t>					temps;
+		std::vector<std::optional<uint32_t>>	aliases; // a temp defined by a dereference is the object it points to
+		std::vector<uintmax_t>					params; // arguments of the next call
+	};
+
+	Interpreter::Interpreter(bool pure) :
+		pure(pure),
+		steps(0),
+		depth(0),
+		stack{stack_top - (uint32_t)stack_size, std::vector<uint8_t>(stack_size), true},
+		rodata{rodata_base, {}, false},
+		data{data_base, {}, true},
+		sp(stack_top)
+	{
+		for (auto &f : symbolTable.functions)
+			if (f.tac)
+				this->definitions[f.name.get_id()] = &f;
+		// a declaration which initializes the object wins over the others
+		for (auto &sym : symbolTable.symbols)
+		{
+			if (!holds_alternative<SymbolTable::Ordinary *>(sym.value))
+				continue;
+			auto *o = get<SymbolTable::Ordinary *>(sym.value);
+			auto &known = this->symbols[o->name.get_id()];
+			if (!known || (!known->init && o->init))
+				known = o;
+		}
+	}
+
+	uint8_t *Interpreter::at(uint32_t address, size_t size, bool write) {
+		for (Region *r : {&this->stack, &this->rodata, &this->data})
+		{
+			if (address < r->base || (uintmax_t)address + size > r->base + r->bytes.size())
+				continue;
+			if (r == &this->data && this->pure)
+				throw Error("access to an object of the file scope");
+			if (write && !r->writable)
+				throw Error("write to a string literal");
+			return &r->bytes[address - r->base];
+		}
+		char buf[64];
+		snprintf(buf, sizeof(buf), "invalid memory access at 0x%x", address);
+		throw Error(buf);
+	}
+
+	uintmax_t Interpreter::read(uint32_t address, size_t size, bool sign) {
+		uintmax_t v = 0;
+		memcpy(&v, this->at(address, size, false), std::min(size, sizeof(v))); // little endian, as the target
+		return normalize(v, size, sign);
+	}
+
+	void Interpreter::write(uint32_t address, uintmax_t value, size_t size) {
+		memcpy(this->at(address, size, true), &value, std::min(size, sizeof(value)));
+	}
+
+	uint32_t Interpreter::allocate(Region &r, size_t size) {
+		size_t offset = (r.bytes.size() + 7) & ~(size_t)7;
+		if (offset + size > data_size)
+			throw Error("out of memory");
+		r.bytes.resize(offset + std::max(size, (size_t)1));
+		return r.base + offset;
+	}
+
+	uint32_t Interpreter::address_of_function(Atom name) {
+		auto [it, inserted] = this->function_address.emplace(name.get_id(), text_base + 16 * this->code.size());
+		if (inserted)
+			this->code.push_back(name);
+		return it->second;
+	}
+
+	uint32_t Interpreter::address_of_object(const SymbolTable::Ordinary *o) {
+		if (this->pure)
+			throw Error("access to " + o->name.str());
+		if (auto it = this->object_address.find(o->name.get_id()); it != this->object_address.end())
+			return it->second;
+		if (auto it = this->symbols.find(o->name.get_id()); it != this->symbols.end())
+			o = it->second;
+		size_t size = symbolTable.size_of(o->type);
+		uint32_t address = this->allocate(this->data, size);
+		this->object_address[o->name.get_id()] = address;
+		if (o->init)
+		{
+			const SymbolTable::Constant *c = o->init.value();
+			if (c->value.index() == 1)
+				this->write(address, get<uintmax_t>(c->value), size);
+			else if (c->value.index() == 2)
+				this->write(address, this->address_of_string(c), size);
+			else
+				throw Error("floating point values are not supported");
+		}
+		return address;
+	}
+
+	uint32_t Interpreter::address_of_string(const SymbolTable::Constant *c) {
+		if (auto it = this->string_address.find(c->id); it != this->string_address.end())
+			return it->second;
+		std::string bytes = CodeGeneration::decode_string_literal(get<std::string>(c->value));
+		uint32_t address = this->allocate(this->rodata, bytes.size());
+		memcpy(&this->rodata.bytes[address - this->rodata.base], bytes.data(), bytes.size());
+		return this->string_address[c->id] = address;
+	}
+
+	// address of an object, or of a function
+	uint32_t Interpreter::address_of(Frame &frame, const Address &a) {
+		switch (a.index())
+		{
+			case 1:
+				if (!frame.aliases[get<int>(a)])
+					throw Error("address of a temporary");
+				return frame.aliases[get<int>(a)].value();
+			case 2:
+			{
+				auto *o = get<SymbolTable::Ordinary *>(a);
+				int i = 0;
+				for (auto *p : frame.function.params)
+				{
+					if (p == o)
+						return frame.bp + PTR_SIZE * (2 + i);
+					i++;
+				}
+				if (o->storage == SymbolTable::Ordinary::AUTO)
+					return frame.bp - o->offset;
+				if (holds_alternative<Types::FunctionType>(o->type.type))
+					return this->address_of_function(o->name);
+				return this->address_of_object(o);
+			}
+			case 5:
+			{
+				auto *o = symbolTable.retrieve_ordinary(get<Atom>(a));
+				if (!o)
+					throw Error("unknown symbol " + get<Atom>(a).str());
+				return this->address_of(frame, o);
+			}
+			default:
+				throw Error("address of a value");
+		}
+	}
+
+	// the value of a, converted to size bytes as it is loaded in a register (size 0 is the size of a)
+	uintmax_t Interpreter::load(Frame &frame, const Address &a, size_t size, bool sign) {
+		uintmax_t v;
+		switch (a.index())
+		{
+			case 1:
+			{
+				int t = get<int>(a);
+				Types::TypeId type = frame.function.tac->get_temps()[t];
+				size_t temp_size = symbolTable.size_of(type);
+				bool temp_sign = Types::is_signed(type);
+				v = frame.aliases[t] ? this->read(frame.aliases[t].value(), temp_size, temp_sign) : normalize(frame.temps[t], temp_size, temp_sign);
+				break;
+			}
+			case 2:
+			case 5:
+			{
+				const Types::CType &type = a.index() == 2 ? get<SymbolTable::Ordinary *>(a)->type : symbolTable.retrieve_ordinary(get<Atom>(a))->type;
+				if (holds_alternative<Types::FunctionType>(type.type))
+					v = this->address_of(frame, a);
+				else
+					v = this->read(this->address_of(frame, a), symbolTable.size_of(type), Types::is_signed(type));
+				break;
+			}
+			case 3:
+			{
+				auto *c = get<const SymbolTable::Constant *>(a);
+				if (c->value.index() == 0)
+					throw Error("floating point values are not supported");
+				v = c->value.index() == 1 ? get<uintmax_t>(c->value) : this->address_of_string(c);
+				break;
+			}
+			default:
+				throw Error("invalid operand");
+		}
+		return size ? normalize(v, size, sign) : v;
+	}
+
+	void Interpreter::store(Frame &frame, const Address &a, uintmax_t value, size_t size, bool sign) {
+		if (size)
+			value = normalize(value, size, sign);
+		if (holds_alternative<int>(a) && !frame.aliases[get<int>(a)])
+		{
+			frame.temps[get<int>(a)] = value;
+			return;
+		}
+		size_t object_size;
+		if (holds_alternative<int>(a))
+			object_size = symbolTable.size_of(frame.function.tac->get_temps()[get<int>(a)]);
+		else if (holds_alternative<SymbolTable::Ordinary *>(a))
+			object_size = symbolTable.size_of(get<SymbolTable::Ordinary *>(a)->type);
+		else
+			throw Error("store to a value");
+		this->write(this->address_of(frame, a), value, object_size);
+	}
+
+	static bool	compare(Operation op, uintmax_t a, uintmax_t b, bool sign) {
+		switch (op)
+		{
+			case LESSER:
+			case JUMP_LESSER:
+				return sign ? (intmax_t)a < (intmax_t)b : a < b;
+			case GREATER:
+			case JUMP_GREATER:
+				return sign ? (intmax_t)a > (intmax_t)b : a > b;
+			case LESSER_EQUAL:
+			case JUMP_LESSER_EQUAL:
+				return sign ? (intmax_t)a <= (intmax_t)b : a <= b;
+			case GREATER_EQUAL:
+			case JUMP_GREATER_EQUAL:
+				return sign ? (intmax_t)a >= (intmax_t)b : a >= b;
+			case EQUAL:
+			case JUMP_EQUAL:
+				return a == b;
+			case NOT_EQUAL:
+			case JUMP_NOT_EQUAL:
+				return a != b;
+			default:
+				return true;
+		}
+	}
+
+	uintmax_t	evaluate(Operation op, uintmax_t a, uintmax_t b, size_t size, bool sign) {
+		size_t bits = (size ? size : sizeof(uintmax_t)) * 8;
+		switch (op)
+		{
+			case ADD: return a + b;
+			case SUB: return a - b;
+			case MUL: return a * b;
+			case DIV:
+			case MOD:
+				if (!b)
+					throw Interpreter::Error("division by zero");
+				if (sign && (intmax_t)b == -1) // without the overflow of the most negative value
+					return op == DIV ? -a : 0;
+				if (sign)
+					return op == DIV ? (intmax_t)a / (intmax_t)b : (intmax_t)a % (intmax_t)b;
+				return op == DIV ? a / b : a % b;
+			// the count is masked as by the processor, the right shift is logical as in the generated code
+			case SHIFT_LEFT: return a << (b & (bits > 32 ? 63 : 31));
+			case SHIFT_RIGHT: return normalize(a, bits / 8, false) >> (b & (bits > 32 ? 63 : 31));
+			case BITWISE_AND: return a & b;
+			case BITWISE_XOR: return a ^ b;
+			case BITWISE_OR: return a | b;
+			default:
+				return compare(op, a, b, sign);
+		}
+	}
+
+	uintmax_t Interpreter::call(const SymbolTable::Function &f, const std::vector<uintmax_t> &args, size_t max_steps) {
+		uint32_t saved_sp = this->sp;
+		size_t saved_depth = this->depth;
+		this->steps = max_steps;
+		try {
+			return this->run(f, args);
+		} catch (Error &) {
+			this->sp = saved_sp;
+			this->depth = saved_depth;
+			throw;
+		}
+	}
+
+	uintmax_t Interpreter::run(const SymbolTable::Function &f, const std::vector<uintmax_t> &args) {
+		const auto &instructions = f.tac->get_instructions();
+		const auto &labels = f.tac->get_labels();
+		uint32_t saved_sp = this->sp;
+
+		// arguments, return address and saved frame pointer, as pushed by the generated code
+		if (this->sp - this->stack.base < PTR_SIZE * (args.size() + 2) + f.frame_size)
+			throw Error("stack overflow");
+		for (size_t i = args.size(); i-- > 0;)
+		{
+			this->sp -= PTR_SIZE;
+			this->write(this->sp, args[i], PTR_SIZE);
+		}
+		this->sp -= 2 * PTR_SIZE;
+		Frame frame{f, this->sp, std::vector<uintmax_t>(f.tac->get_temps().size()), std::vector<std::optional<uint32_t>>(f.tac->get_temps().size()), {}};
+		this->sp -= f.frame_size;
+
+		uintmax_t ret = 0;
+		for (size_t pc = 0; pc < instructions.size();)
+		{
+			if (!this->steps--)
+				throw Error("too many instructions run");
+			const Instruction &i = instructions[pc++];
+			size_t size = i.operation_size;
+			bool sign = i.operation_sign;
+			if (!size && i.oper1.index() == 1) // the size of the first operand
+			{
+				size = symbolTable.size_of(f.tac->get_temps()[get<int>(i.oper1)]);
+				sign = Types::is_signed(f.tac->get_temps()[get<int>(i.oper1)]);
+			}
+			else if (!size && i.oper1.index() == 2)
+			{
+				size = symbolTable.size_of(get<SymbolTable::Ordinary *>(i.oper1)->type);
+				sign = Types::is_signed(get<SymbolTable::Ordinary *>(i.oper1)->type);
+			}
+			if (i.is_jump())
+			{
+				if (i.op == JUMP || compare(i.op, this->load(frame, i.oper1, size, sign), this->load(frame, i.oper2, size, sign), sign))
+				{
+					if (labels[get<Label>(i.ret)] < 0)
+						throw Error("jump to a label which is not set");
+					pc = labels[get<Label>(i.ret)];
+				}
+				continue;
+			}
+			switch (i.op)
+			{
+				case LOGICAL_AND:
+				case LOGICAL_OR:
+				{
+					bool a = this->load(frame, i.oper1, 0, false);
+					bool b = this->load(frame, i.oper2, 0, false);
+					this->store(frame, i.ret, i.op == LOGICAL_AND ? a && b : a || b, 0, false);
+					break;
+				}
+				case LOGICAL_NOT:
+					this->store(frame, i.ret, !this->load(frame, i.oper1, 0, false), 0, false);
+					break;
+				case NEG:
+					this->store(frame, i.ret, -this->load(frame, i.oper1, size, sign), size, sign);
+					break;
+				case BITWISE_NOT:
+					this->store(frame, i.ret, ~this->load(frame, i.oper1, size, sign), size, sign);
+					break;
+				case ASSIGN:
+					this->store(frame, i.ret, this->load(frame, i.oper1, size, sign), size, sign);
+					break;
+				case DEREFERENCE:
+				{
+					int t = get<int>(i.ret);
+					frame.aliases[t] = this->load(frame, i.oper1, PTR_SIZE, false);
+					break;
+				}
+				case ADDRESS:
+					this->store(frame, i.ret, this->address_of(frame, i.oper1), PTR_SIZE, false);
+					break;
+				case RETURN:
+					if (i.oper1.index())
+						ret = this->load(frame, i.oper1, size, sign);
+					pc = instructions.size();
+					break;
+				case PARAM:
+					frame.params.push_back(this->load(frame, i.oper1, size ? size : PTR_SIZE, sign));
+					break;
+				case CALL:
+				{
+					uint32_t function = this->load(frame, i.oper1, PTR_SIZE, false);
+					std::vector<uintmax_t> params;
+					params.swap(frame.params);
+					uintmax_t value = this->call_address(function, params);
+					if (i.ret.index())
+						this->store(frame, i.ret, value, REG_SIZE, false);
+					break;
+				}
+				default: // binary operations
+				{
+					uintmax_t r = evaluate(i.op, this->load(frame, i.oper1, size, sign), this->load(frame, i.oper2, size, sign), size, sign);
+					if (i.op >= LESSER && i.op <= NOT_EQUAL)
+						this->store(frame, i.ret, r, 0, false);
+					else
+						this->store(frame, i.ret, r, size, sign);
+				}
+			}
+		}
+		this->sp = saved_sp;
+		return ret;
+	}
+
+	uintmax_t Interpreter::call_address(uint32_t function, const std::vector<uintmax_t> &args) {
+		if (function < text_base || (function - text_base) % 16 || (function - text_base) / 16 >= this->code.size())
+		{
+			char buf[64];
+			snprintf(buf, sizeof(buf), "call of 0x%x, which is not a function", function);
+			throw Error(buf);
+		}
+		Atom name = this->code[(function - text_base) / 16];
+		auto it = this->definitions.find(name.get_id());
+		if (it == this->definitions.end())
+			return this->call_library(name, args);
+		if (this->depth == max_depth)
+			throw Error("call depth");
+		this->depth++;
+		uintmax_t ret = this->run(*it->second, args);
+		this->depth--;
+		return ret;
+	}
+
+	uintmax_t Interpreter::call_library(Atom name, const std::vector<uintmax_t> &args) {
+		if (this->pure)
+			throw Error("call to " + name.str());
+		const std::string &s = name.str();
+		if (s == "putchar" && args.size() == 1)
+		{
+			std::cout.put(args[0]);
+			return (unsigned char)args[0];
+		}
+		if (s == "write" && args.size() == 3)
+		{
+			if (args[0] != 1 && args[0] != 2)
+				return -1;
+			const char *buf = (const char *)this->at(args[1], args[2], false);
+			(args[0] == 1 ? std::cout : std::cerr).write(buf, args[2]);
+			return args[2];
+		}
+		if (s == "malloc" && args.size() == 1)
+			return this->allocate(this->data, args[0]);
+		if (s == "free" && args.size() == 1)
+			return 0;
+		throw Error("call to " + s + ", which has no definition");
+	}
+
+	int Interpreter::run_main(const std::vector<std::string> &args) {
+		auto it = this->definitions.find(Atom("main").get_id());
+		if (it == this->definitions.end())
+			throw Error("no definition of main");
+		std::vector<uint32_t> argv;
+		for (auto &a : args)
+		{
+			uint32_t address = this->allocate(this->data, a.size() + 1);
+			memcpy(&this->data.bytes[address - this->data.base], a.c_str(), a.size() + 1);
+			argv.push_back(address);
+		}
+		argv.push_back(0);
+		uint32_t address = this->allocate(this->data, argv.size() * PTR_SIZE);
+		for (size_t i = 0; i < argv.size(); i++)
+			this->write(address + i * PTR_SIZE, argv[i], PTR_SIZE);
+		int ret = this->call(*it->second, {args.size(), address});
+		std::cout.flush();
+		return ret;
+	}
+
+	// integers only, a pointer computed at compile time would point into the interpreter
+	static bool	is_integer(const Types::CType &t) {
+		if (auto *name = get_if<Types::Typename>(&t.type))
+		{
+			auto *o = symbolTable.retrieve_ordinary(name->name);
+			return o && is_integer(o->type);
+		}
+		if (!holds_alternative<Types::PlainType>(t.type))
+			return false;
+		auto base = get<Types::PlainType>(t.type).base;
+		return base == Types::PlainType::CHAR || base == Types::PlainType::SHORT_INT || base == Types::PlainType::INT || base == Types::PlainType::LONG_INT;
+	}
+
+	// index of the instruction taking the address of the function called, when it is known
+	static std::optional<size_t> function_address(const std::vector<Instruction> &instructions, size_t call) {
+		if (!holds_alternative<int>(instructions[call].oper1))
+			return std::nullopt;
+		for (size_t i = call; i-- > 0;)
+			if (holds_alternative<int>(instructions[i].ret) && get<int>(instructions[i].ret) == get<int>(instructions[call].oper1))
+			{
+				if (instructions[i].op != ADDRESS || !holds_alternative<SymbolTable::Ordinary *>(instructions[i].oper1))
+					return std::nullopt;
+				return i;
+			}
+		return std::nullopt;
+	}
+
+	void fold_pure_calls() {
+		std::unordered_map<uint32_t, const SymbolTable::Function *> definitions;
+		for (auto &f : symbolTable.functions)
+			if (f.tac)
+				definitions[f.name.get_id()] = &f;
+		Interpreter interpreter(true);
+		for (auto &tac : functions)
+		{
+			const auto &instructions = tac.get_instructions();
+			std::vector<bool> erased(instructions.size());
+			bool changed = false;
+			for (size_t i = 0; i < instructions.size(); i++)
+			{
+				if (instructions[i].op != CALL)
+					continue;
+				auto address = function_address(instructions, i);
+				if (!address)
+					continue;
+				auto it = definitions.find(get<SymbolTable::Ordinary *>(instructions[*address].oper1)->name.get_id());
+				if (it == definitions.end())
+					continue;
+				const SymbolTable::Function *f = it->second;
+				const auto &type = get<Types::FunctionType>(f->type.type);
+				if (type.variadic || (instructions[i].ret.index() && !is_integer(*type.return_type)))
+					continue;
+				// the parameters are pushed right before the call
+				size_t count = f->params.size();
+				if (i < count || (i > count && instructions[i - count - 1].op == PARAM))
+					continue;
+				std::vector<uintmax_t> args;
+				for (size_t p = i - count; p < i; p++)
+				{
+					const Instruction &param = instructions[p];
+					if (param.op != PARAM || !holds_alternative<const SymbolTable::Constant *>(param.oper1))
+						break;
+					auto *c = get<const SymbolTable::Constant *>(param.oper1);
+					if (c->value.index() != 1)
+						break;
+					args.push_back(normalize(get<uintmax_t>(c->value), param.operation_size ? param.operation_size : PTR_SIZE, param.operation_sign));
+				}
+				if (args.size() != count)
+					continue;
+				uintmax_t value;
+				try {
+					value = interpreter.call(*f, args, fold_steps);
+				} catch (Interpreter::Error &) {
+					continue;
+				}
+				for (size_t p = i - count; p < i; p++)
+					erased[p] = true;
+				// the address of the function isn't needed anymore if only the call used it
+				if (tac.get_last_usages()[get<int>(instructions[i].oper1)] == (int)i)
+					erased[*address] = true;
+				if (instructions[i].ret.index())
+				{
+					Types::TypeId t = tac.get_temps()[get<int>(instructions[i].ret)];
+					tac.set_instruction(i, {instructions[i].ret, ASSIGN, symbolTable.new_constant(normalize(value, REG_SIZE, false)), {},
+											REG_SIZE, Types::is_signed(t)});
+				}
+				else
+					erased[i] = true;
+				changed = true;
+			}
+			if (changed)
+				tac.erase_instructions(erased);
+		}
+	}
+}
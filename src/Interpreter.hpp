@@ -0,0 +1,77 @@
+#ifndef CC1_POC_INTERPRETER_HPP
+#define CC1_POC_INTERPRETER_HPP
+#include "TAC.hpp"
+#include <stdexcept>
+#include <unordered_map>
+
+namespace TAC {
+
+	// Runs the tac of the functions as the generated code would, on an emulated 32 bits address space: the frames are
+	// laid out as by the code generator (locals below the frame pointer at their offset, parameters above it, 4 bytes
+	// each), so that pointers to locals and parameters behave the same. The objects of the file scope and the string
+	// literals are allocated the first time they are used, the functions have addresses of their own which can only
+	// be called. A few functions of the C library (putchar, write, malloc and free) are provided for the functions
+	// without tac. An operation size of 0 means the size and signedness of the first operand.
+	// A pure interpreter can't touch anything but its frames and the string literals, nor call the library: what it
+	// computes only depends on the arguments, so it can be done at compile time.
+	class Interpreter {
+	public:
+		struct Error : std::runtime_error {
+			using std::runtime_error::runtime_error;
+		};
+	private:
+		struct Frame;
+		struct Region {
+			uint32_t				base;
+			std::vector<uint8_t>	bytes;
+			bool					writable;
+		};
+
+		bool												pure;
+		size_t												steps; // instructions left to run by the current call
+		size_t												depth; // calls nested in the current one
+		Region												stack;
+		Region												rodata; // string literals
+		Region												data; // objects of the file scope and the heap
+		uint32_t											sp;
+		std::vector<Atom>									code; // functions which had their address taken, by address
+		std::unordered_map<uint32_t, uint32_t>				function_address; // by atom id
+		std::unordered_map<uint32_t, uint32_t>				object_address; // by atom id of the symbol
+		std::unordered_map<int, uint32_t>					string_address; // by constant id
+		std::unordered_map<uint32_t, const SymbolTable::Function *>	definitions; // by atom id
+		std::unordered_map<uint32_t, const SymbolTable::Ordinary *>	symbols; // by atom id
+
+		uint8_t		*at(uint32_t address, size_t size, bool write);
+		uintmax_t	read(uint32_t address, size_t size, bool sign);
+		void		write(uint32_t address, uintmax_t value, size_t size);
+		uint32_t	allocate(Region &, size_t size);
+		uint32_t	address_of_function(Atom name);
+		uint32_t	address_of_object(const SymbolTable::Ordinary *);
+		uint32_t	address_of_string(const SymbolTable::Constant *);
+		uint32_t	address_of(Frame &, const Address &);
+		uintmax_t	load(Frame &, const Address &, size_t size, bool sign);
+		void		store(Frame &, const Address &, uintmax_t value, size_t size, bool sign);
+		uintmax_t	run(const SymbolTable::Function &, const std::vector<uintmax_t> &args);
+		uintmax_t	call_address(uint32_t function, const std::vector<uintmax_t> &args);
+		uintmax_t	call_library(Atom name, const std::vector<uintmax_t> &args);
+	public:
+		explicit Interpreter(bool pure = false);
+
+		// the value returned, an Error if the function can't be run, runs more than max_steps instructions or nests
+		// calls too deeply for the stack of the compiler
+		uintmax_t	call(const SymbolTable::Function &, const std::vector<uintmax_t> &args, size_t max_steps = SIZE_MAX);
+		int			run_main(const std::vector<std::string> &args); // main(argc, argv), its return value
+	};
+
+	// value of a size bytes integer, sign or zero extended to 64 bits
+	uintmax_t	normalize(uintmax_t v, size_t size, bool sign);
+	// result of a binary operation (a comparison gives 0 or 1) on operands loaded in size bytes, 0 is 64 bits, an
+	// Interpreter::Error for a division by zero
+	uintmax_t	evaluate(Operation, uintmax_t a, uintmax_t b, size_t size, bool sign);
+
+	// Replace the calls to functions returning an integer whose arguments are all integer constants by their result,
+	// when the pure interpreter can compute it in a bounded number of steps.
+	void	fold_pure_calls();
+}
+
+#endif
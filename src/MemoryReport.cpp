@@ -0,0 +1,165 @@
+#include "MemoryReport.hpp"
+#include <unordered_map>
+#include <mutex>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+
+namespace MemoryReport {
+	bool						enabled = false;
+	thread_local Category		current = OTHER;
+
+	static const char *const	category_names[CATEGORY_COUNT] = {
+		"other",
+		"preprocessor",
+		"ast",
+		"atoms",
+		"types",
+		"symbols",
+		"constants",
+		"tac",
+		"backend",
+		"output",
+	};
+
+	// the table of the live allocations can't allocate through operator new, it would record itself
+	template <typename T>
+	struct Mallocator {
+		using value_type = T;
+
+		Mallocator() = default;
+		template <typename U>
+		Mallocator(const Mallocator<U> &) {}
+
+		T	*allocate(size_t n)
+		{
+			if (void *p = malloc(n * sizeof(T)))
+				return static_cast<T *>(p);
+			throw std::bad_alloc();
+		}
+		void	deallocate(T *p, size_t) { free(p); }
+
+		template <typename U>
+		bool	operator==(const Mallocator<U> &) const { return true; }
+	};
+
+	struct Allocation {
+		size_t		size;
+		Category	category;
+	};
+
+	struct Counters {
+		size_t	live = 0; // bytes
+		size_t	peak = 0;
+		size_t	total = 0;
+		size_t	allocations = 0;
+		size_t	live_objects = 0;
+	};
+
+	using Table = std::unordered_map<void *, Allocation, std::hash<void *>, std::equal_to<void *>,
+									 Mallocator<std::pair<void *const, Allocation>>>;
+
+	static std::mutex	mutex;
+	static Table		*table; // created by start(), never destroyed: memory is freed until the very end
+	static Counters		counters[CATEGORY_COUNT];
+	static Counters		total;
+
+	static void	record(void *p, size_t size) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!table)
+			return;
+		Category c = current;
+		(*table)[p] = {size, c};
+		for (Counters *k : {&counters[c], &total})
+		{
+			k->live += size;
+			k->peak = std::max(k->peak, k->live);
+			k->total += size;
+			k->allocations++;
+			k->live_objects++;
+		}
+	}
+
+	static void	forget(void *p) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!table)
+			return;
+		auto it = table->find(p);
+		if (it == table->end()) // allocated before start()
+			return;
+		for (Counters *k : {&counters[it->second.category], &total})
+		{
+			k->live -= it->second.size;
+			k->live_objects--;
+		}
+		table->erase(it);
+	}
+
+	void start() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!table)
+			table = new (Mallocator<Table>().allocate(1)) Table;
+		table->clear();
+		for (auto &k : counters)
+			k = {};
+		total = {};
+		enabled = true;
+	}
+
+	void print(std::ostream &os, const std::string &input, const std::string &when) {
+		Counters snapshot[CATEGORY_COUNT];
+		Counters sum;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::copy(std::begin(counters), std::end(counters), snapshot);
+			sum = total;
+		}
+		char line[256];
+		os << "Heap memory of " << input << " " << when << " (bytes):\n";
+		snprintf(line, sizeof(line), " %-13s %12s %12s %12s %12s %12s\n", "category", "live", "peak", "allocated", "allocations", "live objects");
+		os << line;
+		for (int i = 0; i < CATEGORY_COUNT; i++)
+		{
+			const Counters &k = snapshot[i];
+			snprintf(line, sizeof(line), " %-13s %12zu %12zu %12zu %12zu %12zu\n", category_names[i], k.live, k.peak, k.total, k.allocations, k.live_objects);
+			os << line;
+		}
+		snprintf(line, sizeof(line), " %-13s %12zu %12zu %12zu %12zu %12zu\n", "TOTAL", sum.live, sum.peak, sum.total, sum.allocations, sum.live_objects);
+		os << line;
+		os.flush();
+	}
+}
+
+void	*operator new(size_t size) {
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	if (MemoryReport::enabled)
+		MemoryReport::record(p, size);
+	return p;
+}
+
+void	operator delete(void *p) noexcept {
+	if (p && MemoryReport::enabled)
+		MemoryReport::forget(p);
+	free(p);
+}
+
+// the other forms of new and delete call these two
+void	*operator new[](size_t size) {
+	return operator new(size);
+}
+
+void	operator delete[](void *p) noexcept {
+	operator delete(p);
+}
+
+// the sized forms too, whose defaults may not forward to the unsized ones
+void	operator delete(void *p, size_t) noexcept {
+	operator delete(p);
+}
+
+void	operator delete[](void *p, size_t) noexcept {
+	operator delete(p);
+}
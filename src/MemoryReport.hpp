@@ -0,0 +1,55 @@
+#ifndef CC1_POC_MEMORYREPORT_HPP
+#define CC1_POC_MEMORYREPORT_HPP
+#include <ostream>
+#include <string>
+
+// -fmem-report: heap allocations of each subsystem of the compiler.
+// The global operator new and delete are replaced: once the report is started, each allocation is recorded with its
+// size and the current category of the thread, and found again when it is freed, so that the live bytes of each
+// category are known at any time. A Scope sets the category of the allocations made inside it, the innermost one
+// wins (a constant created by the parser belongs to the constant pool, not to the syntax tree). Nothing is recorded
+// before start(), the memory allocated earlier is ignored when it is freed.
+namespace MemoryReport {
+	enum Category {
+		OTHER,
+		PREPROCESSOR,
+		AST, // the syntax tree, its arena and the stack of the parser
+		ATOMS,
+		TYPES,
+		SYMBOLS,
+		CONSTANTS,
+		TAC,
+		BACKEND, // translation of the functions
+		OUTPUT, // assembly text, object file and output buffers
+		CATEGORY_COUNT
+	};
+
+	extern bool						enabled;
+	extern thread_local Category	current;
+
+	class Scope {
+	private:
+		Category	previous;
+	public:
+		explicit Scope(Category c) : previous(OTHER)
+		{
+			if (enabled)
+			{
+				this->previous = current;
+				current = c;
+			}
+		}
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+		~Scope()
+		{
+			if (enabled)
+				current = this->previous;
+		}
+	};
+
+	void	start();
+	void	print(std::ostream &, const std::string &input, const std::string &when);
+}
+
+#endif
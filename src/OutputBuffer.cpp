@@ -0,0 +1,96 @@
+#include "OutputBuffer.hpp"
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+OutputBuffer::OutputBuffer(int fd) :
+	fd(fd),
+	front_size(0),
+	back_size(0),
+	done(false),
+	error(0)
+{
+	this->chunks[0].reset(new char[chunk_size]);
+	this->chunks[1].reset(new char[chunk_size]);
+	this->front = this->chunks[0].get();
+	this->back = this->chunks[1].get();
+	this->writer = std::thread(&OutputBuffer::writer_loop, this);
+}
+
+OutputBuffer::~OutputBuffer() {
+	if (this->writer.joinable())
+		this->finish();
+}
+
+bool OutputBuffer::write_all(const char *data, size_t size) {
+	while (size)
+	{
+		ssize_t ret = ::write(this->fd, data, size);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+void OutputBuffer::writer_loop() {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true)
+	{
+		this->cond.wait(lock, [this]{ return this->back_size || this->done; });
+		if (!this->back_size) // done and nothing left
+			return;
+		size_t size = this->back_size;
+		lock.unlock();
+		bool ok = this->error || this->write_all(this->back, size); // after an error the remaining data is dropped
+		lock.lock();
+		if (!ok)
+			this->error = errno;
+		this->back_size = 0;
+		this->cond.notify_all();
+	}
+}
+
+// hand the filled front chunk to the writer and continue on the chunk it has finished draining
+void OutputBuffer::swap_chunks() {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->cond.wait(lock, [this]{ return !this->back_size; });
+	std::swap(this->front, this->back);
+	this->back_size = this->front_size;
+	this->front_size = 0;
+	this->cond.notify_all();
+}
+
+void OutputBuffer::write(const char *data, size_t size) {
+	while (size)
+	{
+		if (this->front_size == chunk_size)
+			this->swap_chunks();
+		size_t n = std::min(size, chunk_size - this->front_size);
+		memcpy(this->front + this->front_size, data, n);
+		this->front_size += n;
+		data += n;
+		size -= n;
+	}
+}
+
+bool OutputBuffer::finish() {
+	if (this->front_size)
+		this->swap_chunks();
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->done = true;
+	}
+	this->cond.notify_all();
+	this->writer.join();
+	return !this->error;
+}
+
+int OutputBuffer::get_error() const {
+	return this->error;
+}
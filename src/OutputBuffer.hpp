@@ -0,0 +1,54 @@
+#ifndef CC1_POC_OUTPUTBUFFER_HPP
+#define CC1_POC_OUTPUTBUFFER_HPP
+#include <string>
+#include <string_view>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+// Output sink for the generated file.
+// Data is appended to a large front chunk; once it is full it is handed to a background thread which drains it
+// to the file descriptor while the generator keeps filling the other chunk (double buffering).
+class OutputBuffer {
+private:
+	static constexpr size_t	chunk_size = 1 << 20;
+
+	int						fd;
+	std::unique_ptr<char[]>	chunks[2];
+	char					*front;
+	size_t					front_size;
+	char					*back;
+	size_t					back_size; // bytes waiting to be written by the writer thread, 0 when it is idle
+	bool					done;
+	int						error; // errno of the first failed write
+	std::mutex				mutex;
+	std::condition_variable	cond;
+	std::thread				writer;
+
+	void	writer_loop();
+	void	swap_chunks();
+	bool	write_all(const char *data, size_t size);
+public:
+	explicit OutputBuffer(int fd);
+	OutputBuffer(const OutputBuffer &) = delete;
+	OutputBuffer &operator=(const OutputBuffer &) = delete;
+	~OutputBuffer();
+
+	void	write(const char *data, size_t size);
+	void	write(std::string_view s) { this->write(s.data(), s.size()); }
+	void	put(char c)
+	{
+		if (this->front_size == chunk_size)
+			this->swap_chunks();
+		this->front[this->front_size++] = c;
+	}
+	OutputBuffer &operator<<(std::string_view s) { this->write(s); return *this; }
+	OutputBuffer &operator<<(char c) { this->put(c); return *this; }
+
+	bool	finish(); // flush everything and stop the writer, return false if any write failed
+	int		get_error() const;
+};
+
+
+#endif
@@ -0,0 +1,195 @@
+#include "PrecompiledHeader.hpp"
+#include "SymbolTable.hpp"
+#include "SourceFile.hpp"
+#include "Serialization.hpp"
+#include <fstream>
+#include <unordered_map>
+#include <cstring>
+
+// Layout: magic, then the identifiers (names), the types (each node after its sub-types, which it refers to by index)
+// and the body: macros, constant pool, tags, objects and symbols. Numbers are 32 bits, index 0 is the empty atom and
+// the absence of type.
+namespace PrecompiledHeader {
+	using Serialization::Writer;
+	using Serialization::Reader;
+
+	static const char magic[8] = {'c', 'c', '1', 'p', 'c', 'h', '0', '1'};
+
+	void save(const std::string &path, const std::string &macros) {
+		if (!symbolTable.functions.empty())
+			throw std::runtime_error("error: a precompiled header can't contain function definitions");
+		Writer w;
+		std::string &body = w.body;
+		Writer::put_string(body, macros);
+
+		Writer::put(body, symbolTable.constants.size());
+		for (auto &c : symbolTable.constants)
+			Writer::put_constant(body, c);
+
+		// only the file scope is visible once the header is parsed
+		std::vector<std::pair<Atom, const Types::Tag *>> tags;
+		std::unordered_map<const SymbolTable::Ordinary *, Atom> bound;
+		for (uint32_t id = 0; id < symbolTable.names.size(); id++)
+		{
+			auto &name = symbolTable.names[id];
+			Atom atom(atomTable.get_name(id));
+			if (!name.tags.empty())
+				tags.emplace_back(atom, name.tags.front().value);
+			if (!name.ordinaries.empty())
+				bound[name.ordinaries.front().value] = atom;
+		}
+		Writer::put(body, tags.size());
+		for (auto &[name, tag] : tags)
+		{
+			Writer::put(body, w.atom(name));
+			Writer::put(body, tag->type);
+			Writer::put(body, tag->declaration.index());
+			if (auto *sou = std::get_if<Types::StructOrUnion>(&tag->declaration))
+			{
+				Writer::put(body, sou->is_union);
+				Writer::put(body, w.atom(sou->tag.value_or(Atom())));
+				Writer::put(body, sou->members.size());
+				for (auto &m : sou->members)
+				{
+					Writer::put(body, w.atom(m.name));
+					Writer::put(body, w.type(*m.type));
+					Writer::put(body, m.bitfield);
+				}
+			}
+			else if (tag->declaration.index() == 1)
+				Writer::put_string(body, std::get<std::string>(tag->declaration));
+		}
+
+		// the objects which are visible or referred to by a symbol, in the order of their declaration
+		std::unordered_map<const SymbolTable::Ordinary *, uint32_t> ordinary_index;
+		for (auto &sym : symbolTable.symbols)
+			ordinary_index[get<SymbolTable::Ordinary *>(sym.value)];
+		for (auto &[o, name] : bound)
+			ordinary_index[o];
+		std::string ordinaries;
+		uint32_t count = 0;
+		for (auto &o : symbolTable.ordinaries)
+		{
+			auto it = ordinary_index.find(&o);
+			if (it == ordinary_index.end())
+				continue;
+			it->second = count++;
+			auto name = bound.find(&o);
+			Writer::put(ordinaries, w.atom(name == bound.end() ? Atom() : name->second));
+			Writer::put(ordinaries, o.storage);
+			Writer::put(ordinaries, w.type(o.type));
+			Writer::put(ordinaries, w.atom(o.name));
+			Writer::put(ordinaries, o.offset);
+			Writer::put(ordinaries, o.init ? o.init.value()->id + 1 : 0);
+		}
+		Writer::put(body, count);
+		body += ordinaries;
+
+		Writer::put(body, symbolTable.symbols.size());
+		for (auto &sym : symbolTable.symbols)
+		{
+			Writer::put(body, w.atom(sym.name));
+			Writer::put(body, sym.read_only);
+			Writer::put(body, sym.visibility);
+			Writer::put(body, ordinary_index[get<SymbolTable::Ordinary *>(sym.value)]);
+			Writer::put(body, sym.size);
+		}
+
+		std::ofstream out(path, std::ios::binary);
+		if (!(out << w.finish(std::string_view(magic, sizeof(magic)))))
+			throw std::runtime_error("error: cant write file: " + path);
+	}
+
+	std::string load(const std::string &path) {
+		SourceFile file;
+		if (!file.open(path))
+			throw std::runtime_error("error: cant open file: " + path);
+		std::string_view data = file.view();
+		if (data.size() < sizeof(magic) || memcmp(data.data(), magic, sizeof(magic)))
+			throw std::runtime_error("error: " + path + ": not a precompiled header");
+		if (!symbolTable.symbols.empty() || !symbolTable.constants.empty())
+			throw std::runtime_error("error: a precompiled header must be loaded before anything is declared");
+		Reader r(path, data.substr(sizeof(magic)), "precompiled header");
+		r.read_header();
+
+		std::string macros(r.get_string());
+
+		std::vector<const SymbolTable::Constant *> constants{nullptr};
+		for (uint32_t n = r.get(); n; n--)
+			constants.push_back(r.get_constant());
+
+		for (uint32_t n = r.get(); n; n--)
+		{
+			Atom name = r.atom();
+			auto type = static_cast<Types::Tag::Type>(r.get());
+			symbolTable.declare_tag(name, type);
+			Types::Tag *tag = symbolTable.retrieve_tag(name);
+			switch (r.get())
+			{
+				case 0:
+					break;
+				case 1:
+					tag->declaration = std::string(r.get_string());
+					break;
+				case 2:
+				{
+					Types::StructOrUnion sou;
+					sou.is_union = r.get();
+					if (Atom a = r.atom(); !a.empty())
+						sou.tag = a;
+					for (uint32_t m = r.get(); m; m--)
+					{
+						Atom member = r.atom();
+						auto member_type = r.shared_type();
+						sou.members.push_back({member, member_type, (int)r.get()});
+						if (!member.empty()) // an unnamed bitfield can't be designated
+							sou.member_map[member] = &sou.members.back();
+					}
+					tag->declaration = std::move(sou);
+					break;
+				}
+				case 3:
+					tag->declaration = Types::Enum{};
+					break;
+				default:
+					r.corrupted();
+			}
+		}
+
+		std::vector<SymbolTable::Ordinary *> ordinaries;
+		for (uint32_t n = r.get(); n; n--)
+		{
+			SymbolTable::Ordinary o;
+			Atom bound = r.atom();
+			o.storage = static_cast<SymbolTable::Ordinary::Storage>(r.get());
+			o.type = r.type();
+			o.name = r.atom();
+			o.offset = r.get();
+			if (uint32_t c = r.get(); c)
+			{
+				if (c >= constants.size())
+					r.corrupted();
+				o.init = constants[c];
+			}
+			SymbolTable::Ordinary &ordinary = symbolTable.ordinaries.emplace_back(std::move(o));
+			ordinaries.push_back(&ordinary);
+			if (!bound.empty())
+				symbolTable.get_name(bound).ordinaries.push_back({0, &ordinary});
+		}
+
+		for (uint32_t n = r.get(); n; n--)
+		{
+			SymbolTable::Symbol sym{};
+			sym.name = r.atom();
+			sym.read_only = r.get();
+			sym.visibility = static_cast<SymbolTable::Symbol::Visibility>(r.get());
+			uint32_t o = r.get();
+			if (o >= ordinaries.size())
+				r.corrupted();
+			sym.value = ordinaries[o];
+			sym.size = r.get();
+			symbolTable.symbols.push_back(sym);
+		}
+		return macros;
+	}
+}
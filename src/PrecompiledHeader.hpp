@@ -0,0 +1,14 @@
+#ifndef CC1_POC_PRECOMPILEDHEADER_HPP
+#define CC1_POC_PRECOMPILEDHEADER_HPP
+#include <string>
+
+// State of the compiler after a header: the macros, and the file scope of the symbol table (objects, typedef names,
+// tags, symbols and the constant pool) with the types and identifiers they use. The file contains no address,
+// identifiers and types are written once and referred to by their index in the file, they are interned again when
+// it is loaded. Loading it before the source is parsed is equivalent to including the header, without reading it.
+namespace PrecompiledHeader {
+	void		save(const std::string &path, const std::string &macros);
+	std::string	load(const std::string &path); // restore the file scope and return the macro definitions
+}
+
+#endif
@@ -0,0 +1,1232 @@
+#include "Preprocessor.hpp"
+#include <filesystem>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+
+namespace Preprocessing
+{
+	IncludeCache	includeCache;
+
+	static const char *predefined_macros =
+		"#define __STDC__ 1\n"
+		"#define __STDC_VERSION__ 199901L\n"
+		"#define __STDC_HOSTED__ 1\n"
+		"#define __i386__ 1\n"
+		"#define __i386 1\n"
+		"#define __linux__ 1\n"
+		"#define __unix__ 1\n"
+		"#define __ILP32__ 1\n"
+		"#define __CHAR_BIT__ 8\n"
+		"#define __SIZEOF_INT__ 4\n"
+		"#define __SIZEOF_LONG__ 4\n"
+		"#define __SIZEOF_POINTER__ 4\n"
+		"#define __SIZE_TYPE__ unsigned long int\n"
+		"#define __PTRDIFF_TYPE__ long int\n"
+		// limits.h of the host compiler
+		"#define __SCHAR_MAX__ 0x7f\n"
+		"#define __SHRT_MAX__ 0x7fff\n"
+		"#define __INT_MAX__ 0x7fffffff\n"
+		"#define __LONG_MAX__ 0x7fffffffL\n"
+		"#define __LONG_LONG_MAX__ 0x7fffffffffffffffLL\n"
+		"#define __WCHAR_MAX__ 0x7fffffffL\n"
+		"#define __WCHAR_MIN__ (-__WCHAR_MAX__ - 1)\n";
+
+	// The system directories are those of the host compiler (CC1_HOST_CC, gcc by default) for the 32 bits target:
+	// they include its own headers (stddef.h, stdarg.h) and the multiarch directory of the libc (bits/), whose names
+	// depend on the installation.
+	static const std::vector<std::string> &system_include_paths()
+	{
+		static const std::vector<std::string> paths = [] {
+			std::vector<std::string> ret;
+			const char *cc = getenv("CC1_HOST_CC");
+			std::string command = std::string(cc && *cc ? cc : "gcc") + " -m32 -xc -E -v /dev/null 2>&1 >/dev/null";
+			if (FILE *p = popen(command.c_str(), "r"))
+			{
+				char buf[4096];
+				bool listed = false;
+				while (fgets(buf, sizeof(buf), p))
+				{
+					std::string_view line = buf;
+					if (line.starts_with("#include <...> search starts here:"))
+						listed = true;
+					else if (line.starts_with("End of search list."))
+						listed = false;
+					else if (listed && line.starts_with(" "))
+						ret.emplace_back(line.substr(1, line.find_last_not_of("\r\n")));
+				}
+				pclose(p);
+			}
+			if (ret.empty()) // without a host compiler
+				ret = {"/usr/local/include", "/usr/include/i386-linux-gnu", "/usr/include"};
+			return ret;
+		}();
+		return paths;
+	}
+
+	[[noreturn]] static void error(const Token &t, const std::string &message)
+	{
+		throw std::runtime_error(t.file->path + ":" + std::to_string(t.line) + ": error: " + message);
+	}
+
+	static bool is_identifier_start(char c)
+	{
+		return isalpha((unsigned char)c) || c == '_' || c == '$';
+	}
+
+	static bool is_identifier_char(char c)
+	{
+		return isalnum((unsigned char)c) || c == '_' || c == '$';
+	}
+
+	// end of the character or string literal which starts with the quote at i, npos if it isn't terminated on the line
+	static size_t scan_literal(std::string_view s, size_t i)
+	{
+		char quote = s[i++];
+		for (; i < s.size() && s[i] != quote; i++)
+		{
+			if (s[i] == '\n')
+				return std::string_view::npos;
+			if (s[i] == '\\')
+				i++;
+		}
+		return i < s.size() ? i + 1 : std::string_view::npos;
+	}
+
+	// end of the preprocessing token which starts at i
+	static size_t scan_token(std::string_view s, size_t i, Token::Kind &kind)
+	{
+		static const char *punctuators[] = {
+			"<<=", ">>=", "...", "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+			"*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##", "<:", ":>", "<%", "%>",
+		};
+		char c = s[i];
+		size_t prefix = 0; // L, u, U or u8 of a wide literal
+		if (c == 'L' || c == 'U' || c == 'u')
+			prefix = (c == 'u' && i + 1 < s.size() && s[i + 1] == '8') ? 2 : 1;
+		if (prefix && i + prefix < s.size() && (s[i + prefix] == '"' || s[i + prefix] == '\''))
+		{
+			size_t end = scan_literal(s, i + prefix);
+			if (end != std::string_view::npos)
+			{
+				kind = s[i + prefix] == '"' ? Token::STRING : Token::CHARACTER;
+				return end;
+			}
+		}
+		if (is_identifier_start(c))
+		{
+			kind = Token::IDENTIFIER;
+			while (++i < s.size() && is_identifier_char(s[i]))
+				;
+			return i;
+		}
+		if (isdigit((unsigned char)c) || (c == '.' && i + 1 < s.size() && isdigit((unsigned char)s[i + 1])))
+		{
+			kind = Token::NUMBER;
+			for (i++; i < s.size(); i++)
+			{
+				if (strchr("eEpP", s[i]) && i + 1 < s.size() && (s[i + 1] == '+' || s[i + 1] == '-'))
+					i++;
+				else if (!is_identifier_char(s[i]) && s[i] != '.')
+					break;
+			}
+			return i;
+		}
+		if (c == '"' || c == '\'')
+		{
+			size_t end = scan_literal(s, i);
+			if (end != std::string_view::npos)
+			{
+				kind = c == '"' ? Token::STRING : Token::CHARACTER;
+				return end;
+			}
+			kind = Token::OTHER; // lone quote, it is an error only if it reaches the parser
+			return i + 1;
+		}
+		for (auto p : punctuators)
+			if (s.substr(i).starts_with(p))
+			{
+				kind = Token::PUNCTUATOR;
+				return i + strlen(p);
+			}
+		kind = ispunct((unsigned char)c) ? Token::PUNCTUATOR : Token::OTHER;
+		return i + 1;
+	}
+
+	static void tokenize(IncludedFile &f)
+	{
+		std::string_view s = f.text;
+		int line = 1;
+		bool bol = true;
+		bool space = false;
+		size_t i = 0;
+		while (i < s.size())
+		{
+			char c = s[i];
+			if (c == '\n')
+			{
+				line++;
+				i++;
+				bol = true;
+				space = false;
+			}
+			else if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r')
+			{
+				i++;
+				space = true;
+			}
+			else if (s.substr(i, 2) == "//")
+			{
+				i = s.find('\n', i);
+				if (i == std::string_view::npos)
+					i = s.size();
+				space = true;
+			}
+			else if (s.substr(i, 2) == "/*")
+			{
+				size_t end = s.find("*/", i + 2);
+				if (end == std::string_view::npos)
+					throw std::runtime_error(f.path + ":" + std::to_string(line) + ": error: unterminated comment");
+				line += std::count(s.begin() + i, s.begin() + end, '\n');
+				i = end + 2;
+				space = true;
+			}
+			else
+			{
+				Token::Kind kind;
+				size_t end = scan_token(s, i, kind);
+				f.tokens.push_back({kind, s.substr(i, end - i), &f, line, bol, space, nullptr});
+				bol = false;
+				space = false;
+				i = end;
+			}
+		}
+	}
+
+	// the include guard is an #ifndef whose #endif is the last token of the file
+	static std::string_view find_guard(const std::vector<Token> &t)
+	{
+		if (t.size() < 3 || !t[0].is("#") || !t[1].is("ifndef") || t[2].kind != Token::IDENTIFIER)
+			return {};
+		int depth = 0;
+		for (size_t i = 0; i + 1 < t.size(); i++)
+		{
+			if (!t[i].bol || !t[i].is("#") || t[i + 1].bol)
+				continue;
+			std::string_view d = t[i + 1].text;
+			if (d == "if" || d == "ifdef" || d == "ifndef")
+				depth++;
+			else if ((d == "else" || d == "elif") && depth == 1)
+				return {};
+			else if (d == "endif" && --depth == 0)
+			{
+				for (i += 2; i < t.size(); i++)
+					if (t[i].bol)
+						return {};
+				return t[2].text;
+			}
+		}
+		return {};
+	}
+
+	// remove the backslash-newlines, the removed newlines are added at the end of the logical line to keep the
+	// line numbers of the next lines
+	static void prepare(IncludedFile &f, std::string_view text)
+	{
+		f.text = text;
+		if (text.find("\\\n") != std::string_view::npos)
+		{
+			int pending = 0;
+			f.spliced.reserve(text.size());
+			for (size_t i = 0; i < text.size(); i++)
+			{
+				if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == '\n')
+				{
+					i++;
+					pending++;
+					continue;
+				}
+				f.spliced += text[i];
+				if (text[i] == '\n')
+					for (; pending; pending--)
+						f.spliced += '\n';
+			}
+			f.text = f.spliced;
+		}
+		tokenize(f);
+		f.guard = find_guard(f.tokens);
+	}
+
+	std::string IncludeCache::get_key(const std::string &path) const {
+		if (this->directory.empty() || path[0] == '/')
+			return path;
+		return this->directory + '\0' + path;
+	}
+
+	const IncludedFile *IncludeCache::load(const std::string &path) {
+		std::string name = std::filesystem::path(path).lexically_normal().string();
+		std::string key = this->get_key(name);
+		if (auto it = this->files.find(key); it != this->files.end())
+		{
+			it->second.last_use = this->generation;
+			return it->second.file.get();
+		}
+		if (this->missing.contains(key))
+			return nullptr;
+		auto f = std::make_unique<IncludedFile>();
+		f->path = name;
+		struct stat st;
+		if (!f->source.open(f->path) || stat(f->path.c_str(), &st) < 0)
+		{
+			this->missing.insert(key);
+			return nullptr;
+		}
+		prepare(*f, f->source.view());
+		Entry &e = this->files[key];
+		e.location = this->directory.empty() || f->path[0] == '/' ? f->path : this->directory + "/" + f->path;
+		e.mtime = st.st_mtim;
+		e.size = st.st_size;
+		e.bytes = sizeof(IncludedFile) + f->source.view().size() + f->spliced.size() + f->tokens.capacity() * sizeof(Token);
+		e.last_use = this->generation;
+		this->total += e.bytes;
+		return (e.file = std::move(f)).get();
+	}
+
+	void IncludeCache::set_directory(const std::string &path) {
+		this->directory = path;
+	}
+
+	std::vector<std::string> IncludeCache::get_used() const {
+		std::vector<std::string> ret;
+		for (auto &[key, e] : this->files)
+			if (e.last_use == this->generation)
+				ret.push_back(e.file->path);
+		return ret;
+	}
+
+	void IncludeCache::revalidate() {
+		this->missing.clear();
+		std::erase_if(this->files, [this](const auto &item) {
+			const Entry &e = item.second;
+			struct stat st;
+			if (stat(e.location.c_str(), &st) == 0 && st.st_size == e.size &&
+				st.st_mtim.tv_sec == e.mtime.tv_sec && st.st_mtim.tv_nsec == e.mtime.tv_nsec)
+				return false;
+			this->total -= e.bytes;
+			return true;
+		});
+	}
+
+	void IncludeCache::trim(size_t max_bytes) {
+		if (this->total <= max_bytes)
+			return;
+		std::vector<std::pair<uint64_t, std::string>> order;
+		order.reserve(this->files.size());
+		for (auto &[key, e] : this->files)
+			order.emplace_back(e.last_use, key);
+		std::sort(order.begin(), order.end());
+		for (auto &[last_use, key] : order)
+		{
+			if (this->total <= max_bytes)
+				break;
+			auto it = this->files.find(key);
+			this->total -= it->second.bytes;
+			this->files.erase(it);
+		}
+	}
+
+	Preprocessor::Preprocessor() : command_line(predefined_macros), output_file(nullptr), output_line(0), last_output{}, line_start(true) {
+		this->macros["__FILE__"].builtin = Macro::FILE_NAME;
+		this->macros["__LINE__"].builtin = Macro::LINE_NUMBER;
+	}
+
+	void Preprocessor::add_include_path(const std::string &path) {
+		this->include_paths.push_back(path);
+	}
+
+	void Preprocessor::define(const std::string &definition) {
+		size_t equal = definition.find('=');
+		if (equal == std::string::npos)
+			this->command_line += "#define " + definition + " 1\n";
+		else
+			this->command_line += "#define " + definition.substr(0, equal) + " " + definition.substr(equal + 1) + "\n";
+	}
+
+	void Preprocessor::undefine(const std::string &name) {
+		this->command_line += "#undef " + name + "\n";
+	}
+
+	std::string_view Preprocessor::store(std::string &&s) {
+		return this->strings.emplace_back(std::move(s));
+	}
+
+	const HideSet *Preprocessor::hideset_add(const HideSet *set, std::string_view name) {
+		return &this->hidesets.emplace_back(HideSet{name, set});
+	}
+
+	bool Preprocessor::hideset_contains(const HideSet *set, std::string_view name) {
+		for (; set; set = set->next)
+			if (set->name == name)
+				return true;
+		return false;
+	}
+
+	const HideSet *Preprocessor::hideset_union(const HideSet *l, const HideSet *r) {
+		for (; l; l = l->next)
+			if (!hideset_contains(r, l->name))
+				r = this->hideset_add(r, l->name);
+		return r;
+	}
+
+	const HideSet *Preprocessor::hideset_intersection(const HideSet *l, const HideSet *r) {
+		const HideSet *ret = nullptr;
+		for (; l; l = l->next)
+			if (hideset_contains(r, l->name))
+				ret = this->hideset_add(ret, l->name);
+		return ret;
+	}
+
+	void Preprocessor::enter_file(const IncludedFile *f, int directory) {
+		if (this->sources.size() > 200)
+			throw std::runtime_error(f->path + ": error: #include nested too deeply");
+		this->sources.push_back({{}, f->tokens.data(), f->tokens.data() + f->tokens.size(), f, this->conditionals.size(), directory});
+		if (this->included.insert(f).second)
+			this->dependencies.push_back(f);
+	}
+
+	void Preprocessor::leave_file(const Source &s) {
+		if (this->conditionals.size() > s.conditionals)
+			error(this->conditionals.back().directive, "unterminated #" + std::string(this->conditionals.back().directive.text));
+	}
+
+	// next token without expanding macros, directives are executed when they are reached
+	bool Preprocessor::next_raw(Token &t) {
+		while (!this->sources.empty())
+		{
+			Source &s = this->sources.back();
+			if (s.cur == s.end)
+			{
+				if (s.file)
+					this->leave_file(s);
+				this->sources.pop_back();
+				continue;
+			}
+			if (s.file && s.cur->bol && s.cur->is("#"))
+			{
+				this->directive();
+				continue;
+			}
+			t = *s.cur++;
+			return true;
+		}
+		return false;
+	}
+
+	bool Preprocessor::next(Token &t) {
+		while (this->next_raw(t))
+			if (t.kind != Token::IDENTIFIER || !this->expand(t))
+				return true;
+		return false;
+	}
+
+	// next token if it is already available, doesn't look past the end of the current file nor into a directive
+	const Token *Preprocessor::peek() {
+		for (auto it = this->sources.rbegin(); it != this->sources.rend(); it++)
+		{
+			if (it->cur != it->end)
+				return (it->file && it->cur->bol && it->cur->is("#")) ? nullptr : it->cur;
+			if (it->file)
+				return nullptr;
+		}
+		return nullptr;
+	}
+
+	// rest of the directive line
+	std::vector<Token> Preprocessor::read_line() {
+		Source &s = this->sources.back();
+		const Token *begin = s.cur;
+		while (s.cur != s.end && !s.cur->bol)
+			s.cur++;
+		return {begin, s.cur};
+	}
+
+	// expand a macro invocation, return false if t isn't one
+	bool Preprocessor::expand(const Token &t) {
+		auto it = this->macros.find(t.text);
+		if (it == this->macros.end() || hideset_contains(t.hideset, t.text))
+			return false;
+		const Macro &m = it->second;
+		std::vector<Token> result;
+		if (m.builtin != Macro::NONE)
+		{
+			Token r = t;
+			if (m.builtin == Macro::FILE_NAME)
+			{
+				r.kind = Token::STRING;
+				r.text = this->store("\"" + t.file->path + "\"");
+			}
+			else
+			{
+				r.kind = Token::NUMBER;
+				r.text = this->store(std::to_string(t.line));
+			}
+			result.push_back(r);
+		}
+		else if (!m.function_like)
+			result = this->substitute(t, m, {}, this->hideset_add(t.hideset, t.text));
+		else
+		{
+			const Token *p = this->peek();
+			if (!p || !p->is("("))
+				return false;
+			Token paren;
+			this->next_raw(paren);
+			std::vector<std::vector<Token>> args;
+			this->read_arguments(t, m, args, paren);
+			result = this->substitute(t, m, args, this->hideset_add(this->hideset_intersection(t.hideset, paren.hideset), t.text));
+		}
+		if (!result.empty())
+		{
+			Source &s = this->sources.emplace_back(Source{std::move(result), nullptr, nullptr, nullptr, 0});
+			s.cur = s.owned.data();
+			s.end = s.owned.data() + s.owned.size();
+		}
+		return true;
+	}
+
+	// fully macro expand a list of tokens on its own (macro arguments and #if / #include lines)
+	std::vector<Token> Preprocessor::expand_all(const std::vector<Token> &tokens) {
+		std::vector<Source> saved = std::move(this->sources);
+		this->sources.clear();
+		Source &s = this->sources.emplace_back(Source{tokens, nullptr, nullptr, nullptr, 0});
+		s.cur = s.owned.data();
+		s.end = s.owned.data() + s.owned.size();
+		std::vector<Token> ret;
+		Token t;
+		while (this->next(t))
+			ret.push_back(t);
+		this->sources = std::move(saved);
+		return ret;
+	}
+
+	void Preprocessor::read_arguments(const Token &name, const Macro &m, std::vector<std::vector<Token>> &args, Token &paren) {
+		std::vector<Token> current;
+		int depth = 0;
+		Token t;
+		while (true)
+		{
+			if (!this->next_raw(t))
+				error(name, "unterminated argument list invoking macro \"" + std::string(name.text) + "\"");
+			if (depth == 0 && t.is(")"))
+				break;
+			if (depth == 0 && t.is(",") && !(m.variadic && args.size() == m.params.size() - 1))
+			{
+				args.push_back(std::move(current));
+				current.clear();
+				continue;
+			}
+			if (t.is("("))
+				depth++;
+			else if (t.is(")"))
+				depth--;
+			if (t.bol)
+				t.space = true;
+			t.bol = false;
+			current.push_back(t);
+		}
+		args.push_back(std::move(current));
+		paren = t;
+		if (m.params.empty() && args.size() == 1 && args[0].empty())
+			args.clear();
+		if (m.variadic && args.size() == m.params.size() - 1)
+			args.emplace_back();
+		if (args.size() != m.params.size())
+			error(name, "macro \"" + std::string(name.text) + "\" passed " + std::to_string(args.size()) + " arguments, but takes " + std::to_string(m.params.size()));
+	}
+
+	Token Preprocessor::stringize(const Token &hash, const std::vector<Token> &arg) {
+		std::string s = "\"";
+		for (size_t i = 0; i < arg.size(); i++)
+		{
+			if (i && arg[i].space)
+				s += ' ';
+			if (arg[i].kind == Token::STRING || arg[i].kind == Token::CHARACTER)
+				for (char c : arg[i].text)
+				{
+					if (c == '"' || c == '\\')
+						s += '\\';
+					s += c;
+				}
+			else
+				s += arg[i].text;
+		}
+		s += '"';
+		Token ret = hash;
+		ret.kind = Token::STRING;
+		ret.text = this->store(std::move(s));
+		return ret;
+	}
+
+	Token Preprocessor::paste(const Token &l, const Token &r) {
+		std::string s = std::string(l.text) + std::string(r.text);
+		Token::Kind kind;
+		if (scan_token(s, 0, kind) != s.size())
+			error(l, "pasting \"" + std::string(l.text) + "\" and \"" + std::string(r.text) + "\" does not give a valid preprocessing token");
+		Token ret = l;
+		ret.kind = kind;
+		ret.text = this->store(std::move(s));
+		return ret;
+	}
+
+	// replacement list of an invocation with the arguments substituted, # and ## applied
+	std::vector<Token> Preprocessor::substitute(const Token &name, const Macro &m, const std::vector<std::vector<Token>> &args, const HideSet *hideset) {
+		auto param = [&](size_t i) -> int {
+			if (!m.function_like || i >= m.body.size() || m.body[i].kind != Token::IDENTIFIER)
+				return -1;
+			for (size_t p = 0; p < m.params.size(); p++)
+				if (m.params[p] == m.body[i].text)
+					return p;
+			return -1;
+		};
+		const auto &body = m.body;
+		std::vector<Token> out;
+		for (size_t i = 0; i < body.size(); i++)
+		{
+			const Token &t = body[i];
+			int p = param(i);
+			if (m.function_like && t.is("#") && param(i + 1) >= 0)
+			{
+				out.push_back(this->stringize(t, args[param(i + 1)]));
+				i++;
+			}
+			else if (t.is(",") && i + 2 < body.size() && body[i + 1].is("##") && m.variadic && param(i + 2) == (int)m.params.size() - 1)
+			{
+				// , ## __VA_ARGS__ drops the comma when there are no variable arguments
+				if (!args.back().empty())
+				{
+					out.push_back(t);
+					out.insert(out.end(), args.back().begin(), args.back().end());
+				}
+				i += 2;
+			}
+			else if (t.is("##"))
+			{
+				int q = param(i + 1);
+				if (q < 0)
+					out.back() = this->paste(out.back(), body[i + 1]);
+				else if (!args[q].empty())
+				{
+					out.back() = this->paste(out.back(), args[q].front());
+					out.insert(out.end(), args[q].begin() + 1, args[q].end());
+				}
+				i++;
+			}
+			else if (p >= 0 && i + 1 < body.size() && body[i + 1].is("##"))
+			{
+				if (!args[p].empty())
+					out.insert(out.end(), args[p].begin(), args[p].end());
+				else
+				{
+					// empty left operand, the result of ## is the right operand
+					int q = param(i + 2);
+					if (q >= 0)
+						out.insert(out.end(), args[q].begin(), args[q].end());
+					else if (i + 2 < body.size())
+						out.push_back(body[i + 2]);
+					i += 2;
+				}
+			}
+			else if (p >= 0)
+			{
+				auto expanded = this->expand_all(args[p]);
+				if (!expanded.empty())
+					expanded.front().space = t.space;
+				out.insert(out.end(), expanded.begin(), expanded.end());
+			}
+			else
+				out.push_back(t);
+		}
+		for (auto &t : out)
+		{
+			t.hideset = this->hideset_union(t.hideset, hideset);
+			t.file = name.file;
+			t.line = name.line;
+			t.bol = false;
+		}
+		if (!out.empty())
+			out.front().space = name.space;
+		return out;
+	}
+
+	void Preprocessor::define(const Token &directive, const std::vector<Token> &line) {
+		if (line.empty())
+			error(directive, "no macro name given in #define directive");
+		if (line[0].kind != Token::IDENTIFIER)
+			error(line[0], "macro names must be identifiers");
+		Macro m{false, false, {}, {}};
+		size_t i = 1;
+		if (line.size() > 1 && line[1].is("(") && !line[1].space)
+		{
+			m.function_like = true;
+			i = 2;
+			if (i < line.size() && line[i].is(")"))
+				i++;
+			else
+				while (true)
+				{
+					if (i < line.size() && line[i].is("..."))
+					{
+						m.variadic = true;
+						m.params.push_back("__VA_ARGS__");
+						i++;
+					}
+					else if (i < line.size() && line[i].kind == Token::IDENTIFIER)
+					{
+						m.params.push_back(line[i++].text);
+						if (i < line.size() && line[i].is("...")) // GNU named variable arguments
+						{
+							m.variadic = true;
+							i++;
+						}
+					}
+					else
+						error(i < line.size() ? line[i] : line[0], "expected parameter name in macro parameter list");
+					if (i < line.size() && line[i].is(")"))
+					{
+						i++;
+						break;
+					}
+					if (i >= line.size() || !line[i].is(",") || m.variadic)
+						error(i < line.size() ? line[i] : line[0], "expected ',' or ')' in macro parameter list");
+					i++;
+				}
+		}
+		m.body.assign(line.begin() + i, line.end());
+		if (!m.body.empty() && (m.body.front().is("##") || m.body.back().is("##")))
+			error(line[0], "'##' cannot appear at either end of a macro expansion");
+		for (size_t j = 0; m.function_like && j < m.body.size(); j++)
+			if (m.body[j].is("#") && (j + 1 == m.body.size() ||
+				std::find(m.params.begin(), m.params.end(), m.body[j + 1].text) == m.params.end()))
+				error(m.body[j], "'#' is not followed by a macro parameter");
+		this->macros[line[0].text] = std::move(m);
+	}
+
+	// #include_next resumes the search after the directory where the current file was found, as wrappers of the
+	// headers of the libc do
+	void Preprocessor::include(const Token &directive, std::vector<Token> line, bool next) {
+		if (!line.empty() && line[0].kind != Token::STRING && !line[0].is("<"))
+			line = this->expand_all(line);
+		std::string name;
+		bool quoted = false;
+		if (!line.empty() && line[0].kind == Token::STRING && line[0].text[0] == '"')
+		{
+			name = line[0].text.substr(1, line[0].text.size() - 2);
+			quoted = true;
+		}
+		else if (!line.empty() && line[0].is("<"))
+		{
+			size_t i = 1;
+			for (; i < line.size() && !line[i].is(">"); i++)
+			{
+				if (i > 1 && line[i].space)
+					name += ' ';
+				name += line[i].text;
+			}
+			if (i == line.size())
+				error(directive, "missing terminating > character");
+		}
+		if (name.empty())
+			error(directive, "#include expects \"FILENAME\" or <FILENAME>");
+
+		if (this->search_path.empty())
+		{
+			this->search_path = this->include_paths;
+			if (const char *paths = getenv("C_INCLUDE_PATH"))
+				for (std::string_view rest = paths; !rest.empty();)
+				{
+					size_t colon = std::min(rest.find(':'), rest.size());
+					if (colon)
+						this->search_path.emplace_back(rest.substr(0, colon));
+					rest.remove_prefix(std::min(colon + 1, rest.size()));
+				}
+			for (auto &p : system_include_paths())
+				this->search_path.push_back(p);
+		}
+		int current = -1; // directory of the current file, -1 if it wasn't found in the search path as the main file
+		for (auto it = this->sources.rbegin(); it != this->sources.rend(); it++)
+			if (it->file)
+			{
+				current = it->directory;
+				break;
+			}
+
+		const IncludedFile *f = nullptr;
+		int directory = -1;
+		if (name[0] == '/')
+			f = includeCache.load(name);
+		else
+		{
+			if (quoted && !next)
+			{
+				size_t slash = directive.file->path.rfind('/');
+				f = includeCache.load(slash == std::string::npos ? name : directive.file->path.substr(0, slash + 1) + name);
+			}
+			size_t first = next ? current + 1 : 0;
+			for (size_t i = first; i < this->search_path.size() && !f; i++)
+				if ((f = includeCache.load(this->search_path[i] + "/" + name)))
+					directory = i;
+		}
+		if (!f)
+			error(directive, name + ": No such file or directory");
+		// a file already included with #pragma once or whose include guard is defined would be empty
+		if (this->once.contains(f) || (!f->guard.empty() && this->macros.contains(f->guard)))
+		{
+			if (this->included.insert(f).second)
+				this->dependencies.push_back(f);
+			return;
+		}
+		this->enter_file(f, directory);
+	}
+
+	// skip the lines of a conditional group which is not included, stop on the #elif, #else or #endif which ends it
+	void Preprocessor::skip_group() {
+		Source &s = this->sources.back();
+		int depth = 0;
+		for (; s.cur != s.end; s.cur++)
+		{
+			if (!s.cur->bol || !s.cur->is("#") || s.cur + 1 == s.end || s.cur[1].bol)
+				continue;
+			std::string_view d = s.cur[1].text;
+			if (d == "if" || d == "ifdef" || d == "ifndef")
+				depth++;
+			else if (d == "endif" || d == "elif" || d == "else")
+			{
+				if (depth == 0)
+					return;
+				if (d == "endif")
+					depth--;
+			}
+		}
+	}
+
+	static intmax_t character_value(const Token &t)
+	{
+		std::string_view s = t.text.substr(t.text.find('\'') + 1);
+		if (s[0] != '\\')
+			return (char)s[0];
+		switch (s[1])
+		{
+			case 'a': return '\a';
+			case 'b': return '\b';
+			case 'f': return '\f';
+			case 'n': return '\n';
+			case 'r': return '\r';
+			case 't': return '\t';
+			case 'v': return '\v';
+			case 'x':
+				return (char)std::stoi(std::string(s.substr(2, s.find('\'') - 2)), nullptr, 16);
+			default:
+				if (s[1] >= '0' && s[1] <= '7')
+					return (char)std::stoi(std::string(s.substr(1, s.find('\'') - 1)), nullptr, 8);
+				return s[1];
+		}
+	}
+
+	// constant expression of #if and #elif
+	class ExpressionEvaluator {
+	private:
+		const std::vector<Token>	&tokens;
+		const Token					&directive;
+		int							unevaluated = 0; // inside the operand of && || ?: which is not evaluated
+	public:
+		size_t						i = 0;
+
+		ExpressionEvaluator(const std::vector<Token> &t, const Token &d) : tokens(t), directive(d) {}
+
+		const Token &get() {
+			if (this->i == this->tokens.size())
+				error(this->directive, "missing expression in #" + std::string(this->directive.text));
+			return this->tokens[this->i++];
+		}
+
+		void expect(std::string_view s) {
+			const Token &t = this->get();
+			if (!t.is(s))
+				error(t, "expected '" + std::string(s) + "' in preprocessor expression");
+		}
+
+		intmax_t primary() {
+			const Token &t = this->get();
+			if (t.is("("))
+			{
+				intmax_t v = this->conditional();
+				this->expect(")");
+				return v;
+			}
+			if (t.is("+"))
+				return this->primary();
+			if (t.is("-"))
+				return -this->primary();
+			if (t.is("~"))
+				return ~this->primary();
+			if (t.is("!"))
+				return !this->primary();
+			if (t.kind == Token::CHARACTER)
+				return character_value(t);
+			if (t.kind == Token::NUMBER)
+			{
+				std::string s(t.text);
+				while (!s.empty() && strchr("uUlL", s.back()))
+					s.pop_back();
+				size_t end = 0;
+				intmax_t v = 0;
+				try {
+					v = std::stoull(s, &end, 0);
+				}
+				catch (std::exception &) {}
+				if (s.empty() || end != s.size())
+					error(t, "invalid integer constant \"" + std::string(t.text) + "\" in preprocessor expression");
+				return v;
+			}
+			error(t, "token \"" + std::string(t.text) + "\" is not valid in preprocessor expressions");
+		}
+
+		static int precedence(const Token &t) {
+			static const std::pair<std::string_view, int> operators[] = {
+				{"||", 0}, {"&&", 1}, {"|", 2}, {"^", 3}, {"&", 4}, {"==", 5}, {"!=", 5},
+				{"<", 6}, {">", 6}, {"<=", 6}, {">=", 6}, {"<<", 7}, {">>", 7},
+				{"+", 8}, {"-", 8}, {"*", 9}, {"/", 9}, {"%", 9},
+			};
+			if (t.kind != Token::PUNCTUATOR)
+				return -1;
+			for (auto &[op, p] : operators)
+				if (t.text == op)
+					return p;
+			return -1;
+		}
+
+		intmax_t binary(int min_precedence) {
+			intmax_t l = this->primary();
+			while (this->i < this->tokens.size())
+			{
+				const Token &op = this->tokens[this->i];
+				int p = precedence(op);
+				if (p < min_precedence)
+					break;
+				this->i++;
+				bool skip = (op.is("&&") && !l) || (op.is("||") && l);
+				this->unevaluated += skip;
+				intmax_t r = this->binary(p + 1);
+				this->unevaluated -= skip;
+				if ((op.is("/") || op.is("%")) && r == 0)
+				{
+					if (!this->unevaluated)
+						error(op, "division by zero in #" + std::string(this->directive.text));
+					r = 1;
+				}
+				switch (op.text[0])
+				{
+					case '|': l = op.text.size() == 2 ? l || r : l | r; break;
+					case '&': l = op.text.size() == 2 ? l && r : l & r; break;
+					case '^': l ^= r; break;
+					case '=': l = l == r; break;
+					case '!': l = l != r; break;
+					case '<': l = op.text == "<" ? l < r : op.text == "<=" ? l <= r : l << r; break;
+					case '>': l = op.text == ">" ? l > r : op.text == ">=" ? l >= r : l >> r; break;
+					case '+': l += r; break;
+					case '-': l -= r; break;
+					case '*': l *= r; break;
+					case '/': l /= r; break;
+					case '%': l %= r; break;
+				}
+			}
+			return l;
+		}
+
+		intmax_t conditional() {
+			intmax_t c = this->binary(0);
+			if (this->i == this->tokens.size() || !this->tokens[this->i].is("?"))
+				return c;
+			this->i++;
+			this->unevaluated += !c;
+			intmax_t a = this->conditional();
+			this->unevaluated -= !c;
+			this->expect(":");
+			this->unevaluated += !!c;
+			intmax_t b = this->conditional();
+			this->unevaluated -= !!c;
+			return c ? a : b;
+		}
+	};
+
+	bool Preprocessor::evaluate(const Token &directive, std::vector<Token> line) {
+		// defined must be replaced before the macros are expanded
+		std::vector<Token> tokens;
+		for (size_t i = 0; i < line.size(); i++)
+		{
+			if (!line[i].is("defined"))
+			{
+				tokens.push_back(line[i]);
+				continue;
+			}
+			bool paren = i + 1 < line.size() && line[i + 1].is("(");
+			size_t j = i + 1 + paren;
+			if (j >= line.size() || line[j].kind != Token::IDENTIFIER)
+				error(line[i], "operator \"defined\" requires an identifier");
+			if (paren && (j + 1 >= line.size() || !line[j + 1].is(")")))
+				error(line[i], "missing ')' after \"defined\"");
+			Token t = line[i];
+			t.kind = Token::NUMBER;
+			t.text = this->macros.contains(line[j].text) ? "1" : "0";
+			tokens.push_back(t);
+			i = j + paren;
+		}
+		tokens = this->expand_all(tokens);
+		for (auto &t : tokens)
+			if (t.kind == Token::IDENTIFIER) // identifiers left after expansion are 0
+			{
+				t.kind = Token::NUMBER;
+				t.text = "0";
+			}
+		ExpressionEvaluator e(tokens, directive);
+		bool ret = e.conditional() != 0;
+		if (e.i != tokens.size())
+			error(tokens[e.i], "missing binary operator before token \"" + std::string(tokens[e.i].text) + "\"");
+		return ret;
+	}
+
+	void Preprocessor::directive() {
+		Source &s = this->sources.back();
+		s.cur++; // #
+		if (s.cur == s.end || s.cur->bol) // null directive
+			return;
+		Token name = *s.cur++;
+		std::vector<Token> line = this->read_line();
+		std::string_view d = name.text;
+		auto check_conditional = [&]() -> Conditional & {
+			if (this->conditionals.size() <= this->sources.back().conditionals)
+				error(name, "#" + std::string(d) + " without #if");
+			return this->conditionals.back();
+		};
+
+		if (name.kind == Token::NUMBER || d == "line") // line marker of an already preprocessed file
+			return;
+		if (d == "define")
+			this->define(name, line);
+		else if (d == "undef")
+		{
+			if (line.empty() || line[0].kind != Token::IDENTIFIER)
+				error(name, "macro names must be identifiers");
+			this->macros.erase(line[0].text);
+		}
+		else if (d == "include" || d == "include_next")
+			this->include(name, std::move(line), d == "include_next");
+		else if (d == "ifdef" || d == "ifndef")
+		{
+			if (line.empty() || line[0].kind != Token::IDENTIFIER)
+				error(name, "no macro name given in #" + std::string(d) + " directive");
+			bool taken = this->macros.contains(line[0].text) == (d == "ifdef");
+			this->conditionals.push_back({Conditional::THEN, taken, name});
+			if (!taken)
+				this->skip_group();
+		}
+		else if (d == "if")
+		{
+			bool taken = this->evaluate(name, std::move(line));
+			this->conditionals.push_back({Conditional::THEN, taken, name});
+			if (!taken)
+				this->skip_group();
+		}
+		else if (d == "elif")
+		{
+			Conditional &c = check_conditional();
+			if (c.context == Conditional::ELSE)
+				error(name, "#elif after #else");
+			c.context = Conditional::ELIF;
+			if (c.taken || !this->evaluate(name, std::move(line)))
+				this->skip_group();
+			else
+				c.taken = true;
+		}
+		else if (d == "else")
+		{
+			Conditional &c = check_conditional();
+			if (c.context == Conditional::ELSE)
+				error(name, "#else after #else");
+			c.context = Conditional::ELSE;
+			if (c.taken)
+				this->skip_group();
+			else
+				c.taken = true;
+		}
+		else if (d == "endif")
+		{
+			check_conditional();
+			this->conditionals.pop_back();
+		}
+		else if (d == "pragma")
+		{
+			if (!line.empty() && line[0].is("once"))
+				this->once.insert(name.file);
+			// other pragmas are ignored
+		}
+		else if (d == "error" || d == "warning")
+		{
+			std::string message = "#" + std::string(d);
+			for (auto &t : line)
+				message += " " + std::string(t.text);
+			if (d == "error")
+				error(name, message);
+			std::cerr << name.file->path << ":" << name.line << ": warning: " << message << std::endl;
+		}
+		else
+			error(name, "invalid preprocessing directive #" + std::string(d));
+	}
+
+	// a space is needed between two adjacent tokens if they would be read as a different token otherwise
+	static bool avoid_paste(const Token &l, const Token &r)
+	{
+		char a = l.text.back();
+		char b = r.text.front();
+		if (l.kind == Token::IDENTIFIER || l.kind == Token::NUMBER)
+			return r.kind == Token::IDENTIFIER || r.kind == Token::NUMBER || r.kind == Token::STRING || r.kind == Token::CHARACTER ||
+				(l.kind == Token::NUMBER && (b == '.' || ((b == '+' || b == '-') && strchr("eEpP", a))));
+		if (l.kind != Token::PUNCTUATOR)
+			return false;
+		if (a == '/' && (b == '/' || b == '*'))
+			return true;
+		if (a == '.' && r.kind == Token::NUMBER)
+			return true;
+		if (r.kind != Token::PUNCTUATOR)
+			return false;
+		std::string s = std::string(l.text) + std::string(r.text.substr(0, 2));
+		Token::Kind kind;
+		return scan_token(s, 0, kind) > l.text.size();
+	}
+
+	// blanks before the first token of a line in its file, kept so that the columns of diagnostics are unchanged
+	static std::string_view	indentation(const Token &t) {
+		const char *begin = t.file->text.data();
+		const char *p = t.text.data();
+		if (!t.bol || p < begin || p > begin + t.file->text.size())
+			return {};
+		while (p > begin && (p[-1] == ' ' || p[-1] == '\t'))
+			p--;
+		if (p > begin && p[-1] != '\n')
+			return {};
+		return {p, t.text.data()};
+	}
+
+	void Preprocessor::emit(const Token &t) {
+		if (t.file != this->output_file || t.line < this->output_line || t.line > this->output_line + 8)
+		{
+			if (!this->line_start)
+				this->output += '\n';
+			this->output += "# " + std::to_string(t.line) + " \"" + t.file->path + "\"\n";
+			this->output_file = t.file;
+			this->output_line = t.line;
+			this->line_start = true;
+		}
+		for (; this->output_line < t.line; this->output_line++)
+		{
+			this->output += '\n';
+			this->line_start = true;
+		}
+		if (this->line_start)
+			this->output += indentation(t);
+		else if (t.space || avoid_paste(this->last_output, t))
+			this->output += ' ';
+		this->output += t.text;
+		this->last_output = t;
+		this->line_start = false;
+	}
+
+	std::string Preprocessor::run(const std::string &path, std::string_view text) {
+		IncludedFile &command_line = *this->files.emplace_back(new IncludedFile);
+		command_line.path = "<command-line>";
+		prepare(command_line, this->command_line);
+		IncludedFile &main = *this->files.emplace_back(new IncludedFile);
+		main.path = path;
+		prepare(main, text);
+
+		this->output.reserve(text.size() + text.size() / 2);
+		this->enter_file(&main);
+		this->enter_file(&command_line); // read first
+		Token t;
+		while (this->next(t))
+			this->emit(t);
+		if (!this->line_start)
+			this->output += '\n';
+		return std::move(this->output);
+	}
+
+	// sorted by name so that the same macros always give the same text
+	std::string Preprocessor::get_definitions() const {
+		std::vector<std::pair<std::string_view, const Macro *>> sorted;
+		for (auto &[name, m] : this->macros)
+			if (m.builtin == Macro::NONE)
+				sorted.emplace_back(name, &m);
+		std::sort(sorted.begin(), sorted.end());
+		std::string ret;
+		for (auto &[name, m] : sorted)
+		{
+			ret += "#define ";
+			ret += name;
+			if (m->function_like)
+			{
+				ret += '(';
+				for (size_t i = 0; i < m->params.size(); i++)
+				{
+					if (i)
+						ret += ',';
+					if (m->variadic && i + 1 == m->params.size())
+						ret += m->params[i] == "__VA_ARGS__" ? "..." : std::string(m->params[i]) + "...";
+					else
+						ret += m->params[i];
+				}
+				ret += ')';
+			}
+			for (size_t i = 0; i < m->body.size(); i++)
+			{
+				if (i == 0 || m->body[i].space)
+					ret += ' ';
+				ret += m->body[i].text;
+			}
+			ret += '\n';
+		}
+		return ret;
+	}
+
+	void Preprocessor::add_definitions(const std::string &directives) {
+		this->command_line += directives;
+	}
+
+	std::string Preprocessor::get_dependencies(const std::string &target) const {
+		std::string rule = target + ":";
+		size_t column = rule.size();
+		for (auto *f : this->dependencies)
+		{
+			if (f->path[0] == '<')
+				continue;
+			std::string name;
+			for (char c : f->path)
+			{
+				if (c == ' ' || c == '#')
+					name += '\\';
+				else if (c == '$')
+					name += '$';
+				name += c;
+			}
+			if (column + name.size() + 1 > 78)
+			{
+				rule += " \\\n";
+				column = 0;
+			}
+			rule += ' ' + name;
+			column += name.size() + 1;
+		}
+		return rule + '\n';
+	}
+}
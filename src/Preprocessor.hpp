@@ -0,0 +1,177 @@
+#ifndef CC1_POC_PREPROCESSOR_HPP
+#define CC1_POC_PREPROCESSOR_HPP
+#include "SourceFile.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <sys/stat.h>
+
+namespace Preprocessing
+{
+	struct IncludedFile;
+
+	// set of macros which must not be expanded again in a token (C11 6.10.3.4), immutable linked list
+	struct HideSet {
+		std::string_view	name;
+		const HideSet		*next;
+	};
+
+	struct Token {
+		enum Kind {
+			IDENTIFIER,
+			NUMBER,
+			CHARACTER,
+			STRING,
+			PUNCTUATOR,
+			OTHER
+		};
+		Kind				kind;
+		std::string_view	text; // points into the file or into the storage of the preprocessor
+		const IncludedFile	*file;
+		int					line;
+		bool				bol; // first token of a line
+		bool				space; // preceded by white spaces
+		const HideSet		*hideset;
+
+		bool is(std::string_view s) const { return this->text == s && this->kind != STRING && this->kind != CHARACTER; }
+	};
+
+	struct IncludedFile {
+		std::string			path;
+		SourceFile			source;
+		std::string			spliced; // content without the backslash-newlines, when there are some
+		std::string_view	text;
+		std::vector<Token>	tokens;
+		std::string_view	guard; // macro of the #ifndef/#endif include guard around the whole file, if any
+	};
+
+	// Files read by the preprocessor, kept in memory already split into tokens so that a header included by
+	// several files (or several times) is read and tokenized only once.
+	// The compile server keeps it between jobs: relative paths are then resolved against the working directory of
+	// the job, files modified since they were read are dropped, and the least recently used ones are evicted when
+	// the cache grows too large.
+	class IncludeCache {
+	private:
+		struct Entry {
+			std::unique_ptr<IncludedFile>	file;
+			std::string						location; // path to stat, absolute if a directory is set
+			struct timespec					mtime;
+			off_t							size;
+			size_t							bytes; // memory used by the file and its tokens
+			uint64_t						last_use;
+		};
+		std::unordered_map<std::string, Entry>	files;
+		std::unordered_set<std::string>			missing;
+		std::string								directory; // working directory, empty when there is only one
+		uint64_t								generation = 0;
+		size_t									total = 0; // sum of the bytes of the entries
+
+		std::string			get_key(const std::string &path) const; // path is normalized
+	public:
+		const IncludedFile	*load(const std::string &path); // nullptr if the file can't be read
+		void				set_directory(const std::string &path);
+		void				next_generation() { this->generation++; }
+		std::vector<std::string>	get_used() const; // paths loaded since the last call to next_generation
+		void				revalidate(); // drop the files which changed on disk and forget the missing ones
+		void				trim(size_t max_bytes); // evict the least recently used files
+		size_t				size() const { return this->total; }
+	};
+
+	struct Macro {
+		bool						function_like;
+		bool						variadic;
+		std::vector<std::string_view>	params;
+		std::vector<Token>			body;
+		enum Builtin {
+			NONE,
+			FILE_NAME, // __FILE__
+			LINE_NUMBER, // __LINE__
+		}							builtin = NONE;
+	};
+
+	class Preprocessor {
+	private:
+		// tokens currently read, either the rest of a file or the result of a macro expansion
+		struct Source {
+			std::vector<Token>	owned;
+			const Token			*cur;
+			const Token			*end;
+			const IncludedFile	*file; // nullptr for a macro expansion
+			size_t				conditionals; // depth of the conditional stack when the file was entered
+			int					directory = -1; // index in the search path of the directory the file was found in
+		};
+		struct Conditional {
+			enum Context {
+				THEN,
+				ELIF,
+				ELSE
+			};
+			Context	context;
+			bool	taken; // a group of this conditional has been included
+			Token	directive;
+		};
+
+		std::unordered_map<std::string_view, Macro>	macros;
+		std::vector<Source>				sources;
+		std::vector<Conditional>		conditionals;
+		std::deque<std::string>			strings; // text of the tokens created by the preprocessor
+		std::deque<HideSet>				hidesets;
+		std::vector<std::unique_ptr<IncludedFile>>	files; // main file and command line definitions, not cached
+		std::string						command_line; // predefined macros, -D and -U as directives
+		std::vector<const IncludedFile *>	dependencies;
+		std::unordered_set<const IncludedFile *>	included;
+		std::unordered_set<const IncludedFile *>	once; // files with #pragma once
+		std::vector<std::string>		include_paths;
+		std::vector<std::string>		search_path; // directories searched for <...>: -I, C_INCLUDE_PATH, the system
+
+		std::string						output;
+		const IncludedFile				*output_file;
+		int								output_line;
+		Token							last_output;
+		bool							line_start;
+
+		std::string_view	store(std::string &&);
+		const HideSet		*hideset_add(const HideSet *, std::string_view);
+		const HideSet		*hideset_union(const HideSet *, const HideSet *);
+		const HideSet		*hideset_intersection(const HideSet *, const HideSet *);
+		static bool			hideset_contains(const HideSet *, std::string_view);
+
+		void				enter_file(const IncludedFile *, int directory = -1);
+		void				leave_file(const Source &);
+		const Token			*peek();
+		bool				next_raw(Token &);
+		bool				next(Token &);
+		std::vector<Token>	read_line();
+		void				directive();
+		void				define(const Token &, const std::vector<Token> &);
+		void				include(const Token &, std::vector<Token>, bool next);
+		void				skip_group();
+		bool				evaluate(const Token &, std::vector<Token>);
+		bool				expand(const Token &);
+		std::vector<Token>	expand_all(const std::vector<Token> &);
+		void				read_arguments(const Token &, const Macro &, std::vector<std::vector<Token>> &, Token &);
+		std::vector<Token>	substitute(const Token &, const Macro &, const std::vector<std::vector<Token>> &, const HideSet *);
+		Token				stringize(const Token &, const std::vector<Token> &);
+		Token				paste(const Token &, const Token &);
+		void				emit(const Token &);
+	public:
+		Preprocessor();
+
+		void				add_include_path(const std::string &);
+		void				define(const std::string &); // -D name or name=value
+		void				undefine(const std::string &);
+		std::string			run(const std::string &path, std::string_view text);
+		std::string			get_dependencies(const std::string &target) const; // make rule for -MD
+		std::string			get_definitions() const; // macros currently defined, as #define directives
+		void				add_definitions(const std::string &); // directives read after the -D and -U given before
+	};
+
+	extern IncludeCache	includeCache;
+}
+
+#endif
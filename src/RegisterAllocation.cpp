@@ -0,0 +1,240 @@
+#include "CodeGeneration.hpp"
+#include "ControlFlow.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// Linear scan allocation (Poletto and Sarkar): each temp is given one register for its whole live interval, or a
+// slot in the frame. The intervals are computed from the liveness of the temps on the control flow graph, so that a
+// temp read in a loop before it is written again stays live along the back edge.
+// EAX and EBX are not allocated: every operation is translated through them. A register is not given to a temp live
+// across an instruction which overwrites it: a call (ECX, EDX) or a multiplication or division (EDX).
+namespace CodeGeneration
+{
+	static const Register allocatable[] = {ECX, EDX, ESI, EDI}; // the caller saved ones first, they cost no save
+
+	// one bit per temp
+	class TempSet {
+	private:
+		std::vector<uint64_t>	words;
+	public:
+		explicit TempSet(size_t size = 0) : words((size + 63) / 64) {}
+		bool	contains(int t) const { return this->words[t / 64] >> (t % 64) & 1; }
+		void	insert(int t) { this->words[t / 64] |= (uint64_t)1 << (t % 64); }
+		// this = use | (out & ~def), true if it changed
+		bool	assign_transfer(const TempSet &use, const TempSet &out, const TempSet &def) {
+			bool changed = false;
+			for (size_t i = 0; i < this->words.size(); i++)
+			{
+				uint64_t w = use.words[i] | (out.words[i] & ~def.words[i]);
+				changed |= w != this->words[i];
+				this->words[i] = w;
+			}
+			return changed;
+		}
+		void	merge(const TempSet &o) {
+			for (size_t i = 0; i < this->words.size(); i++)
+				this->words[i] |= o.words[i];
+		}
+		template <class F>
+		void	for_each(F f) const {
+			for (size_t i = 0; i < this->words.size(); i++)
+				for (uint64_t w = this->words[i]; w; w &= w - 1)
+					f(i * 64 + __builtin_ctzll(w));
+		}
+	};
+
+	struct Interval {
+		int			temp;
+		int			begin = INT_MAX; // first instruction where the temp is live
+		int			end = -1; // last one
+		double		weight = 0; // cost of keeping the temp in memory: its uses, more in loops, per instruction
+		unsigned	allowed = 0; // mask of the allocatable registers it can be given
+		int			reg = -1; // index in allocatable
+	};
+
+	// Calls f(temp, written) for the temps read, then written, at the instruction: a temp defined by a dereference
+	// holds the pointer, mentioning it anywhere else reads the pointer. The parameters are loaded by the call.
+	template <class F>
+	static void for_each_temp(const std::vector<TAC::Instruction> &instructions, size_t index, const std::vector<bool> &dereferences, F f) {
+		const TAC::Instruction &i = instructions[index];
+		auto read = [&](const TAC::Address &a) {
+			if (holds_alternative<int>(a))
+				f(get<int>(a), false);
+		};
+		switch (i.op)
+		{
+			case TAC::PARAM:
+				return;
+			case TAC::CALL:
+				for (size_t p = index; p > 0 && instructions[p - 1].op == TAC::PARAM; p--)
+					read(instructions[p - 1].oper1);
+				break;
+			default:
+				break;
+		}
+		read(i.oper1);
+		read(i.oper2);
+		if (!holds_alternative<int>(i.ret))
+			return;
+		int t = get<int>(i.ret);
+		f(t, i.op == TAC::DEREFERENCE || !dereferences[t]);
+	}
+
+	RegisterAssignment allocate_registers(const TAC::TacFunction &f) {
+		const auto &instructions = f.get_instructions();
+		const auto &temps = f.get_temps();
+		const auto &labels = f.get_labels();
+		RegisterAssignment ret;
+		ret.registers.resize(temps.size());
+		ret.dereferences.resize(temps.size());
+		ret.used.resize(temps.size());
+		if (instructions.empty())
+			return ret;
+
+		std::vector<bool> address_taken(temps.size());
+		for (auto &i : instructions)
+		{
+			if (i.op == TAC::DEREFERENCE)
+				ret.dereferences[get<int>(i.ret)] = true;
+			if (i.op == TAC::ADDRESS && holds_alternative<int>(i.oper1))
+				address_taken[get<int>(i.oper1)] = true;
+		}
+
+		// liveness on the blocks
+		TAC::ControlFlowGraph cfg(f);
+		const auto &blocks = cfg.get_blocks();
+		std::vector<TempSet> use(blocks.size(), TempSet(temps.size())), def = use, live_in = use, live_out = use;
+		for (size_t b = 0; b < blocks.size(); b++)
+			for (size_t i = blocks[b].begin; i < blocks[b].end; i++)
+				for_each_temp(instructions, i, ret.dereferences, [&](int t, bool written) {
+					ret.used[t] = true;
+					if (written)
+						def[b].insert(t);
+					else if (!def[b].contains(t))
+						use[b].insert(t);
+				});
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+			for (size_t b = blocks.size(); b-- > 0;)
+			{
+				for (int s : blocks[b].successors)
+					live_out[b].merge(live_in[s]);
+				changed |= live_in[b].assign_transfer(use[b], live_out[b], def[b]);
+			}
+		}
+
+		// loop depth of each instruction, the loops are the ranges of the backward jumps
+		std::vector<int> depth(instructions.size() + 1);
+		for (size_t i = 0; i < instructions.size(); i++)
+			if (instructions[i].is_jump() && labels[get<TAC::Label>(instructions[i].ret)] >= 0 && labels[get<TAC::Label>(instructions[i].ret)] <= (int)i)
+			{
+				depth[labels[get<TAC::Label>(instructions[i].ret)]]++;
+				depth[i + 1]--;
+			}
+		for (size_t i = 1; i < depth.size(); i++)
+			depth[i] += depth[i - 1];
+
+		std::vector<Interval> intervals(temps.size());
+		for (size_t t = 0; t < temps.size(); t++)
+			intervals[t].temp = t;
+		auto extend = [&](int t, int position) {
+			intervals[t].begin = std::min(intervals[t].begin, position);
+			intervals[t].end = std::max(intervals[t].end, position);
+		};
+		std::vector<size_t> calls, divisions; // instructions overwriting ECX and EDX, or EDX
+		std::vector<bool> bytes(temps.size()); // temps read or written by an operation on a single byte
+		for (size_t i = 0; i < instructions.size(); i++)
+		{
+			// a dereferenced temp holds the pointer, it is only used as an address
+			if (instructions[i].operation_size == 1)
+				for (const TAC::Address *a : {&instructions[i].ret, &instructions[i].oper1, &instructions[i].oper2})
+					if (holds_alternative<int>(*a) && !ret.dereferences[get<int>(*a)])
+						bytes[get<int>(*a)] = true;
+			for_each_temp(instructions, i, ret.dereferences, [&](int t, bool) {
+				extend(t, i);
+				intervals[t].weight += std::pow(10.0, std::min(depth[i], 6));
+			});
+			if (instructions[i].op == TAC::CALL)
+				calls.push_back(i);
+			else if (instructions[i].op == TAC::MUL || instructions[i].op == TAC::DIV || instructions[i].op == TAC::MOD)
+				divisions.push_back(i);
+		}
+		for (size_t b = 0; b < blocks.size(); b++)
+		{
+			live_in[b].for_each([&](int t) { extend(t, blocks[b].begin); });
+			live_out[b].for_each([&](int t) { extend(t, blocks[b].end - 1); });
+		}
+
+		// the operands are loaded before the register is overwritten and the result is stored after, but a pointer to
+		// the result is read after
+		auto crosses = [&](const Interval &interval, const std::vector<size_t> &positions) {
+			for (auto it = std::lower_bound(positions.begin(), positions.end(), (size_t)interval.begin); it != positions.end() && (int)*it <= interval.end; it++)
+			{
+				const TAC::Address &result = instructions[*it].ret;
+				if (holds_alternative<int>(result) && get<int>(result) == interval.temp)
+				{
+					if (ret.dereferences[interval.temp])
+						return true;
+				}
+				else if ((int)*it < interval.end)
+					return true;
+			}
+			return false;
+		};
+		std::vector<Interval *> sorted;
+		for (auto &interval : intervals)
+		{
+			int t = interval.temp;
+			if (!ret.used[t] || (address_taken[t] && !ret.dereferences[t]))
+				continue;
+			size_t size = PTR_SIZE;
+			if (!ret.dereferences[t] && !holds_alternative<Types::FunctionType>(temps[t]->type))
+				size = symbolTable.size_of(temps[t]);
+			if (size != 1 && size != 2 && size != 4)
+				continue;
+			interval.allowed = size == 1 || bytes[t] ? 0b0011 : 0b1111; // esi and edi have no 8 bits part
+			if (crosses(interval, calls))
+				interval.allowed &= 0b1100;
+			if (crosses(interval, divisions))
+				interval.allowed &= ~0b0010;
+			interval.weight /= interval.end - interval.begin + 1;
+			if (interval.allowed)
+				sorted.push_back(&interval);
+		}
+		std::stable_sort(sorted.begin(), sorted.end(), [](Interval *a, Interval *b) { return a->begin < b->begin; });
+
+		std::vector<Interval *> active; // by register
+		active.resize(std::size(allocatable));
+		for (Interval *current : sorted)
+		{
+			for (auto &a : active)
+				if (a && a->end < current->begin)
+					a = nullptr;
+			int reg = -1;
+			for (int r = 0; r < (int)std::size(allocatable) && reg < 0; r++)
+				if (current->allowed >> r & 1 && !active[r])
+					reg = r;
+			if (reg < 0) // the one of the lowest weight goes to memory, the current one or one holding a register it can have
+			{
+				for (int r = 0; r < (int)std::size(allocatable); r++)
+					if (current->allowed >> r & 1 && active[r]->weight < current->weight && (reg < 0 || active[r]->weight < active[reg]->weight))
+						reg = r;
+				if (reg < 0)
+					continue;
+				active[reg]->reg = -1;
+			}
+			current->reg = reg;
+			active[reg] = current;
+		}
+
+		for (auto &interval : intervals)
+			if (interval.reg >= 0)
+				ret.registers[interval.temp] = allocatable[interval.reg];
+		for (Register r : {ESI, EDI})
+			if (std::find(ret.registers.begin(), ret.registers.end(), r) != ret.registers.end())
+				ret.callee_saved.push_back(r);
+		return ret;
+	}
+}
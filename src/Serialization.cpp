@@ -0,0 +1,211 @@
+#include "Serialization.hpp"
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+namespace Serialization {
+
+	void Writer::put_constant(std::string &s, const SymbolTable::Constant &c) {
+		put(s, c.value.index());
+		switch (c.value.index())
+		{
+			case 0: // exact, and without the padding bytes of a long double
+			{
+				char buf[64];
+				snprintf(buf, sizeof(buf), "%La", get<0>(c.value));
+				put_string(s, buf);
+				break;
+			}
+			case 1:
+				put(s, get<1>(c.value));
+				put(s, get<1>(c.value) >> 32);
+				break;
+			case 2:
+				put_string(s, get<2>(c.value));
+				break;
+		}
+	}
+
+	uint32_t Writer::atom(Atom a) {
+		if (a.empty())
+			return 0;
+		auto [it, inserted] = this->atom_index.emplace(a.get_id(), this->atom_count + 1);
+		if (inserted)
+		{
+			this->atom_count++;
+			put_string(this->atoms, a.str());
+		}
+		return it->second;
+	}
+
+	uint32_t Writer::type(const Types::CType &t) {
+		Types::TypeId id(t);
+		if (auto it = this->type_index.find(id.get_id()); it != this->type_index.end())
+			return it->second;
+		std::string node;
+		put(node, t.type.index());
+		put(node, t.qualifier);
+		put(node, t.is_lvalue);
+		switch (t.type.index())
+		{
+			case 0: // PlainType
+				put(node, std::get<Types::PlainType>(t.type).base);
+				put(node, std::get<Types::PlainType>(t.type).is_signed);
+				break;
+			case 1: // TagName
+				put(node, std::get<Types::TagName>(t.type).type);
+				put(node, this->atom(std::get<Types::TagName>(t.type).name));
+				break;
+			case 2: // Pointer
+				put(node, this->type(*std::get<Types::Pointer>(t.type).pointed_type));
+				break;
+			case 3: // FunctionType
+			{
+				auto &function = std::get<Types::FunctionType>(t.type);
+				put(node, this->type(*function.return_type));
+				put(node, function.variadic);
+				put(node, function.parameters.size());
+				for (auto &p : function.parameters)
+					put(node, this->type(p));
+				break;
+			}
+			case 4: // Array
+			{
+				auto &array = std::get<Types::Array>(t.type);
+				put(node, this->type(*array.value_type));
+				put(node, array.size.has_value());
+				put(node, array.size.value_or(0));
+				break;
+			}
+			case 5: // Typename
+				put(node, this->atom(std::get<Types::Typename>(t.type).name));
+				break;
+		}
+		this->types += node;
+		return this->type_index[id.get_id()] = ++this->type_count;
+	}
+
+	std::string Writer::finish(std::string_view magic) const {
+		std::string ret(magic);
+		put(ret, this->atom_count);
+		ret += this->atoms;
+		put(ret, this->type_count);
+		ret += this->types;
+		return ret + this->body;
+	}
+
+	uint32_t Reader::get() {
+		uint32_t v;
+		if (this->end - this->p < (ptrdiff_t)sizeof(v))
+			this->corrupted();
+		memcpy(&v, this->p, sizeof(v));
+		this->p += sizeof(v);
+		return v;
+	}
+
+	std::string_view Reader::get_string() {
+		uint32_t size = this->get();
+		if ((size_t)(this->end - this->p) < size)
+			this->corrupted();
+		std::string_view ret(this->p, size);
+		this->p += size;
+		return ret;
+	}
+
+	const SymbolTable::Constant *Reader::get_constant() {
+		switch (this->get())
+		{
+			case 0:
+				return symbolTable.new_constant(strtold(std::string(this->get_string()).c_str(), nullptr));
+			case 1:
+			{
+				uintmax_t low = this->get();
+				return symbolTable.new_constant(low | (uintmax_t)this->get() << 32);
+			}
+			case 2:
+				return symbolTable.new_constant(std::string(this->get_string()));
+			default:
+				this->corrupted();
+		}
+	}
+
+	Atom Reader::atom() {
+		uint32_t i = this->get();
+		if (i >= this->atoms.size())
+			this->corrupted();
+		return this->atoms[i];
+	}
+
+	const Types::CType &Reader::type() {
+		uint32_t i = this->get();
+		if (!i || i >= this->types.size())
+			this->corrupted();
+		return *this->types[i];
+	}
+
+	Types::TypeId Reader::optional_type() {
+		uint32_t i = this->get();
+		if (i >= this->types.size())
+			this->corrupted();
+		return this->types[i];
+	}
+
+	void Reader::read_header() {
+		for (uint32_t n = this->get(); n; n--)
+			this->atoms.emplace_back(this->get_string());
+		for (uint32_t n = this->get(); n; n--)
+			this->types.push_back(this->read_type());
+	}
+
+	Types::TypeId Reader::read_type() {
+		Types::CType t;
+		uint32_t kind = this->get();
+		t.qualifier = static_cast<Types::CType::TypeQualifier>(this->get());
+		t.is_lvalue = this->get();
+		switch (kind)
+		{
+			case 0:
+			{
+				auto base = static_cast<Types::PlainType::BaseType>(this->get());
+				t.type = Types::PlainType{base, static_cast<bool>(this->get())};
+				break;
+			}
+			case 1:
+			{
+				auto type = static_cast<Types::TagName::Type>(this->get());
+				t.type = Types::TagName{type, this->atom()};
+				break;
+			}
+			case 2:
+				t.type = Types::Pointer{this->shared_type()};
+				break;
+			case 3:
+			{
+				Types::FunctionType function;
+				function.return_type = this->shared_type();
+				function.variadic = this->get();
+				for (uint32_t n = this->get(); n; n--)
+					function.parameters.push_back(this->type());
+				t.type = std::move(function);
+				break;
+			}
+			case 4:
+			{
+				Types::Array array;
+				array.value_type = this->shared_type();
+				bool has_size = this->get();
+				int size = this->get();
+				if (has_size)
+					array.size = size;
+				t.type = std::move(array);
+				break;
+			}
+			case 5:
+				t.type = Types::Typename{this->atom()};
+				break;
+			default:
+				this->corrupted();
+		}
+		return t;
+	}
+}
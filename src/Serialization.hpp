@@ -0,0 +1,66 @@
+#ifndef CC1_POC_SERIALIZATION_HPP
+#define CC1_POC_SERIALIZATION_HPP
+#include "SymbolTable.hpp"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Binary files written by the compiler (precompiled headers, tac files): a magic, then the identifiers and the types
+// they use, then a body of their own. Numbers are 32 bits, identifiers and types are written once and referred to
+// by their index in the file (index 0 is the empty atom and the absence of type), they are interned again when the
+// file is read.
+namespace Serialization {
+
+	class Writer {
+	private:
+		std::unordered_map<uint32_t, uint32_t>	atom_index; // by atom id
+		std::unordered_map<uint32_t, uint32_t>	type_index; // by type id
+		uint32_t								atom_count = 0;
+		uint32_t								type_count = 0;
+		std::string								atoms;
+		std::string								types;
+	public:
+		std::string	body;
+
+		static void	put(std::string &s, uint32_t v) { s.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+		static void	put_string(std::string &s, std::string_view v) { put(s, v.size()); s.append(v); }
+		static void	put_constant(std::string &s, const SymbolTable::Constant &c);
+
+		uint32_t	atom(Atom a);
+		uint32_t	type(const Types::CType &t);
+		uint32_t	type(Types::TypeId t) { return t ? this->type(*t) : 0; }
+		std::string	finish(std::string_view magic) const;
+	};
+
+	class Reader {
+	private:
+		const char				*p;
+		const char				*end;
+		std::string				path;
+		std::string				what; // kind of file, for the errors
+	public:
+		std::vector<Atom>			atoms{Atom()};
+		std::vector<Types::TypeId>	types{Types::TypeId()};
+
+		// data starts after the magic
+		Reader(const std::string &path, std::string_view data, const std::string &what) : p(data.data()), end(data.data() + data.size()), path(path), what(what) {}
+
+		[[noreturn]] void	corrupted() const {
+			throw std::runtime_error("error: " + this->path + ": corrupted " + this->what);
+		}
+
+		uint32_t						get();
+		std::string_view				get_string();
+		const SymbolTable::Constant		*get_constant(); // interned in the constant pool
+		Atom							atom();
+		const Types::CType				&type();
+		Types::TypeId					optional_type(); // 0 is no type
+		std::shared_ptr<Types::CType>	shared_type() { return std::make_shared<Types::CType>(this->type()); }
+		void							read_header(); // the identifiers and the types
+	private:
+		Types::TypeId					read_type();
+	};
+}
+
+#endif
@@ -0,0 +1,345 @@
+#include "Server.hpp"
+#include "CommandLine.hpp"
+#include "Preprocessor.hpp"
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <csignal>
+
+extern std::shared_ptr<CommandLine>	commandLine;
+
+// A request is the size of the payload (uint32_t) sent along with the client's stdout and stderr, then the payload:
+// the working directory, the variables of forwarded_variables and the arguments, each terminated by a '\0'. The answer is the wait status of the job
+// (int32_t). When a job is done, its process sends back to the server the working directory and the headers it
+// used, in the same format, so that the server reads them and the next jobs find them in the cache.
+namespace Server {
+
+	static const size_t cache_limit = 256 << 20; // bytes of headers kept between jobs
+
+	// the variables of the environment which change the headers found, the job takes those of the client: each one is
+	// sent as NAME=value, or as NAME alone when it is unset
+	static const char *const forwarded_variables[] = {"C_INCLUDE_PATH", "CC1_HOST_CC"};
+	static const size_t forwarded_count = sizeof(forwarded_variables) / sizeof(*forwarded_variables);
+
+	struct Job {
+		pid_t		pid;
+		int			client;
+		std::string	report;
+	};
+
+	static bool write_all(int fd, const char *data, size_t size) {
+		while (size)
+		{
+			ssize_t ret = write(fd, data, size);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				return false;
+			data += ret;
+			size -= ret;
+		}
+		return true;
+	}
+
+	static bool read_all(int fd, char *data, size_t size) {
+		while (size)
+		{
+			ssize_t ret = read(fd, data, size);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				return false;
+			data += ret;
+			size -= ret;
+		}
+		return true;
+	}
+
+	static std::vector<std::string> split(const std::string &payload) {
+		std::vector<std::string> ret;
+		for (size_t begin = 0, end; (end = payload.find('\0', begin)) != std::string::npos; begin = end + 1)
+			ret.emplace_back(payload, begin, end - begin);
+		return ret;
+	}
+
+	static bool get_address(const std::string &path, sockaddr_un &address) {
+		if (path.size() >= sizeof(address.sun_path))
+			return false;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+
+	// in the process of the job: receive the request, compile and report the headers used
+	static int run_job(int client, int report, Compiler compile) {
+		uint32_t size;
+		int fds[2];
+		char control[CMSG_SPACE(sizeof(fds))];
+		iovec iov = {&size, sizeof(size)};
+		msghdr message = {};
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		ssize_t ret;
+		while ((ret = recvmsg(client, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+			;
+		cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+		if (ret != sizeof(size) || !cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+			return 1;
+		memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+		std::string payload(size, '\0');
+		if (!read_all(client, payload.data(), size))
+			return 1;
+		close(client);
+		std::vector<std::string> args = split(payload);
+		if (args.size() < 2 + forwarded_count)
+			return 1;
+		if (dup2(fds[0], STDOUT_FILENO) < 0 || dup2(fds[1], STDERR_FILENO) < 0)
+			return 1;
+		close(fds[0]);
+		close(fds[1]);
+
+		const std::string &cwd = args.front();
+		if (chdir(cwd.c_str()) < 0)
+		{
+			std::cerr << "error: cant change directory: " << cwd << ": " << strerror(errno) << std::endl;
+			return 1;
+		}
+		Preprocessing::includeCache.set_directory(cwd);
+		for (size_t i = 0; i < forwarded_count; i++)
+		{
+			const std::string &variable = args[1 + i];
+			size_t length = strlen(forwarded_variables[i]);
+			if (variable.compare(0, length, forwarded_variables[i]) || (variable.size() > length && variable[length] != '='))
+				return 1;
+			if (variable.size() > length)
+				setenv(forwarded_variables[i], variable.c_str() + length + 1, 1);
+			else
+				unsetenv(forwarded_variables[i]);
+		}
+		std::vector<char *> argv;
+		for (auto it = args.begin() + 1 + forwarded_count; it != args.end(); it++)
+			argv.push_back(it->data());
+		argv.push_back(nullptr);
+		commandLine.reset(new CommandLine(argv.size() - 1, argv.data()));
+		int status = compile();
+
+		std::string used = cwd + '\0';
+		for (auto &path : Preprocessing::includeCache.get_used())
+			used += path + '\0';
+		write_all(report, used.data(), used.size());
+		return status;
+	}
+
+	// in the server, once a job is done: read the headers it used which are not cached yet
+	static void warm(const std::string &report) {
+		std::vector<std::string> paths = split(report);
+		if (paths.empty() || chdir(paths.front().c_str()) < 0)
+			return;
+		Preprocessing::includeCache.set_directory(paths.front());
+		for (auto it = paths.begin() + 1; it != paths.end(); it++)
+			Preprocessing::includeCache.load(*it);
+	}
+
+	static int listen_on(const std::string &path) {
+		sockaddr_un address;
+		if (!get_address(path, address))
+		{
+			std::cerr << "error: socket path too long: " << path << std::endl;
+			return -1;
+		}
+		int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0)
+		{
+			std::cerr << "error: socket: " << strerror(errno) << std::endl;
+			return -1;
+		}
+		int ret = bind(fd, (sockaddr *)&address, sizeof(address));
+		if (ret < 0 && errno == EADDRINUSE)
+		{
+			// a socket left by a server which is not running anymore is replaced
+			int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			bool alive = probe >= 0 && connect(probe, (sockaddr *)&address, sizeof(address)) == 0;
+			if (probe >= 0)
+				close(probe);
+			if (alive)
+			{
+				std::cerr << "error: a server is already listening on " << path << std::endl;
+				close(fd);
+				return -1;
+			}
+			unlink(path.c_str());
+			ret = bind(fd, (sockaddr *)&address, sizeof(address));
+		}
+		if (ret < 0 || listen(fd, SOMAXCONN) < 0)
+		{
+			std::cerr << "error: cant listen on " << path << ": " << strerror(errno) << std::endl;
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	int run(const std::string &socket_path, Compiler compile) {
+		std::string path = std::filesystem::absolute(socket_path).string(); // the server changes directory
+		int listener = listen_on(path);
+		if (listener < 0)
+			return 1;
+		signal(SIGPIPE, SIG_IGN); // a client may go away before its answer
+		std::map<int, Job> jobs; // by the read end of the pipe on which the job reports its headers
+
+		while (true)
+		{
+			std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+			for (auto &[fd, job] : jobs)
+				fds.push_back({fd, POLLIN, 0});
+			if (poll(fds.data(), fds.size(), -1) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				std::cerr << "error: poll: " << strerror(errno) << std::endl;
+				break;
+			}
+			for (auto it = fds.begin() + 1; it != fds.end(); it++)
+			{
+				if (!it->revents)
+					continue;
+				Job &job = jobs[it->fd];
+				char buf[4096];
+				ssize_t ret = read(it->fd, buf, sizeof(buf));
+				if (ret > 0 || (ret < 0 && errno == EINTR))
+				{
+					job.report.append(buf, std::max<ssize_t>(ret, 0));
+					continue;
+				}
+				int status = 1 << 8; // exit status 1 if it can't be waited
+				while (waitpid(job.pid, &status, 0) < 0 && errno == EINTR)
+					;
+				int32_t answer = status;
+				write_all(job.client, (const char *)&answer, sizeof(answer));
+				close(job.client);
+				close(it->fd);
+				warm(job.report);
+				jobs.erase(it->fd);
+				// bound the cache and give the freed memory back to the system, the server never compiles itself
+				Preprocessing::includeCache.trim(cache_limit);
+				malloc_trim(0);
+			}
+			if (!(fds[0].revents & POLLIN))
+				continue;
+			int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+			if (client < 0)
+				continue;
+			Preprocessing::includeCache.revalidate(); // headers modified since they were read
+			Preprocessing::includeCache.next_generation();
+			int report[2];
+			if (pipe2(report, O_CLOEXEC) < 0)
+			{
+				close(client);
+				continue;
+			}
+			std::cout.flush();
+			std::cerr.flush();
+			pid_t pid = fork();
+			if (pid == 0)
+			{
+				close(listener);
+				close(report[0]);
+				for (auto &[fd, job] : jobs)
+				{
+					close(fd);
+					close(job.client);
+				}
+				jobs.clear();
+				exit(run_job(client, report[1], compile));
+			}
+			close(report[1]);
+			if (pid < 0)
+			{
+				std::cerr << "error: cant fork: " << strerror(errno) << std::endl;
+				close(report[0]);
+				close(client);
+				continue;
+			}
+			jobs[report[0]] = {pid, client, {}};
+		}
+		close(listener);
+		unlink(path.c_str());
+		return 1;
+	}
+
+	int forward(const char *socket_path, int argc, char **argv) {
+		sockaddr_un address;
+		if (!get_address(socket_path, address))
+			return -1;
+		int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0)
+			return -1;
+		if (connect(fd, (sockaddr *)&address, sizeof(address)) < 0)
+		{
+			close(fd);
+			return -1;
+		}
+		std::error_code error;
+		std::string payload = std::filesystem::current_path(error).string() + '\0';
+		for (const char *name : forwarded_variables)
+			if (const char *value = getenv(name))
+				payload += std::string(name) + '=' + value + '\0';
+			else
+				payload += std::string(name) + '\0';
+		for (int i = 0; i < argc; i++)
+			payload += std::string(argv[i]) + '\0';
+		uint32_t size = payload.size();
+		int fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+		char control[CMSG_SPACE(sizeof(fds))] = {};
+		iovec iov = {&size, sizeof(size)};
+		msghdr message = {};
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+		ssize_t ret;
+		while ((ret = sendmsg(fd, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+			;
+		if (error || ret != sizeof(size))
+		{
+			close(fd);
+			return -1;
+		}
+		int32_t status;
+		if (!write_all(fd, payload.data(), payload.size()) || !read_all(fd, (char *)&status, sizeof(status)))
+		{
+			std::cerr << "error: the compile server closed the connection" << std::endl;
+			close(fd);
+			return 1;
+		}
+		close(fd);
+		if (WIFSIGNALED(status))
+		{
+			std::cerr << "error: compiler terminated by signal " << WTERMSIG(status) << std::endl;
+			return 1;
+		}
+		return WEXITSTATUS(status);
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef CC1_POC_SERVER_HPP
+#define CC1_POC_SERVER_HPP
+#include <string>
+
+// Compile server: `cc1 --server <socket>` stays resident and runs the compilations requested by clients, a client
+// being any cc1 started with CC1_SERVER=<socket> in its environment. The client sends its working directory, the
+// variables of its environment which locate the headers, its arguments and its standard output and error (the
+// descriptors themselves), then waits for the exit status.
+// Each job runs in a process forked from the server, so it starts from a clean compiler state but inherits the
+// headers already read and tokenized by the previous jobs (Preprocessing::includeCache).
+namespace Server {
+	typedef int	(*Compiler)(); // compile what commandLine describes, return the exit status
+
+	int		run(const std::string &socket_path, Compiler compile);
+	// send the command line to the server and return the exit status of the job, or -1 if the server can't be
+	// reached and the caller must compile by itself
+	int		forward(const char *socket_path, int argc, char **argv);
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include "SourceFile.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+SourceFile::SourceFile() : data(nullptr), size(0), mapped(false), line_starts{0}, token_begin(0), token_end(0) {}
+
+SourceFile::~SourceFile() {
+	if (this->mapped)
+		munmap(this->data, this->size);
+}
+
+bool SourceFile::open(const std::string &path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return false;
+	}
+	if (S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			this->data = static_cast<char *>(p);
+			this->size = st.st_size;
+			this->mapped = true;
+		}
+	}
+	if (!this->mapped) // not a regular file or mmap failed, read everything
+	{
+		char buf[1 << 16];
+		ssize_t ret;
+		while ((ret = read(fd, buf, sizeof(buf))) != 0)
+		{
+			if (ret < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				close(fd);
+				return false;
+			}
+			this->content.append(buf, ret);
+		}
+		this->data = this->content.data();
+		this->size = this->content.size();
+	}
+	close(fd);
+	this->setg(this->data, this->data, this->data + this->size);
+	return true;
+}
+
+void SourceFile::assign(std::string &&text) {
+	if (this->mapped)
+		munmap(this->data, this->size);
+	this->mapped = false;
+	this->content = std::move(text);
+	this->data = this->content.data();
+	this->size = this->content.size();
+	this->setg(this->data, this->data, this->data + this->size);
+	this->line_starts.assign(1, 0);
+	this->markers.clear();
+	this->token_begin = 0;
+	this->token_end = 0;
+}
+
+// tokens are contiguous in the file, so the text of each token starts where the previous one ended
+void SourceFile::consume(const char *text) {
+	size_t length = std::min(strlen(text), this->size - this->token_end);
+	this->token_begin = this->token_end;
+	this->token_end += length;
+	const char *p = this->data + this->token_begin;
+	const char *end = this->data + this->token_end;
+	while ((p = static_cast<const char *>(memchr(p, '\n', end - p))))
+	{
+		p++;
+		this->line_starts.push_back(p - this->data);
+	}
+
+	// line marker: # <line> "<file>"
+	while (*text == ' ' || *text == '\t')
+		text++;
+	if (*text++ != '#')
+		return;
+	char *number_end;
+	size_t line = strtoul(text, &number_end, 10);
+	if (number_end == text || *number_end != ' ')
+		return;
+	const char *file = strchr(number_end, '"');
+	const char *file_end = file ? strchr(file + 1, '"') : nullptr;
+	if (!file_end)
+		return;
+	this->markers.push_back({this->line_starts.size() + 1, line, std::string(file + 1, file_end)});
+}
+
+size_t SourceFile::get_physical_line(size_t offset) const {
+	return std::upper_bound(this->line_starts.begin(), this->line_starts.end(), offset) - this->line_starts.begin();
+}
+
+const SourceFile::LineMarker *SourceFile::get_marker(size_t offset) const {
+	size_t line = this->get_physical_line(offset);
+	auto it = std::upper_bound(this->markers.begin(), this->markers.end(), line, [](size_t l, const LineMarker &m) {
+		return l < m.physical_line;
+	});
+	return it == this->markers.begin() ? nullptr : &*std::prev(it);
+}
+
+size_t SourceFile::get_lineno(size_t offset) const {
+	const LineMarker *m = this->get_marker(offset);
+	size_t line = this->get_physical_line(offset);
+	return m ? m->line + line - m->physical_line : line;
+}
+
+std::string_view SourceFile::get_filename(size_t offset) const {
+	const LineMarker *m = this->get_marker(offset);
+	return m ? std::string_view(m->file) : std::string_view();
+}
+
+size_t SourceFile::get_column(size_t offset) const {
+	size_t column = 0;
+	for (size_t i = this->line_starts[this->get_physical_line(offset) - 1]; i < offset; i++)
+		if (this->data[i] == '\t')
+			column += 8 - (column % 8);
+		else
+			column++;
+	return column;
+}
+
+std::string_view SourceFile::get_line(size_t offset) const {
+	size_t begin = this->line_starts[this->get_physical_line(offset) - 1];
+	const char *end = static_cast<const char *>(memchr(this->data + offset, '\n', this->size - offset));
+	size_t length = end ? end + 1 - (this->data + begin) : this->size - begin;
+	return {this->data + begin, length};
+}
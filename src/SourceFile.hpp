@@ -0,0 +1,51 @@
+#ifndef CC1_POC_SOURCEFILE_HPP
+#define CC1_POC_SOURCEFILE_HPP
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Whole content of an input file, mapped in memory (or read at once when the file can't be mapped, e.g. a pipe).
+// As a streambuf its get area is the entire file, so an istream reading from it never refills a buffer.
+// The lexer reports the text of every token with consume(), which records where each line begins; line numbers,
+// columns and full lines for diagnostics are then computed from these offsets only when they are needed.
+// Line markers (# <line> "<file>") left by the preprocessor are recorded to report locations in the original files.
+class SourceFile : public std::streambuf {
+private:
+	char		*data;
+	size_t		size;
+	bool		mapped;
+	std::string	content; // used when the file isn't mapped
+
+	struct LineMarker {
+		size_t		physical_line; // first line which follows the marker
+		size_t		line;
+		std::string	file;
+	};
+	std::vector<size_t>		line_starts; // offset of the first character of each line scanned so far
+	std::vector<LineMarker>	markers;
+	size_t					token_begin; // offset of the last token consumed
+	size_t					token_end;
+
+	size_t				get_physical_line(size_t offset) const;
+	const LineMarker	*get_marker(size_t offset) const;
+public:
+	SourceFile();
+	SourceFile(const SourceFile &) = delete;
+	SourceFile &operator=(const SourceFile &) = delete;
+	~SourceFile() override;
+
+	bool				open(const std::string &path); // return false and set errno on failure
+	void				assign(std::string &&text); // replace the content, e.g. by its preprocessed version
+	std::string_view	view() const { return {this->data, this->size}; }
+
+	void				consume(const char *text);
+	size_t				get_token_offset() const { return this->token_begin; }
+	size_t				get_lineno(size_t offset) const; // 1 based, in the file named by the last line marker
+	std::string_view	get_filename(size_t offset) const; // empty if there is no line marker before offset
+	size_t				get_column(size_t offset) const; // 0 based, tabs are expanded to the next multiple of 8
+	std::string_view	get_line(size_t offset) const; // line containing offset, with its '\n' if it has one
+};
+
+
+#endif
@@ -0,0 +1,186 @@
+#include "Ssa.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace TAC {
+	SsaForm::SsaForm(const TacFunction &f) : cfg(f) {
+		const auto &instructions = f.get_instructions();
+		size_t temps = f.get_temps().size();
+
+		std::vector<bool> excluded(temps);
+		std::unordered_set<const SymbolTable::Ordinary *> address_taken;
+		for (auto &i : instructions)
+		{
+			if (i.op == DEREFERENCE)
+				excluded[get<int>(i.ret)] = true;
+			if (i.op == ADDRESS && holds_alternative<int>(i.oper1))
+				excluded[get<int>(i.oper1)] = true;
+			if (i.op == ADDRESS && holds_alternative<SymbolTable::Ordinary *>(i.oper1))
+				address_taken.insert(get<SymbolTable::Ordinary *>(i.oper1));
+		}
+		this->temp_variables.assign(temps, -1);
+		for (size_t t = 0; t < temps; t++)
+			if (!excluded[t])
+			{
+				this->temp_variables[t] = this->variables.size();
+				this->variables.emplace_back((int)t);
+			}
+		for (auto &i : instructions)
+			for (const Address *a : {&i.ret, &i.oper1, &i.oper2})
+			{
+				auto *o = get_if<SymbolTable::Ordinary *>(a);
+				if (!o || (*o)->storage != SymbolTable::Ordinary::AUTO || (*o)->type.qualifier & Types::CType::VOLATILE || address_taken.count(*o))
+					continue;
+				if (this->ordinary_variables.emplace(*o, this->variables.size()).second)
+					this->variables.emplace_back(*o);
+			}
+
+		for (size_t v = 0; v < this->variables.size(); v++)
+			this->values.push_back({(int)v, -1, -1});
+		this->uses.assign(instructions.size(), {-1, -1});
+		this->definitions.assign(instructions.size(), -1);
+		this->block_phis.resize(this->cfg.get_blocks().size());
+		if (instructions.empty())
+			return;
+		this->place_phis(instructions);
+		this->rename(instructions);
+	}
+
+	// a variable written in a block is merged at the blocks of its dominance frontier, which write it in turn
+	void SsaForm::place_phis(const std::vector<Instruction> &instructions) {
+		const auto &blocks = this->cfg.get_blocks();
+		std::vector<std::vector<int>> written(this->variables.size()); // blocks writing each variable
+		for (int b : this->cfg.get_reverse_postorder())
+			for (size_t i = blocks[b].begin; i < blocks[b].end; i++)
+				if (int v = this->get_variable(instructions[i].ret); v >= 0 && (written[v].empty() || written[v].back() != b))
+					written[v].push_back(b);
+
+		auto frontiers = this->cfg.get_dominance_frontiers();
+		std::vector<int> merged(blocks.size(), -1), queued(blocks.size(), -1); // last variable for which it was done
+		for (int v = 0; v < (int)this->variables.size(); v++)
+		{
+			std::vector<int> worklist = written[v];
+			for (int b : worklist)
+				queued[b] = v;
+			while (!worklist.empty())
+			{
+				int b = worklist.back();
+				worklist.pop_back();
+				for (int d : frontiers[b])
+				{
+					if (merged[d] == v)
+						continue;
+					merged[d] = v;
+					std::vector<int> operands(blocks[d].predecessors.size(), -1);
+					if (d == 0)
+						operands.push_back(v);
+					this->block_phis[d].push_back(this->phis.size());
+					this->phis.push_back({d, (int)this->values.size(), std::move(operands)});
+					this->values.push_back({v, -1, (int)this->phis.size() - 1});
+					if (queued[d] != v)
+					{
+						queued[d] = v;
+						worklist.push_back(d);
+					}
+				}
+			}
+		}
+	}
+
+	// the value of each variable reaching an instruction is the last one defined on the way down the dominator tree
+	void SsaForm::rename(const std::vector<Instruction> &instructions) {
+		const auto &blocks = this->cfg.get_blocks();
+		auto children = this->cfg.get_dominator_tree();
+		std::vector<std::vector<int>> current(this->variables.size());
+		for (size_t v = 0; v < this->variables.size(); v++)
+			current[v].push_back(v);
+		std::vector<int> defined; // variables of the values in current, to pop them when leaving the blocks
+		auto define = [&](int v, int value) {
+			current[v].push_back(value);
+			defined.push_back(v);
+		};
+
+		// without recursion, a block is left when its last child has been
+		std::vector<std::pair<int, size_t>> stack{{0, 0}};
+		std::vector<size_t> marks;
+		while (!stack.empty())
+		{
+			auto [b, next] = stack.back();
+			if (next == 0)
+			{
+				marks.push_back(defined.size());
+				for (int p : this->block_phis[b])
+					define(this->values[this->phis[p].value].variable, this->phis[p].value);
+				for (size_t i = blocks[b].begin; i < blocks[b].end; i++)
+				{
+					if (int v = this->get_variable(instructions[i].oper1); v >= 0)
+						this->uses[i][0] = current[v].back();
+					if (int v = this->get_variable(instructions[i].oper2); v >= 0)
+						this->uses[i][1] = current[v].back();
+					if (int v = this->get_variable(instructions[i].ret); v >= 0)
+					{
+						this->definitions[i] = this->values.size();
+						this->values.push_back({v, (int)i, -1});
+						define(v, this->definitions[i]);
+					}
+				}
+				for (int s : blocks[b].successors)
+				{
+					auto &predecessors = blocks[s].predecessors;
+					size_t edge = std::find(predecessors.begin(), predecessors.end(), b) - predecessors.begin();
+					for (int p : this->block_phis[s])
+						this->phis[p].operands[edge] = current[this->values[this->phis[p].value].variable].back();
+				}
+			}
+			if (next < children[b].size())
+			{
+				stack.back().second++;
+				stack.push_back({children[b][next], 0});
+				continue;
+			}
+			for (; defined.size() > marks.back(); defined.pop_back())
+				current[defined.back()].pop_back();
+			marks.pop_back();
+			stack.pop_back();
+		}
+	}
+
+	const ControlFlowGraph &SsaForm::get_cfg() const {
+		return this->cfg;
+	}
+
+	const std::vector<Address> &SsaForm::get_variables() const {
+		return this->variables;
+	}
+
+	int SsaForm::get_variable(const Address &a) const {
+		if (holds_alternative<int>(a))
+			return this->temp_variables[get<int>(a)];
+		if (holds_alternative<SymbolTable::Ordinary *>(a))
+		{
+			auto it = this->ordinary_variables.find(get<SymbolTable::Ordinary *>(a));
+			return it == this->ordinary_variables.end() ? -1 : it->second;
+		}
+		return -1;
+	}
+
+	const std::vector<SsaForm::Value> &SsaForm::get_values() const {
+		return this->values;
+	}
+
+	const std::vector<SsaForm::Phi> &SsaForm::get_phis() const {
+		return this->phis;
+	}
+
+	const std::vector<int> &SsaForm::get_block_phis(int block) const {
+		return this->block_phis[block];
+	}
+
+	int SsaForm::get_use(size_t instruction, int operand) const {
+		return this->uses[instruction][operand];
+	}
+
+	int SsaForm::get_definition(size_t instruction) const {
+		return this->definitions[instruction];
+	}
+}
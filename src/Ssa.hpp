@@ -0,0 +1,56 @@
+#ifndef CC1_POC_SSA_HPP
+#define CC1_POC_SSA_HPP
+#include "ControlFlow.hpp"
+#include <array>
+#include <unordered_map>
+
+namespace TAC {
+
+	// Static single assignment form of a function, kept beside its instructions which are not renamed: each write of a
+	// variable defines a value, each read uses the value reaching it, and where values of a variable coming from
+	// different paths join a phi defines a new one (on the iterated dominance frontiers of the writes, as by Cytron et
+	// al.). The variables are what only the instructions of the function can access: the temps, but those defined by a
+	// dereference or which had their address taken, and the locals and parameters which are neither volatile nor had
+	// their address taken.
+	class SsaForm {
+	public:
+		struct Value {
+			int		variable;
+			int		instruction; // writing it, -1 for a phi or the value on entry
+			int		phi; // defining it, -1 otherwise
+		};
+		struct Phi {
+			int					block;
+			int					value;
+			// the value coming from each predecessor of the block, -1 from an unreachable one, then for the first
+			// block the value on entry
+			std::vector<int>	operands;
+		};
+	private:
+		ControlFlowGraph						cfg;
+		std::vector<Address>					variables;
+		std::vector<int>						temp_variables; // variable of each temp, -1 if it isn't one
+		std::unordered_map<const SymbolTable::Ordinary *, int>	ordinary_variables;
+		std::vector<Value>						values; // the values on entry first, by variable
+		std::vector<Phi>						phis;
+		std::vector<std::vector<int>>			block_phis;
+		std::vector<std::array<int, 2>>			uses; // value read as oper1 and oper2 by each instruction, -1 if none
+		std::vector<int>						definitions; // value written by each instruction, -1 if none
+
+		void	place_phis(const std::vector<Instruction> &);
+		void	rename(const std::vector<Instruction> &);
+	public:
+		explicit SsaForm(const TacFunction &);
+
+		const ControlFlowGraph		&get_cfg() const;
+		const std::vector<Address>	&get_variables() const;
+		int							get_variable(const Address &) const; // -1 if it isn't one
+		const std::vector<Value>	&get_values() const;
+		const std::vector<Phi>		&get_phis() const;
+		const std::vector<int>		&get_block_phis(int block) const;
+		int							get_use(size_t instruction, int operand) const; // operand 0 is oper1, 1 oper2
+		int							get_definition(size_t instruction) const;
+	};
+}
+
+#endif
@@ -1,13 +1,16 @@
 #include "SymbolTable.hpp"
+#include "TimeReport.hpp"
+#include "MemoryReport.hpp"
 #include <iostream>
 
-SymbolTable::Constant::Constant(const std::string &val) : type(CTYPE_CHAR_PTR), value(val) {this->set_id();}
+SymbolTable::Constant::Constant(const std::string &val) : type(CTYPE_CHAR_PTR), value(val), id(-1) {}
 
-SymbolTable::SymbolTable() {
-	this->block_stack.push(&this->global);
-	block_pos_stack.push(0);
+size_t SymbolTable::ConstantHash::operator()(const Constant *c) const {
+	return std::visit([](const auto &v) { return std::hash<std::decay_t<decltype(v)>>{}(v); }, c->value) ^ c->value.index();
 }
 
+SymbolTable::SymbolTable() : current_function(nullptr), prototype(false) {}
+
 void SymbolTable::enter_prototype() {
 	this->prototype = true;
 }
@@ -17,8 +20,10 @@ void SymbolTable::exit_prototype() {
 }
 
 void SymbolTable::enter_function(const Function &f) {
+	MemoryReport::Scope memory(MemoryReport::SYMBOLS);
 	assert(!current_function);
 	current_function = &this->functions.emplace_back(f);
+	TimeReport::begin_function();
 	this->symbols.push_back({
 		.name = current_function->name,
 		.visibility = Symbol::GLOBAL, // todo
@@ -28,29 +33,37 @@ void SymbolTable::enter_function(const Function &f) {
 
 void SymbolTable::exit_function() {
 	assert(current_function);
+	TimeReport::end_function(current_function->name);
 	current_function = nullptr;
 }
 
 int SymbolTable::enter_block() {
 //	std::cout << "[enter block]";
-	if (block_stack.top()->blocks.size() >= this->block_pos_stack.top())
-		block_stack.top()->blocks.emplace_back();
-	this->block_stack.push(&this->block_stack.top()->blocks[this->block_pos_stack.top()]);
-	this->block_pos_stack.top()++;
-	this->block_pos_stack.push(0);
-	return this->block_pos_stack.top() - 1;
+	MemoryReport::Scope memory(MemoryReport::SYMBOLS);
+	this->scope_marks.push_back(this->undo_log.size());
+	return this->scope_marks.size();
 }
 
 void SymbolTable::exit_block() {
 //	std::cout << "[exit block]";
-	this->block_stack.pop();
-	this->block_pos_stack.pop();
+	size_t mark = this->scope_marks.back();
+	this->scope_marks.pop_back();
+	while (this->undo_log.size() > mark)
+	{
+		auto [name, tag] = this->undo_log.back();
+		if (tag)
+			this->names[name.get_id()].tags.pop_back();
+		else
+			this->names[name.get_id()].ordinaries.pop_back();
+		this->undo_log.pop_back();
+	}
 }
 
-bool SymbolTable::insert_ordinary(const std::string &name, Ordinary o) {
+bool SymbolTable::insert_ordinary(Atom name, Ordinary o) {
 //	std::cout << "[insert " << name << ", type: ";
 //	this->print_type(o.type);
 //	std::cout << "]";
+	MemoryReport::Scope memory(MemoryReport::SYMBOLS);
 
 	if (o.storage == Ordinary::Storage::UNDEFINED)
 	{
@@ -64,17 +77,17 @@ bool SymbolTable::insert_ordinary(const std::string &name, Ordinary o) {
 			o.storage = Ordinary::Storage::GLOBAL;
 	}
 	if (o.storage == Ordinary::STATIC)
-		o.name = name + "." + std::to_string(this->functions.size());
+		o.name = name.str() + "." + std::to_string(this->functions.size());
 //todo check storage
 
-	Scope *scope;
-	if (this->block_stack.empty())
-		scope = &this->global.scope;
-	else
-		scope = &this->block_stack.top()->scope;
-	auto [it, ret] = scope->objects.insert(std::make_pair(name, o));
-	if (!ret)
+	Name &n = this->get_name(name);
+	size_t depth = this->scope_marks.size();
+	if (!n.ordinaries.empty() && n.ordinaries.back().depth == depth)
 		return false;
+	Ordinary &ordinary = this->ordinaries.emplace_back(std::move(o));
+	n.ordinaries.push_back({depth, &ordinary});
+	if (depth)
+		this->undo_log.emplace_back(name, false);
 
 	if (current_function)
 	{
@@ -83,83 +96,90 @@ bool SymbolTable::insert_ordinary(const std::string &name, Ordinary o) {
 //			assert(it->second.storage == Ordinary::UNDEFINED); // todo
 //			it->second.storage = SymbolTable::Ordinary::PARAM;
 //		} else
-		if (it->second.storage == Ordinary::Storage::AUTO)
+		if (ordinary.storage == Ordinary::Storage::AUTO)
 		{
-			current_function->frame_size += size_of(it->second.type);
-			it->second.offset = current_function->frame_size;
+			current_function->frame_size += size_of(ordinary.type);
+			ordinary.offset = current_function->frame_size;
 		}
 		else
-			this->add_symbol(o.name, it->second);
+			this->add_symbol(ordinary.name, ordinary);
 	}
 	else if (!prototype)
 	{
-		this->add_symbol(o.name, it->second);
+		this->add_symbol(ordinary.name, ordinary);
 	}
 
 	return true;
 }
 
-bool	SymbolTable::insert_function(const std::string &name, Ordinary o)
+// functions are always declared at file scope, below the bindings of the open scopes which may shadow them
+bool	SymbolTable::insert_function(Atom name, Ordinary o)
 {
+	MemoryReport::Scope memory(MemoryReport::SYMBOLS);
 	if (o.storage == Ordinary::Storage::UNDEFINED)
 		o.storage = Ordinary::EXTERN;
 
-	auto [it, ret] = this->global.scope.objects.insert(std::make_pair(name, o));
-	if (!ret)
+	Name &n = this->get_name(name);
+	if (!n.ordinaries.empty() && n.ordinaries.front().depth == 0)
 		return false;
-	this->add_symbol(name, it->second);
+	Ordinary &ordinary = this->ordinaries.emplace_back(std::move(o));
+	n.ordinaries.insert(n.ordinaries.begin(), {0, &ordinary});
+	this->add_symbol(name, ordinary);
 	return true;
 }
 
-bool SymbolTable::is_typename(const std::string &name) {
+bool SymbolTable::is_typename(Atom name) {
 	if (auto *o = this->retrieve_ordinary(name); o)
 		return o->storage == Ordinary::TYPEDEF;
 	return false;
 }
 
-SymbolTable::Ordinary	*SymbolTable::retrieve_ordinary(const std::string &name) {
-	std::map<std::string, Ordinary>::iterator it;
-	auto s = this->block_stack;
-	while(!s.empty() && (it = s.top()->scope.objects.find(name)) == s.top()->scope.objects.end())
-		s.pop();
-	if (!s.empty())
-		return &(it->second);
-	return nullptr;
+SymbolTable::Ordinary	*SymbolTable::retrieve_ordinary(Atom name) {
+	if (name.get_id() >= this->names.size() || this->names[name.get_id()].ordinaries.empty())
+		return nullptr;
+	return this->names[name.get_id()].ordinaries.back().value;
 }
 
-bool	SymbolTable::declare_tag(const std::string &name, Types::Tag::Type type) {
-	return this->block_stack.top()->scope.tags.insert({name, Types::Tag{type}}).second;
+bool	SymbolTable::declare_tag(Atom name, Types::Tag::Type type) {
+	MemoryReport::Scope memory(MemoryReport::SYMBOLS);
+	Name &n = this->get_name(name);
+	size_t depth = this->scope_marks.size();
+	if (!n.tags.empty() && n.tags.back().depth == depth)
+		return false;
+	n.tags.push_back({depth, &this->tags.emplace_back(Types::Tag{type})});
+	if (depth)
+		this->undo_log.emplace_back(name, true);
+	return true;
 }
 
-bool	SymbolTable::assign_tag(const std::string &name, Types::StructOrUnion sou)
+bool	SymbolTable::assign_tag(Atom name, Types::StructOrUnion sou)
 {
-	auto it = this->block_stack.top()->scope.tags.find(name);
-	assert (it != this->block_stack.top()->scope.tags.end());
-	if (it->second.type == Types::Tag::UNION ^ sou.is_union)
+	MemoryReport::Scope memory(MemoryReport::SYMBOLS);
+	Name &n = this->get_name(name);
+	assert(!n.tags.empty() && n.tags.back().depth == this->scope_marks.size());
+	Types::Tag *tag = n.tags.back().value;
+	if (tag->type == Types::Tag::UNION ^ sou.is_union)
 		return false; //operation is different
-	it->second.declaration = sou;
+	tag->declaration = sou;
 	return true;
 }
 
-bool	SymbolTable::assign_tag(const std::string &name, Types::Enum e)
+bool	SymbolTable::assign_tag(Atom name, Types::Enum e)
 {
-	auto it = this->block_stack.top()->scope.tags.find(name);
-	assert (it != this->block_stack.top()->scope.tags.end());
-	it->second.declaration = e;
+	MemoryReport::Scope memory(MemoryReport::SYMBOLS);
+	Name &n = this->get_name(name);
+	assert(!n.tags.empty() && n.tags.back().depth == this->scope_marks.size());
+	n.tags.back().value->declaration = e;
 	return true;
 }
 
-Types::Tag	*SymbolTable::retrieve_tag(const std::string &name) {
-	std::map<std::string, Types::Tag>::iterator it;
-	auto s = this->block_stack;
-	while(!s.empty() && (it = s.top()->scope.tags.find(name)) == s.top()->scope.tags.end())
-		s.pop();
-	if (it != block_stack.top()->scope.tags.end())
-		return &(it->second);
-	return nullptr;
+Types::Tag	*SymbolTable::retrieve_tag(Atom name) {
+	if (name.get_id() >= this->names.size() || this->names[name.get_id()].tags.empty())
+		return nullptr;
+	return this->names[name.get_id()].tags.back().value;
 }
 
-bool SymbolTable::contain_tag(const std::string &name) {
+bool SymbolTable::contain_tag(Atom name) {
 	return this->retrieve_tag(name);
 }
 
@@ -205,7 +225,7 @@ size_t SymbolTable::size_of(const Types::CType &t) {
 		{
 			auto *type = this->retrieve_ordinary(get<5>(t.type).name);
 			if (!type)
-				throw std::runtime_error("type " + get<5>(t.type).name + " does not exist"); //todo: better
+				throw std::runtime_error("type " + get<5>(t.type).name.str() + " does not exist"); //todo: better
 			throw std::runtime_error("not implemented yet " + std::string(__FILE__ +  __LINE__));
 		}
 		default:
@@ -217,6 +237,12 @@ SymbolTable::Function &SymbolTable::get_current_function() {
 	return *this->current_function;
 }
 
+SymbolTable::Name &SymbolTable::get_name(Atom name) {
+	if (name.get_id() >= this->names.size())
+		this->names.resize(atomTable.size());
+	return this->names[name.get_id()];
+}
+
 void SymbolTable::print_type(const Types::CType &t) {
 	const Types::CType *p = &t;
 	while (p) {
@@ -256,7 +282,7 @@ void SymbolTable::print_type(const Types::CType &t) {
 	std::cout << std::endl;
 }
 
-void SymbolTable::add_symbol(const std::string &name, SymbolTable::Ordinary &ordinary) {
+void SymbolTable::add_symbol(Atom name, SymbolTable::Ordinary &ordinary) {
 
 		Symbol sym { name };
 
@@ -8,8 +8,10 @@
 #include <vector>
 #include <memory>
 #include <list>
-#include <stack>
+#include <deque>
+#include <unordered_set>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <variant>
 #include <assert.h>
@@ -46,6 +48,7 @@
 #define NULL_CONSTANT CONST(0)
 
 #include "Types.hpp"
+#include "MemoryReport.hpp"
 
 namespace TAC {
 	class TacFunction;
@@ -54,39 +57,36 @@ namespace TAC {
 class SymbolTable {
 public:
 
+	// the type of a constant follows from the alternative of its value, so two constants are the same if their values
+	// are equal
 	struct Constant
 	{
-		Constant() {this->set_id();};
+		Constant() : id(-1) {};
 		template <typename T,std::enable_if_t<std::is_integral<T>::value, bool> = true>
-		Constant(T val) : type(CTYPE_LONG_INT) {
+		Constant(T val) : type(CTYPE_LONG_INT), id(-1) {
 			value.emplace<uintmax_t>(val);
-			this->set_id();
 		}
 
 		template <typename T,std::enable_if_t<std::is_floating_point<T>::value, bool> = true>
-		Constant(T val) : type(CTYPE_DOUBLE) {
+		Constant(T val) : type(CTYPE_DOUBLE), id(-1) {
 			value.emplace<long double>(val);
-			this->set_id();
 		}
 		Constant(const std::string &);
 
-		friend bool operator<(const Constant &l, const Constant &r)
-		{
-			return l.value < r.value;
-		}
-		void set_id()
-		{
-			static int current = 0;
-			this->id = current++;
-		}
-
 		Types::CType	type;
 		std::variant<
 				long double,
 				uintmax_t,
 				std::string
 		>				value;
-		int				id;
+		int				id; // index in the constant pool, also the number of its .LC label
+	};
+
+	struct ConstantHash {
+		size_t operator()(const Constant *c) const;
+	};
+	struct ConstantEqual {
+		bool operator()(const Constant *l, const Constant *r) const { return l->value == r->value; }
 	};
 
 	struct Ordinary {
@@ -102,7 +102,7 @@ public:
 		};
 		Storage					storage;
 		Types::CType			type;
-		std::string				name;
+		Atom					name;
 		int						offset;
 		std::optional<const Constant*>	init;
 		// location;
@@ -111,21 +111,22 @@ public:
 	struct Label {
 	};
 
-	struct Scope {
-		std::map<std::string, Types::Tag> tags;
-		std::map<std::string, Ordinary> objects;
+	// declarations of a name visible from the current scope, the innermost one last
+	template <typename T>
+	struct Binding {
+		size_t	depth; // of the scope containing the declaration, 0 is the file scope
+		T		*value;
 	};
 
-	struct Block {
-		Scope scope;
-		std::vector<Block> blocks;
+	struct Name {
+		std::vector<Binding<Ordinary>>		ordinaries;
+		std::vector<Binding<Types::Tag>>	tags;
 	};
 
 	struct Function {
 		Types::CType						type;
-		std::string							name;
-		std::map<std::string, Label>		labels;
-		Block								block;
+		Atom								name;
+		std::map<Atom, Label>				labels;
 		int									frame_size;
 		TAC::TacFunction					*tac;
 		std::list<Ordinary*>				params;
@@ -137,7 +138,7 @@ public:
 			GLOBAL,
 			LOCAL,
 		};
-		std::string	name;
+		Atom		name;
 		bool		read_only;
 		Visibility	visibility;
 		std::variant<
@@ -148,15 +149,20 @@ public:
 	};
 
 
-	Block global;
 //	std::map<std::string, Function> functions;
 	std::deque<Function> functions;
 
 	Function												*current_function;
 	bool													prototype;
-	std::stack<Block*>										block_stack; // represent the hierarchy of block
-	std::stack<int>											block_pos_stack; // represent the next sub-block inside each block of the current tree
-	std::set<Constant>										constants;
+	// all the scopes share one table indexed by atom, a binding is added to the name when it is declared and removed
+	// when its scope is exited, so a lookup doesn't depend on the nesting depth
+	std::vector<Name>										names;
+	std::deque<Ordinary>									ordinaries; // every object ever declared, pointers stay valid
+	std::deque<Types::Tag>									tags;
+	std::vector<std::pair<Atom, bool>>						undo_log; // bindings of the open scopes, true for a tag
+	std::vector<size_t>										scope_marks; // size of the undo log when each scope was entered
+	std::deque<Constant>									constants; // constant pool, by id
+	std::unordered_set<const Constant*, ConstantHash, ConstantEqual>	constant_index;
 
 	std::vector<Symbol>										symbols;
 public:
@@ -174,29 +180,38 @@ public:
 
 //	void insert_label();
 //	void insert_tag();
-	bool								insert_ordinary(const std::string &name, Ordinary);
-	bool								insert_function(const std::string &name, Ordinary);
-	Ordinary*							retrieve_ordinary(const std::string &name);
+	bool								insert_ordinary(Atom name, Ordinary);
+	bool								insert_function(Atom name, Ordinary);
+	Ordinary*							retrieve_ordinary(Atom name);
 
-	bool								is_typename(const std::string &name);
+	bool								is_typename(Atom name);
 
-	bool								declare_tag(const std::string &name, Types::Tag::Type);
-	bool								assign_tag(const std::string &name, Types::StructOrUnion);
-	bool								assign_tag(const std::string &name, Types::Enum);
-	Types::Tag*								retrieve_tag(const std::string &name);
-	bool								contain_tag(const std::string &name);
+	bool								declare_tag(Atom name, Types::Tag::Type);
+	bool								assign_tag(Atom name, Types::StructOrUnion);
+	bool								assign_tag(Atom name, Types::Enum);
+	Types::Tag*								retrieve_tag(Atom name);
+	bool								contain_tag(Atom name);
 
 	size_t									size_of(const Types::CType &);
+	size_t									size_of(Types::TypeId t) { return this->size_of(*t); }
 	template <typename ...Args>
 	const Constant *new_constant(Args &&... args)
 	{
-		return &*(this->constants.emplace(args...).first);
+		MemoryReport::Scope memory(MemoryReport::CONSTANTS);
+		Constant c(std::forward<Args>(args)...);
+		if (auto it = this->constant_index.find(&c); it != this->constant_index.end())
+			return *it;
+		c.id = this->constants.size();
+		const Constant *ret = &this->constants.emplace_back(std::move(c));
+		this->constant_index.insert(ret);
+		return ret;
 	}
 	Function							&get_current_function();
+	Name								&get_name(Atom name);
 
 	void 								print_type(const Types::CType &);
 
-	void add_symbol(const std::string &name, Ordinary &ordinary);
+	void add_symbol(Atom name, Ordinary &ordinary);
 };
 
 extern SymbolTable symbolTable;
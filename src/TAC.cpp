@@ -1,5 +1,8 @@
 #include "TAC.hpp"
+#include "MemoryReport.hpp"
 #include <iostream>
+#include <cstdio>
+#include <algorithm>
 
 namespace TAC
 {
@@ -8,17 +11,19 @@ namespace TAC
 
 	TacFunction::TacFunction(SymbolTable::Function &s) {s.tac = this;}
 
-	int TacFunction::new_temp(const Types::CType &type) {
+	int TacFunction::new_temp(Types::TypeId type) {
+		MemoryReport::Scope memory(MemoryReport::TAC);
 		temps.emplace_back(type);
 		last_usage.emplace_back();
 		return temps.size() - 1;
 	}
 
-	void TacFunction::set_temp_type(int id, const Types::CType &type) {
+	void TacFunction::set_temp_type(int id, Types::TypeId type) {
 		this->temps[id] = type;
 	}
 
 	void TacFunction::add_instruction(const TAC::Instruction &i) {
+		MemoryReport::Scope memory(MemoryReport::TAC);
 		if (holds_alternative<int>(i.ret))
 			this->last_usage[get<int>(i.ret)] = this->instructions.size();
 		if (holds_alternative<int>(i.oper1))
@@ -28,6 +33,140 @@ namespace TAC
 		this->instructions.emplace_back(i);
 	}
 
+	void TacFunction::set_instruction(size_t index, const TAC::Instruction &i) {
+		for (auto *a : {&i.ret, &i.oper1, &i.oper2})
+			if (holds_alternative<int>(*a))
+				this->last_usage[get<int>(*a)] = std::max(this->last_usage[get<int>(*a)], (int)index);
+		this->instructions[index] = i;
+	}
+
+	void TacFunction::erase_instructions(const std::vector<bool> &erased) {
+		std::vector<int> position(this->instructions.size() + 1); // new position of each instruction, and of the end
+		size_t kept = 0;
+		for (size_t i = 0; i < this->instructions.size(); i++)
+		{
+			position[i] = kept;
+			if (!erased[i])
+				this->instructions[kept++] = this->instructions[i];
+		}
+		position.back() = kept;
+		this->instructions.resize(kept);
+		for (int &l : this->labels)
+			if (l >= 0)
+				l = position[l];
+		std::fill(this->last_usage.begin(), this->last_usage.end(), 0);
+		for (size_t i = 0; i < this->instructions.size(); i++)
+			for (auto *a : {&this->instructions[i].ret, &this->instructions[i].oper1, &this->instructions[i].oper2})
+				if (holds_alternative<int>(*a))
+					this->last_usage[get<int>(*a)] = i;
+	}
+
+	// by structure, the ids of the types depend on the order in which the whole file interned them
+	static void hash_type(Hash &h, const Types::CType &t) {
+		h.put(t.type.index()).put(t.qualifier).put(t.is_lvalue);
+		switch (t.type.index())
+		{
+			case 0:
+				h.put(get<Types::PlainType>(t.type).base).put(get<Types::PlainType>(t.type).is_signed);
+				break;
+			case 1:
+				h.put(get<Types::TagName>(t.type).type).put(get<Types::TagName>(t.type).name.str());
+				break;
+			case 2:
+				hash_type(h, *get<Types::Pointer>(t.type).pointed_type);
+				break;
+			case 3:
+			{
+				auto &function = get<Types::FunctionType>(t.type);
+				hash_type(h, *function.return_type);
+				h.put(function.variadic).put(function.parameters.size());
+				for (auto &p : function.parameters)
+					hash_type(h, p);
+				break;
+			}
+			case 4:
+				hash_type(h, *get<Types::Array>(t.type).value_type);
+				h.put(get<Types::Array>(t.type).size.has_value()).put(get<Types::Array>(t.type).size.value_or(0));
+				break;
+			case 5:
+				h.put(get<Types::Typename>(t.type).name.str());
+				break;
+		}
+	}
+
+	static void hash_ordinary(Hash &h, const SymbolTable::Ordinary *o) {
+		h.put(o->name.str()).put(o->storage).put(o->offset);
+		hash_type(h, o->type);
+	}
+
+	static void hash_address(Hash &h, const Address &a) {
+		h.put(a.index());
+		switch (a.index())
+		{
+			case 1:
+				h.put(get<int>(a));
+				break;
+			case 2:
+				hash_ordinary(h, get<SymbolTable::Ordinary *>(a));
+				break;
+			case 3:
+			{
+				auto *c = get<const SymbolTable::Constant *>(a);
+				h.put(c->value.index());
+				if (c->value.index() != 1) // only floats and strings are referred to by their number in the pool
+					h.put(c->id);
+				hash_type(h, c->type);
+				if (c->value.index() == 0) // without the padding bytes of a long double
+				{
+					char buf[64];
+					snprintf(buf, sizeof(buf), "%La", get<long double>(c->value));
+					h.put(buf);
+				}
+				else if (c->value.index() == 1)
+					h.put(get<uintmax_t>(c->value));
+				else
+					h.put(get<std::string>(c->value));
+				break;
+			}
+			case 4:
+				h.put(int(get<Label>(a)));
+				break;
+			case 5: // a global referred to by its name
+			{
+				h.put(get<Atom>(a).str());
+				auto *o = symbolTable.retrieve_ordinary(get<Atom>(a));
+				h.put(o != nullptr);
+				if (o)
+					hash_ordinary(h, o);
+				break;
+			}
+		}
+	}
+
+	void TacFunction::hash(Hash &h) const {
+		h.put(this->temps.size());
+		for (auto t : this->temps)
+		{
+			h.put(t.has_value());
+			if (t)
+				hash_type(h, *t);
+		}
+		h.put(this->labels.size());
+		for (int l : this->labels)
+			h.put(l);
+		h.put(this->last_usage.size());
+		for (int u : this->last_usage)
+			h.put(u);
+		h.put(this->instructions.size());
+		for (auto &i : this->instructions)
+		{
+			h.put(i.op).put(i.operation_size).put(i.operation_sign);
+			hash_address(h, i.ret);
+			hash_address(h, i.oper1);
+			hash_address(h, i.oper2);
+		}
+	}
+
 	std::ostream &operator<<(std::ostream &ostream, const Address &addr)
 	{
 		switch (addr.index())
@@ -64,10 +203,22 @@ namespace TAC
 		return this->instructions;
 	}
 
+	const std::vector<Types::TypeId> &TacFunction::get_temps() const {
+		return this->temps;
+	}
+
+	const std::vector<int> &TacFunction::get_labels() const {
+		return this->labels;
+	}
+
 	const std::vector<int> &TacFunction::get_last_usages() const {
 		return this->last_usage;
 	}
 
+	size_t TacFunction::get_label_count() const {
+		return this->labels.size();
+	}
+
 	bool Instruction::is_bop() const {
 		return this->op >= ADD && this->op < ASSIGN;
 	}
@@ -151,6 +302,7 @@ namespace TAC
 	}
 
 	Label TacFunction::new_label(bool here) {
+		MemoryReport::Scope memory(MemoryReport::TAC);
 		this->labels.emplace_back(-1);
 		if (here)
 			this->set_label(this->labels.size() - 1);
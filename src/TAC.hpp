@@ -3,6 +3,7 @@
 #include <iostream>
 #include <vector>
 #include "SymbolTable.hpp"
+#include "Hash.hpp"
 
 namespace CodeGeneration {
 	class FunctionGenerator;
@@ -72,7 +73,7 @@ namespace TAC {
 		SymbolTable::Ordinary*,
 		const SymbolTable::Constant*,
 		Label,
-		std::string
+		Atom
 	> Address;
 	struct Instruction {
 		Address					ret;
@@ -92,19 +93,25 @@ namespace TAC {
 	class TacFunction {
 	private:
 		std::vector<Instruction>		instructions;
-		std::vector<Types::CType>		temps;
+		std::vector<Types::TypeId>		temps;
 		std::vector<int>				last_usage;
 		std::vector<int>				labels;
 	public:
 		TacFunction(SymbolTable::Function &);
-		int					new_temp(const Types::CType &type);
-		void				set_temp_type(int id, const Types::CType &type);
+		int					new_temp(Types::TypeId type);
+		void				set_temp_type(int id, Types::TypeId type);
 		Label				new_label(bool here = false);
 		void				set_label(const Label &); // set the label position at the current position in the program
 		void				add_instruction(const Instruction &i);
+		void				set_instruction(size_t index, const Instruction &i);
+		void				erase_instructions(const std::vector<bool> &erased); // the labels move to the next instruction kept
 
 		const std::vector<Instruction>	&get_instructions() const;
+		const std::vector<Types::TypeId>	&get_temps() const;
+		const std::vector<int>			&get_labels() const; // position of each label, -1 if it is not set
 		const std::vector<int>			&get_last_usages() const;
+		size_t							get_label_count() const;
+		void							hash(Hash &) const; // everything the translation depends on, ids of atoms and types excluded
 
 		void	print_address(const Address&);
 		void	print() const;
@@ -0,0 +1,307 @@
+#include "TacFile.hpp"
+#include "TAC.hpp"
+#include "SourceFile.hpp"
+#include "Serialization.hpp"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+// Layout: magic, the identifiers and the types, then the body: the constants and the objects referred to (an object
+// refers to the constant which initializes it, index 0 is none), the names bound at file scope (typedef names are
+// needed for the sizes of the types), the symbols of the file scope, and the functions.
+// A function is its name, type, frame size and parameters, the types of its temps, the positions of its labels and
+// its instructions. An address is its kind (the alternative of TAC::Address) followed by its value: a temp, the
+// index of an object or of a constant, a label or an identifier. The last usages of the temps are not written, they
+// are computed again as the instructions are added.
+namespace TacFile {
+	using Serialization::Writer;
+	using Serialization::Reader;
+
+	static const char magic[8] = {'c', 'c', '1', 't', 'a', 'c', '0', '1'};
+
+	class Tables {
+	private:
+		std::unordered_map<const SymbolTable::Ordinary *, uint32_t>	ordinary_index;
+		std::unordered_map<const SymbolTable::Constant *, uint32_t>	constant_index;
+	public:
+		std::vector<const SymbolTable::Ordinary *>	ordinaries;
+		std::vector<const SymbolTable::Constant *>	constants;
+
+		uint32_t	ordinary(const SymbolTable::Ordinary *o) {
+			auto [it, inserted] = this->ordinary_index.emplace(o, this->ordinaries.size());
+			if (inserted)
+				this->ordinaries.push_back(o);
+			return it->second;
+		}
+
+		uint32_t	constant(const SymbolTable::Constant *c) {
+			auto [it, inserted] = this->constant_index.emplace(c, this->constants.size() + 1);
+			if (inserted)
+				this->constants.push_back(c);
+			return it->second;
+		}
+	};
+
+	static void put_address(std::string &s, Writer &w, Tables &tables, const TAC::Address &a) {
+		Writer::put(s, a.index());
+		switch (a.index())
+		{
+			case 1:
+				Writer::put(s, get<int>(a));
+				break;
+			case 2:
+				Writer::put(s, tables.ordinary(get<SymbolTable::Ordinary *>(a)));
+				break;
+			case 3:
+				Writer::put(s, tables.constant(get<const SymbolTable::Constant *>(a)));
+				break;
+			case 4:
+				Writer::put(s, int(get<TAC::Label>(a)));
+				break;
+			case 5:
+				Writer::put(s, w.atom(get<Atom>(a)));
+				break;
+		}
+	}
+
+	void save(const std::string &path) {
+		Writer w;
+		Tables tables;
+
+		// written in the reverse order of their dependencies: the functions refer to the objects, which refer to the
+		// constants
+		std::string functions;
+		uint32_t count = 0;
+		for (auto &f : symbolTable.functions)
+		{
+			if (!f.tac)
+				continue;
+			count++;
+			Writer::put(functions, w.atom(f.name));
+			Writer::put(functions, w.type(f.type));
+			Writer::put(functions, f.frame_size);
+			Writer::put(functions, f.params.size());
+			for (auto *p : f.params)
+				Writer::put(functions, tables.ordinary(p));
+			Writer::put(functions, f.tac->get_temps().size());
+			for (auto t : f.tac->get_temps())
+				Writer::put(functions, w.type(t));
+			Writer::put(functions, f.tac->get_labels().size());
+			for (int l : f.tac->get_labels())
+				Writer::put(functions, l);
+			Writer::put(functions, f.tac->get_instructions().size());
+			for (auto &i : f.tac->get_instructions())
+			{
+				Writer::put(functions, i.op);
+				Writer::put(functions, i.operation_size);
+				Writer::put(functions, i.operation_sign);
+				put_address(functions, w, tables, i.ret);
+				put_address(functions, w, tables, i.oper1);
+				put_address(functions, w, tables, i.oper2);
+			}
+		}
+
+		// the scopes are all exited, only the file scope is left
+		std::string bindings;
+		uint32_t bound = 0;
+		for (uint32_t id = 0; id < symbolTable.names.size(); id++)
+		{
+			auto &name = symbolTable.names[id];
+			if (name.ordinaries.empty() || name.ordinaries.front().depth)
+				continue;
+			bound++;
+			Writer::put(bindings, w.atom(Atom(atomTable.get_name(id))));
+			Writer::put(bindings, tables.ordinary(name.ordinaries.front().value));
+		}
+
+		// the symbols of the functions are added again with them
+		std::string symbols;
+		Writer::put(symbols, std::count_if(symbolTable.symbols.begin(), symbolTable.symbols.end(),
+										   [](auto &sym) { return holds_alternative<SymbolTable::Ordinary *>(sym.value); }));
+		for (auto &sym : symbolTable.symbols)
+		{
+			if (!holds_alternative<SymbolTable::Ordinary *>(sym.value))
+				continue;
+			Writer::put(symbols, w.atom(sym.name));
+			Writer::put(symbols, sym.read_only);
+			Writer::put(symbols, sym.visibility);
+			Writer::put(symbols, tables.ordinary(get<SymbolTable::Ordinary *>(sym.value)));
+			Writer::put(symbols, sym.size);
+		}
+
+		std::string ordinaries;
+		Writer::put(ordinaries, tables.ordinaries.size());
+		for (auto *o : tables.ordinaries)
+		{
+			Writer::put(ordinaries, o->storage);
+			Writer::put(ordinaries, w.type(o->type));
+			Writer::put(ordinaries, w.atom(o->name));
+			Writer::put(ordinaries, o->offset);
+			Writer::put(ordinaries, o->init ? tables.constant(o->init.value()) : 0);
+		}
+
+		std::string &body = w.body;
+		Writer::put(body, tables.constants.size());
+		for (auto *c : tables.constants)
+			Writer::put_constant(body, *c);
+		body += ordinaries;
+		Writer::put(body, bound);
+		body += bindings;
+		body += symbols;
+		Writer::put(body, count);
+		body += functions;
+
+		std::ofstream out(path, std::ios::binary);
+		if (!(out << w.finish(std::string_view(magic, sizeof(magic)))))
+			throw std::runtime_error("error: cant write file: " + path);
+	}
+
+	static TAC::Address get_address(Reader &r, const TAC::TacFunction &f, const std::vector<SymbolTable::Ordinary *> &ordinaries,
+									const std::vector<const SymbolTable::Constant *> &constants) {
+		switch (r.get())
+		{
+			case 0:
+				return {};
+			case 1:
+			{
+				uint32_t t = r.get();
+				if (t >= f.get_temps().size())
+					r.corrupted();
+				return (int)t;
+			}
+			case 2:
+			{
+				uint32_t o = r.get();
+				if (o >= ordinaries.size())
+					r.corrupted();
+				return ordinaries[o];
+			}
+			case 3:
+			{
+				uint32_t c = r.get();
+				if (!c || c >= constants.size())
+					r.corrupted();
+				return constants[c];
+			}
+			case 4:
+			{
+				uint32_t l = r.get();
+				if (l >= f.get_label_count())
+					r.corrupted();
+				return TAC::Label(l);
+			}
+			case 5:
+				return r.atom();
+			default:
+				r.corrupted();
+		}
+	}
+
+	void load(const std::string &path) {
+		SourceFile file;
+		if (!file.open(path))
+			throw std::runtime_error("error: cant open file: " + path);
+		std::string_view data = file.view();
+		if (data.size() < sizeof(magic) || memcmp(data.data(), magic, sizeof(magic)))
+			throw std::runtime_error("error: " + path + ": not a tac file");
+		if (!symbolTable.symbols.empty() || !symbolTable.functions.empty())
+			throw std::runtime_error("error: a tac file must be loaded before anything is declared");
+		Reader r(path, data.substr(sizeof(magic)), "tac file");
+		r.read_header();
+
+		std::vector<const SymbolTable::Constant *> constants{nullptr};
+		for (uint32_t n = r.get(); n; n--)
+			constants.push_back(r.get_constant());
+
+		std::vector<SymbolTable::Ordinary *> ordinaries;
+		for (uint32_t n = r.get(); n; n--)
+		{
+			SymbolTable::Ordinary o;
+			o.storage = static_cast<SymbolTable::Ordinary::Storage>(r.get());
+			o.type = r.type();
+			o.name = r.atom();
+			o.offset = r.get();
+			if (uint32_t c = r.get(); c)
+			{
+				if (c >= constants.size())
+					r.corrupted();
+				o.init = constants[c];
+			}
+			ordinaries.push_back(&symbolTable.ordinaries.emplace_back(std::move(o)));
+		}
+
+		for (uint32_t n = r.get(); n; n--)
+		{
+			Atom name = r.atom();
+			uint32_t o = r.get();
+			if (o >= ordinaries.size())
+				r.corrupted();
+			symbolTable.get_name(name).ordinaries.push_back({0, ordinaries[o]});
+		}
+
+		for (uint32_t n = r.get(); n; n--)
+		{
+			SymbolTable::Symbol sym{r.atom()};
+			sym.read_only = r.get();
+			sym.visibility = static_cast<SymbolTable::Symbol::Visibility>(r.get());
+			uint32_t o = r.get();
+			if (o >= ordinaries.size())
+				r.corrupted();
+			sym.value = ordinaries[o];
+			sym.size = r.get();
+			symbolTable.symbols.push_back(sym);
+		}
+
+		for (uint32_t n = r.get(); n; n--)
+		{
+			SymbolTable::Function &f = symbolTable.functions.emplace_back();
+			f.name = r.atom();
+			f.type = r.type();
+			f.frame_size = r.get();
+			for (uint32_t p = r.get(); p; p--)
+			{
+				uint32_t o = r.get();
+				if (o >= ordinaries.size())
+					r.corrupted();
+				f.params.push_back(ordinaries[o]);
+			}
+			symbolTable.symbols.push_back({.name = f.name, .visibility = SymbolTable::Symbol::GLOBAL, .value = &f});
+			TAC::TacFunction &tac = TAC::functions.emplace_back(f);
+			for (uint32_t t = r.get(); t; t--)
+				tac.new_temp(r.optional_type());
+
+			// the labels are set when the instruction they precede is added
+			std::vector<std::pair<int, TAC::Label>> labels;
+			for (uint32_t l = r.get(); l; l--)
+				labels.emplace_back((int)r.get(), tac.new_label());
+			std::sort(labels.begin(), labels.end(), [](auto &a, auto &b) { return a.first < b.first; });
+			auto label = std::find_if(labels.begin(), labels.end(), [](auto &l) { return l.first >= 0; });
+			uint32_t count = r.get();
+			for (uint32_t i = 0; i <= count; i++)
+			{
+				for (; label != labels.end() && label->first == (int)i; label++)
+					tac.set_label(label->second);
+				if (i == count)
+					break;
+				TAC::Instruction ins;
+				ins.op = static_cast<TAC::Operation>(r.get());
+				if (ins.op < TAC::ADD || ins.op > TAC::CALL)
+					r.corrupted();
+				ins.operation_size = r.get();
+				ins.operation_sign = r.get();
+				ins.ret = get_address(r, tac, ordinaries, constants);
+				ins.oper1 = get_address(r, tac, ordinaries, constants);
+				ins.oper2 = get_address(r, tac, ordinaries, constants);
+				tac.add_instruction(ins);
+			}
+			if (label != labels.end()) // after the end of the function
+				r.corrupted();
+		}
+	}
+
+	bool is_tac_file(const std::string &path) {
+		char buf[sizeof(magic)];
+		std::ifstream in(path, std::ios::binary);
+		return in.read(buf, sizeof(buf)) && !memcmp(buf, magic, sizeof(magic));
+	}
+}
@@ -0,0 +1,15 @@
+#ifndef CC1_POC_TACFILE_HPP
+#define CC1_POC_TACFILE_HPP
+#include <string>
+
+// Binary form of the tac of a translation unit: the functions with their instructions, temps and labels, the objects
+// and constants they refer to, and the objects of the file scope. Loading a file restores the functions and their
+// objects in the symbol table, so that they can be run by the interpreter (or transformed and saved again) without
+// parsing the source.
+namespace TacFile {
+	void	save(const std::string &path);
+	void	load(const std::string &path);
+	bool	is_tac_file(const std::string &path); // starts with the magic of a tac file
+}
+
+#endif
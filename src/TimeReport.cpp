@@ -0,0 +1,202 @@
+#include "TimeReport.hpp"
+#include <time.h>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+namespace TimeReport {
+	bool	enabled = false;
+
+	static const char *const	phase_names[PHASE_COUNT] = {
+		"other",
+		"preprocessing",
+		"lexing",
+		"parsing",
+		"typing",
+		"tac emission",
+		"code generation",
+		"output",
+	};
+	static const size_t	function_count = 10; // slowest functions in the report
+
+	static uint64_t	read_clock(clockid_t id) {
+		timespec t;
+		clock_gettime(id, &t);
+		return t.tv_sec * 1000000000ull + t.tv_nsec;
+	}
+
+	struct Times {
+		uint64_t	wall[PHASE_COUNT] = {}; // nanoseconds
+		double		cpu[PHASE_COUNT] = {};
+	};
+
+	struct FunctionTimes {
+		uint64_t	front_end = 0;
+		uint64_t	code_generation = 0;
+	};
+
+	static std::mutex						mutex; // protects the times of the finished threads and of the functions
+	static Times							finished;
+	static std::map<Atom, FunctionTimes>	functions;
+	static uint64_t							start_wall;
+	static uint64_t							start_cpu;
+	static uint64_t							function_start;
+
+	// measures of the current thread, added to the finished ones when it exits
+	struct Thread {
+		bool		started = false;
+		Phase		current = OTHER;
+		uint64_t	last = 0; // wall clock at the last switch
+		uint64_t	sampled_wall = 0; // clocks at the last read of the cpu clock
+		uint64_t	sampled_cpu = 0;
+		uint64_t	pending[PHASE_COUNT] = {}; // wall time of each phase since then
+		Times		times;
+
+		void	sample(uint64_t now)
+		{
+			uint64_t cpu = read_clock(CLOCK_THREAD_CPUTIME_ID);
+			uint64_t total = 0;
+			for (uint64_t t : this->pending)
+				total += t;
+			for (int i = 0; i < PHASE_COUNT; i++)
+				if (total)
+					this->times.cpu[i] += double(cpu - this->sampled_cpu) * this->pending[i] / total;
+				else if (i == this->current)
+					this->times.cpu[i] += cpu - this->sampled_cpu;
+			std::fill(std::begin(this->pending), std::end(this->pending), 0);
+			this->sampled_wall = now;
+			this->sampled_cpu = cpu;
+		}
+
+		void	switch_to(Phase p)
+		{
+			uint64_t now = read_clock(CLOCK_MONOTONIC);
+			if (!this->started)
+			{
+				this->started = true;
+				this->last = now;
+				this->sampled_wall = now;
+				this->sampled_cpu = read_clock(CLOCK_THREAD_CPUTIME_ID);
+			}
+			this->times.wall[this->current] += now - this->last;
+			this->pending[this->current] += now - this->last;
+			this->last = now;
+			this->current = p;
+			if (now - this->sampled_wall >= 1000000)
+				this->sample(now);
+		}
+
+		void	flush()
+		{
+			this->switch_to(this->current);
+			this->sample(this->last);
+		}
+
+		~Thread()
+		{
+			if (!this->started)
+				return;
+			this->flush();
+			std::lock_guard<std::mutex> lock(mutex);
+			for (int i = 0; i < PHASE_COUNT; i++)
+			{
+				finished.wall[i] += this->times.wall[i];
+				finished.cpu[i] += this->times.cpu[i];
+			}
+		}
+	};
+
+	static thread_local Thread	thread;
+
+	void Scope::begin(Phase p) {
+		this->previous = thread.current;
+		if (p != this->previous)
+			thread.switch_to(p);
+		if (!this->function.empty())
+			this->start = read_clock(CLOCK_MONOTONIC);
+	}
+
+	void Scope::end() {
+		if (thread.current != this->previous)
+			thread.switch_to(this->previous);
+		if (!this->function.empty())
+		{
+			uint64_t elapsed = read_clock(CLOCK_MONOTONIC) - this->start;
+			std::lock_guard<std::mutex> lock(mutex);
+			functions[this->function].code_generation += elapsed;
+		}
+	}
+
+	void start() {
+		enabled = true;
+		finished = {};
+		functions.clear();
+		thread = {};
+		thread.switch_to(OTHER);
+		start_wall = thread.last;
+		start_cpu = read_clock(CLOCK_PROCESS_CPUTIME_ID);
+	}
+
+	void begin_function() {
+		if (enabled)
+			function_start = read_clock(CLOCK_MONOTONIC);
+	}
+
+	void end_function(Atom name) {
+		if (!enabled)
+			return;
+		uint64_t elapsed = read_clock(CLOCK_MONOTONIC) - function_start;
+		std::lock_guard<std::mutex> lock(mutex);
+		functions[name].front_end += elapsed;
+	}
+
+	void print(std::ostream &os, const std::string &input) {
+		thread.flush();
+		uint64_t elapsed = thread.last - start_wall;
+		uint64_t cpu = read_clock(CLOCK_PROCESS_CPUTIME_ID) - start_cpu;
+		Times total;
+		std::vector<std::pair<Atom, FunctionTimes>> slowest;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			total = finished;
+			slowest.assign(functions.begin(), functions.end());
+		}
+		uint64_t wall_sum = 0;
+		double cpu_sum = 0;
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			total.wall[i] += thread.times.wall[i];
+			total.cpu[i] += thread.times.cpu[i];
+			wall_sum += total.wall[i];
+			cpu_sum += total.cpu[i];
+		}
+
+		char line[256];
+		os << "Execution times (seconds) of " << input << ", summed over the threads:\n";
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			snprintf(line, sizeof(line), " %-16s: %8.3f (%3.0f%%) wall %8.3f (%3.0f%%) cpu\n", phase_names[i],
+					 total.wall[i] / 1e9, wall_sum ? 100.0 * total.wall[i] / wall_sum : 0.0,
+					 total.cpu[i] / 1e9, cpu_sum ? 100.0 * total.cpu[i] / cpu_sum : 0.0);
+			os << line;
+		}
+		snprintf(line, sizeof(line), " %-16s: %8.3f        wall %8.3f        cpu\n", "TOTAL", elapsed / 1e9, cpu / 1e9);
+		os << line;
+
+		std::sort(slowest.begin(), slowest.end(), [](auto &a, auto &b) {
+			return a.second.front_end + a.second.code_generation > b.second.front_end + b.second.code_generation;
+		});
+		if (slowest.size() > function_count)
+			slowest.resize(function_count);
+		if (!slowest.empty())
+			os << "Slowest functions (milliseconds of wall time): front end, code generation\n";
+		for (auto &[name, times] : slowest)
+		{
+			snprintf(line, sizeof(line), " %8.3f %8.3f  ", times.front_end / 1e6, times.code_generation / 1e6);
+			os << line << name << '\n';
+		}
+		os.flush();
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef CC1_POC_TIMEREPORT_HPP
+#define CC1_POC_TIMEREPORT_HPP
+#include "Atom.hpp"
+#include <ostream>
+#include <cstdint>
+#include <string>
+
+// -ftime-report: time spent in each phase of the compilation, and by the slowest functions.
+// The phases are interleaved (the tac is emitted from the actions of the parser, which asks the lexer for each
+// token), so each thread has a current phase: a Scope switches to its phase and back to the previous one when it is
+// destroyed, and the time between two switches is charged to the phase which was current, never to the enclosing
+// ones. Only the wall clock is read at a switch, the cpu clock of the thread is a system call: it is read at most once
+// per millisecond and the cpu time of the interval is split between the phases in proportion to their wall time.
+// Nothing is measured when the report is not enabled, a Scope is then a test of a global.
+namespace TimeReport {
+	enum Phase {
+		OTHER, // time outside of any scope
+		PREPROCESSING,
+		LEXING,
+		PARSING,
+		TYPING,
+		TAC,
+		CODE_GENERATION,
+		OUTPUT,
+		PHASE_COUNT
+	};
+
+	extern bool	enabled;
+
+	class Scope {
+	private:
+		Phase		previous;
+		Atom		function; // the time of the whole scope is also added to this function
+		uint64_t	start;
+
+		void	begin(Phase);
+		void	end();
+	public:
+		explicit Scope(Phase p, Atom function = {}) : previous(OTHER), function(function), start(0)
+		{
+			if (enabled)
+				this->begin(p);
+		}
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+		~Scope()
+		{
+			if (enabled)
+				this->end();
+		}
+	};
+
+	void	start(); // enable and reset the measures
+	void	begin_function(); // the front end of a function is timed from begin_function to end_function
+	void	end_function(Atom name);
+	void	print(std::ostream &, const std::string &input);
+}
+
+#endif
@@ -1,10 +1,136 @@
 #include "Types.hpp"
+#include "MemoryReport.hpp"
 
 namespace Types {
 	bool is_signed(const CType &t)
 	{
 		if (!holds_alternative<PlainType>(t.type))
 			return false;
-		return get<PlainType>(t.type).is_signed;
+		return std::get<PlainType>(t.type).is_signed;
 	}
-}
\ No newline at end of file
+
+	TypeId TypeId::with_lvalue(bool lvalue) const {
+		if (this->value().is_lvalue == lvalue)
+			return *this;
+		CType t = this->value();
+		t.is_lvalue = lvalue;
+		return t;
+	}
+
+	TypeTable::TypeTable() : types(1), unqualified(1, 0) {} // id 0 is the absence of type
+
+	std::shared_ptr<CType> TypeTable::share(uint32_t id) {
+		return std::shared_ptr<CType>(std::shared_ptr<CType>(), &this->types[id]);
+	}
+
+	// only the outermost type of an expression can be an lvalue
+	uint32_t TypeTable::intern_sub_type(const CType &t) {
+		if (!t.is_lvalue)
+			return this->intern(t).id;
+		CType copy = t;
+		copy.is_lvalue = false;
+		return this->intern(copy).id;
+	}
+
+	// The structure of a type is hashed with the ids of its sub-types, which are interned first, so only the top
+	// level node is compared. Canonical nodes are recognized by their address and don't need to be hashed again.
+	TypeId TypeTable::intern(const CType &t) {
+		if (auto it = this->ids.find(&t); it != this->ids.end())
+			return TypeId(it->second);
+
+		MemoryReport::Scope memory(MemoryReport::TYPES);
+		std::string key;
+		auto put = [&key](uint32_t v) { key.append(reinterpret_cast<const char *>(&v), sizeof(v)); };
+		CType node = t; // sub-types are replaced by the canonical ones
+		put(t.type.index());
+		put(t.qualifier);
+		put(t.is_lvalue);
+		switch (t.type.index())
+		{
+			case 0: // PlainType
+			{
+				auto &plain = std::get<PlainType>(node.type);
+				if (plain.base == PlainType::VOID)
+					plain.is_signed = false;
+				put(plain.base);
+				put(plain.is_signed);
+				break;
+			}
+			case 1: // TagName
+				put(std::get<TagName>(t.type).type);
+				put(std::get<TagName>(t.type).name.get_id());
+				break;
+			case 2: // Pointer
+			{
+				uint32_t pointed = this->intern_sub_type(*std::get<Pointer>(t.type).pointed_type);
+				put(pointed);
+				std::get<Pointer>(node.type).pointed_type = this->share(pointed);
+				break;
+			}
+			case 3: // FunctionType
+			{
+				auto &function = std::get<FunctionType>(node.type);
+				uint32_t ret = this->intern_sub_type(*function.return_type);
+				put(ret);
+				function.return_type = this->share(ret);
+				put(function.variadic);
+				put(function.parameters.size());
+				for (auto &p : function.parameters)
+				{
+					uint32_t param = this->intern_sub_type(p);
+					put(param);
+					p = this->types[param];
+				}
+				break;
+			}
+			case 4: // Array
+			{
+				auto &array = std::get<Array>(node.type);
+				uint32_t value = this->intern_sub_type(*array.value_type);
+				put(value);
+				put(array.size.has_value());
+				put(array.size.value_or(0));
+				array.value_type = this->share(value);
+				break;
+			}
+			case 5: // Typename
+				put(std::get<Typename>(t.type).name.get_id());
+				break;
+		}
+
+		auto [it, inserted] = this->index.emplace(std::move(key), this->types.size());
+		if (!inserted)
+			return TypeId(it->second);
+		uint32_t id = it->second;
+		this->types.push_back(std::move(node));
+		this->ids[&this->types.back()] = id;
+		this->unqualified.push_back(id);
+
+		// the unqualified type has only unqualified sub-types, it is the type itself when there is nothing to strip
+		CType stripped = this->types[id];
+		stripped.qualifier = CType::NONE;
+		stripped.is_lvalue = false;
+		switch (stripped.type.index())
+		{
+			case 2:
+				std::get<Pointer>(stripped.type).pointed_type = this->share(this->unqualified[this->ids[std::get<Pointer>(stripped.type).pointed_type.get()]]);
+				break;
+			case 3:
+			{
+				auto &function = std::get<FunctionType>(stripped.type);
+				function.return_type = this->share(this->unqualified[this->ids[function.return_type.get()]]);
+				for (auto &p : function.parameters)
+					p = this->types[this->unqualified[this->intern(p).id]];
+				break;
+			}
+			case 4:
+				std::get<Array>(stripped.type).value_type = this->share(this->unqualified[this->ids[std::get<Array>(stripped.type).value_type.get()]]);
+				break;
+		}
+		uint32_t u = this->intern(stripped).id;
+		this->unqualified[id] = u;
+		return TypeId(id);
+	}
+
+	TypeTable	typeTable;
+}
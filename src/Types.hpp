@@ -7,6 +7,11 @@
 #include <map>
 #include <queue>
 #include <list>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Atom.hpp"
 
 namespace Types
 {
@@ -29,14 +34,14 @@ namespace Types
 	struct StructOrUnion {
 		friend bool operator==(const StructOrUnion &, const StructOrUnion &) = default;
 		struct Entry {
-			std::string					name;
+			Atom						name;
 			std::shared_ptr<CType>		type;
 			int							bitfield;
 		};
 		bool							is_union;
-		std::optional<std::string>		tag;
+		std::optional<Atom>				tag;
 		std::deque<Entry>				members;
-		std::map<std::string, Entry*>	member_map;
+		std::map<Atom, Entry*>			member_map;
 	};
 	struct Enum {
 
@@ -61,7 +66,7 @@ namespace Types
 		friend bool operator==(const TagName &, const TagName &) = default;
 		typedef Tag::Type Type;
 		Type type;
-		std::string name;
+		Atom name;
 	};
 
 	struct Pointer {
@@ -81,7 +86,7 @@ namespace Types
 	};
 	struct Typename {
 		friend bool operator==(const Typename &, const Typename &) = default;
-		std::string name;
+		Atom name;
 	};
 	struct CType {
 		enum TypeQualifier {
@@ -105,6 +110,61 @@ namespace Types
 		bool			is_lvalue;
 	};
 
+	// Handle on a type interned in the type table, as small as an int. Each distinct type (qualifiers and lvalue-ness
+	// included) is stored once as an immutable node whose sub-types are canonical too, so two handles are equal if and
+	// only if the types are. It is used like an std::optional<CType>.
+	class TypeId {
+	private:
+		uint32_t	id; // 0 when there is no type
+		explicit TypeId(uint32_t i) : id(i) {}
+		friend class TypeTable;
+	public:
+		TypeId() : id(0) {}
+		TypeId(std::nullopt_t) : id(0) {}
+		TypeId(const CType &);
+		TypeId(const std::optional<CType> &t) : id(t ? TypeId(*t).id : 0) {}
+
+		bool			has_value() const { return this->id; }
+		explicit operator bool() const { return this->id; }
+		const CType		&value() const;
+		const CType		&operator*() const { return this->value(); }
+		const CType		*operator->() const { return &this->value(); }
+		uint32_t		get_id() const { return this->id; }
+
+		TypeId			unqualified() const; // without qualifiers nor lvalue-ness, at every level
+		TypeId			with_lvalue(bool) const;
+
+		friend bool operator==(TypeId a, TypeId b) { return a.id == b.id; }
+	};
+
+	class TypeTable {
+	private:
+		std::deque<CType>								types; // by id, never modified once interned
+		std::vector<uint32_t>							unqualified;
+		std::unordered_map<const CType*, uint32_t>		ids; // canonical node to its id
+		std::unordered_map<std::string, uint32_t>		index; // structure of a type, with the ids of its sub-types
+
+		std::shared_ptr<CType>	share(uint32_t id); // non owning pointer to a canonical node
+		uint32_t				intern_sub_type(const CType &);
+	public:
+		TypeTable();
+
+		TypeId			intern(const CType &);
+		const CType		&get(TypeId t) const { return this->types[t.id]; }
+		TypeId			get_unqualified(TypeId t) const { return TypeId(this->unqualified[t.id]); }
+	};
+
+	extern TypeTable	typeTable;
+
+	inline TypeId::TypeId(const CType &t) : id(typeTable.intern(t).id) {}
+	inline const CType &TypeId::value() const {
+		if (!this->id)
+			throw std::bad_optional_access();
+		return typeTable.get(*this);
+	}
+	inline TypeId TypeId::unqualified() const { return typeTable.get_unqualified(*this); }
+
 	bool is_signed(const CType &t);
+	inline bool is_signed(TypeId t) { return is_signed(*t); }
 }
 #endif //CC1_POC_TYPES_HPP
@@ -3,42 +3,299 @@
 #include "TAC.hpp"
 #include "CodeGeneration.hpp"
 #include "CommandLine.hpp"
+#include "OutputBuffer.hpp"
+#include "SourceFile.hpp"
+#include "Preprocessor.hpp"
+#include "Server.hpp"
+#include "PrecompiledHeader.hpp"
+#include "CompilationCache.hpp"
+#include "TimeReport.hpp"
+#include "MemoryReport.hpp"
+#include "TacFile.hpp"
+#include "Interpreter.hpp"
+#include "ConstantPropagation.hpp"
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstring>
+#include <map>
 
+Arena astArena; // declared before tree, which points into it
 Ast::TranslationUnit tree;
 int yydebug;
 
 std::shared_ptr<yyLexer>	lexer;
 std::shared_ptr<yyParser>	parser;
 std::shared_ptr<CommandLine>	commandLine;
+std::shared_ptr<SourceFile>		source;
 
 
-int main(int argc, char **argv)
+// run main with the input file as its only argument, the exit status is its return value
+static int run_tac()
 {
-	std::istream *stream = &std::cin;
-	std::ifstream file;
-	commandLine.reset(new CommandLine(argc, argv));
-	file.open(commandLine->input_file);
-	stream = &file;
-	if (!file.is_open())
+	try {
+		return TAC::Interpreter().run_main({commandLine->input_file}) & 0xff;
+	} catch (std::runtime_error &e) {
+		std::cerr << "error: " << commandLine->input_file << ": " << e.what() << std::endl;
+		return 1;
+	}
+}
+
+// compile commandLine->input_file to commandLine->output_file
+static int compile_file()
+{
+	// a tac file is not parsed, it can only be run
+	if (commandLine->run_tac && TacFile::is_tac_file(commandLine->input_file))
+	{
+		try {
+			TacFile::load(commandLine->input_file);
+		} catch (std::runtime_error &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		return run_tac();
+	}
+	source.reset(new SourceFile);
+	if (!source->open(commandLine->input_file))
 	{
 		std::cerr << "error: cant open file: " << commandLine->input_file << std::endl;
 		return 1;
 	}
-	lexer.reset(new yyLexer(stream));
+
+	Preprocessing::Preprocessor preprocessor;
+	for (auto &path : commandLine->include_paths)
+		preprocessor.add_include_path(path);
+	std::string text;
+	try {
+		TimeReport::Scope timer(TimeReport::PREPROCESSING);
+		MemoryReport::Scope memory(MemoryReport::PREPROCESSOR);
+		// the header is not parsed again, its file scope is restored and its macros are defined before the -D and -U
+		// of the command line, which override them
+		if (!commandLine->pch_file.empty())
+			preprocessor.add_definitions(PrecompiledHeader::load(commandLine->pch_file));
+		for (auto &macro : commandLine->macros)
+			if (macro[0] == 'D')
+				preprocessor.define(macro.substr(1));
+			else
+				preprocessor.undefine(macro.substr(1));
+		text = preprocessor.run(commandLine->input_file, source->view());
+	} catch (std::runtime_error &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	if (commandLine->mem_report_phases)
+		MemoryReport::print(std::cerr, commandLine->input_file, "after preprocessing");
+	if (commandLine->dependencies)
+	{
+		std::string path = commandLine->dependency_file;
+		if (path.empty())
+			path = commandLine->output_file.substr(0, commandLine->output_file.find_last_of('.')) + ".d";
+		std::ofstream dependencies(path);
+		if (!(dependencies << preprocessor.get_dependencies(commandLine->output_file)))
+		{
+			std::cerr << "error: cant write file: " << path << std::endl;
+			return 1;
+		}
+	}
+	if (commandLine->preprocess_only)
+	{
+		std::ofstream output(commandLine->output_file);
+		if (!(output << text))
+		{
+			std::cerr << "error: cant write file: " << commandLine->output_file << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+	// the whole output is reused when the preprocessed text (and the precompiled header it starts from) didn't change
+	std::string cache_key;
+	if (CompilationCache::enabled() && !commandLine->emit_pch && !commandLine->emit_tac && !commandLine->run_tac)
+	{
+		Hash h = CompilationCache::new_key("file");
+		h.put(text);
+		SourceFile pch;
+		if (!commandLine->pch_file.empty() && pch.open(commandLine->pch_file))
+			h.put(pch.view());
+		cache_key = h.finish();
+		std::string data;
+		if (CompilationCache::load(cache_key, data))
+		{
+			std::ofstream output(commandLine->output_file, std::ios::binary);
+			if (!(output << data))
+			{
+				std::cerr << "error: cant write file: " << commandLine->output_file << std::endl;
+				return 1;
+			}
+			return 0;
+		}
+	}
+	std::string definitions; // the macros point into the input, which is replaced by its preprocessed text
+	if (commandLine->emit_pch)
+		definitions = preprocessor.get_definitions();
+	source->assign(std::move(text));
+
+	std::istream stream(source.get());
+	lexer.reset(new yyLexer(&stream));
 
 //	std::pair<int, YYSTYPE> ret;
 //	while ((ret = lexer.yylex()).first)
 //		std::cout << ret.first << std::endl
 //	yydebug = 1;
 	parser.reset(new yyParser(*lexer));
-	if (parser->yyparse())
-		return 1; // todo error management
+	{
+		TimeReport::Scope timer(TimeReport::PARSING);
+		MemoryReport::Scope memory(MemoryReport::AST);
+		if (parser->yyparse())
+			return 1; // todo error management
+	}
+	if (commandLine->mem_report_phases)
+		MemoryReport::print(std::cerr, commandLine->input_file, "after parsing");
+	// the tac is generated during the parsing, the tree is not needed anymore
+	tree.clear();
+	astArena.clear();
+	if (commandLine->emit_pch)
+	{
+		try {
+			PrecompiledHeader::save(commandLine->output_file, definitions);
+		} catch (std::runtime_error &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+	if (commandLine->sccp)
+		TAC::propagate_constants();
+	if (commandLine->fold_pure_calls)
+	{
+		TAC::fold_pure_calls();
+		if (commandLine->sccp) // the results of the calls are constants in turn
+			TAC::propagate_constants();
+	}
+	if (commandLine->emit_tac)
+	{
+		try {
+			TacFile::save(commandLine->output_file);
+		} catch (std::runtime_error &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+	if (commandLine->run_tac)
+		return run_tac();
 
-	std::ofstream out(commandLine->output_file);
-	if (!out.is_open())
+	int fd = open(commandLine->output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
 	{
 		std::cerr << "error: cant open file: " << commandLine->output_file << std::endl;
 		return 1;
 	}
-	CodeGeneration::FileGenerator(out).generate();
-}
\ No newline at end of file
+	MemoryReport::Scope memory(MemoryReport::OUTPUT);
+	OutputBuffer out(fd);
+	{
+		TimeReport::Scope timer(TimeReport::OUTPUT);
+		CodeGeneration::FileGenerator(out).generate();
+		if (!out.finish())
+		{
+			std::cerr << "error: cant write file: " << commandLine->output_file << ": " << strerror(out.get_error()) << std::endl;
+			close(fd);
+			return 1;
+		}
+	}
+	close(fd);
+	if (!cache_key.empty())
+	{
+		SourceFile output;
+		if (output.open(commandLine->output_file))
+			CompilationCache::store(cache_key, output.view());
+	}
+	return 0;
+}
+
+static int compile()
+{
+	if (commandLine->time_report)
+		TimeReport::start();
+	if (commandLine->mem_report)
+		MemoryReport::start();
+	int ret = compile_file();
+	if (commandLine->time_report)
+		TimeReport::print(std::cerr, commandLine->input_file);
+	if (commandLine->mem_report)
+		MemoryReport::print(std::cerr, commandLine->input_file, "at the end");
+	return ret;
+}
+
+// Several inputs are compiled by child processes forked from this one, at most commandLine->jobs at a time. Each
+// child starts from the state of the compiler before any compilation, and writes the output of one input.
+static int compile_all()
+{
+	std::map<pid_t, std::string>	running;
+	size_t							next = 0;
+	int								ret = 0;
+
+	std::cout.flush();
+	std::cerr.flush();
+	while (next < commandLine->input_files.size() || !running.empty())
+	{
+		if (next < commandLine->input_files.size() && running.size() < (size_t)commandLine->jobs)
+		{
+			const std::string &input = commandLine->input_files[next++];
+			pid_t pid = fork();
+			if (pid < 0)
+			{
+				std::cerr << "error: cant fork: " << strerror(errno) << std::endl;
+				ret = 1;
+				next = commandLine->input_files.size(); // wait for the running ones and stop
+				continue;
+			}
+			if (pid == 0)
+			{
+				commandLine->input_file = input;
+				commandLine->output_file = commandLine->get_output_file(input);
+				commandLine->jobs = 1;
+				exit(compile());
+			}
+			running[pid] = input;
+			continue;
+		}
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			std::cerr << "error: wait: " << strerror(errno) << std::endl;
+			return 1;
+		}
+		auto it = running.find(pid);
+		if (it == running.end())
+			continue;
+		if (WIFSIGNALED(status))
+			std::cerr << "error: " << it->second << ": compiler terminated by signal " << WTERMSIG(status) << std::endl;
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			ret = 1;
+		running.erase(it);
+	}
+	return ret;
+}
+
+static int run()
+{
+	if (commandLine->input_files.size() > 1)
+		return compile_all();
+	return compile();
+}
+
+int main(int argc, char **argv)
+{
+	commandLine.reset(new CommandLine(argc, argv));
+	if (!commandLine->server_socket.empty())
+		return Server::run(commandLine->server_socket, run);
+	// a compile server is used when it is running, otherwise the compilation is done here
+	if (const char *socket = getenv("CC1_SERVER"))
+		if (int ret = Server::forward(socket, argc, argv); ret >= 0)
+			return ret;
+	return run();
+}
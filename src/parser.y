@@ -8,11 +8,9 @@
 int yyerror(char *s);
 int yyerror(const std::string &s);
 
-extern Ast::DeclarationSpecifierList current_declaration_specifier_list;
-
 %}
 
-%token <std::string> IDENTIFIER
+%token <Atom> IDENTIFIER
 %token <const SymbolTable::Constant*> CONSTANT
 %token <const SymbolTable::Constant*> FLOAT_CONSTANT
 %token <const SymbolTable::Constant*> STRING_LITERAL
@@ -21,7 +19,7 @@ extern Ast::DeclarationSpecifierList current_declaration_specifier_list;
 %token AND_OP OR_OP MUL_ASSIGN DIV_ASSIGN MOD_ASSIGN ADD_ASSIGN
 %token SUB_ASSIGN LEFT_ASSIGN RIGHT_ASSIGN AND_ASSIGN
 %token XOR_ASSIGN OR_ASSIGN
-%token <std::string> TYPE_NAME
+%token <Atom> TYPE_NAME
 
 %token TYPEDEF EXTERN STATIC AUTO REGISTER
 %token CHAR SHORT INT LONG SIGNED UNSIGNED FLOAT DOUBLE CONST VOLATILE VOID
@@ -137,35 +135,35 @@ primary_expression
 			$$ = {Expression::IDENTIFIER, {}, std::nullopt, std::nullopt, $1, ptr->type, ptr};
 		else
 			$$ = {Expression::IDENTIFIER, {}, std::nullopt, std::nullopt, $1, ptr->type, ptr};
-		$$.type->is_lvalue = true;
+		$$.type = $$.type.with_lvalue(true);
 	} /*todo*/
 	| CONSTANT {$$ = {Expression::CONSTANT, {}, std::nullopt, $1, {}, CTYPE_LONG_INT, $1};}
 	| FLOAT_CONSTANT {$$ = {Expression::CONSTANT, {}, std::nullopt, $1, {}, CTYPE_LONG_DOUBLE, $1};}
 	| STRING_LITERAL {$$ = {Expression::CONSTANT, {}, std::nullopt, $1, {}, CTYPE_CHAR_PTR, $1};}
-	| '(' expression ')' {$$ = $2;}
+	| '(' expression ')' {$$ = std::move($2);}
 	;
 
 postfix_expression
-	: primary_expression {$$ = $1;}
-	| postfix_expression '[' expression ']' {$$ = {Expression::DEREFERENCE, {{Expression::ADD, {$1, $3}}}};}
-	| postfix_expression '(' ')' {$$ = {Expression::CALL, {$1}};}
-	| postfix_expression '(' argument_expression_list ')' {$$ = {Expression::CALL, {$1}}; $$.operands.insert($$.operands.end(), $3.begin(), $3.end());}
-	| postfix_expression '.' IDENTIFIER {$$ = {Expression::MEMBER_ACCESS, {$1}, std::nullopt, {}, $3};}
-	| postfix_expression PTR_OP IDENTIFIER {$$ = {Expression::PTR_MEMBER_ACCESS, {$1}, std::nullopt, {}, $3};}
-	| postfix_expression INC_OP {$$ = {Expression::POST_INC, {$1}};}
-	| postfix_expression DEC_OP {$$ = {Expression::POST_DEC, {$1}};}
+	: primary_expression {$$ = std::move($1);}
+	| postfix_expression '[' expression ']' {$$ = {Expression::DEREFERENCE, Expression::make_operands(Expression::Node{Expression::ADD, Expression::make_operands(std::move($1), std::move($3))})};}
+	| postfix_expression '(' ')' {$$ = {Expression::CALL, Expression::make_operands(std::move($1))};}
+	| postfix_expression '(' argument_expression_list ')' {$$ = {Expression::CALL, Expression::make_operands(std::move($1))}; $$.operands.insert($$.operands.end(), std::make_move_iterator($3.begin()), std::make_move_iterator($3.end()));}
+	| postfix_expression '.' IDENTIFIER {$$ = {Expression::MEMBER_ACCESS, Expression::make_operands(std::move($1)), std::nullopt, {}, $3};}
+	| postfix_expression PTR_OP IDENTIFIER {$$ = {Expression::PTR_MEMBER_ACCESS, Expression::make_operands(std::move($1)), std::nullopt, {}, $3};}
+	| postfix_expression INC_OP {$$ = {Expression::POST_INC, Expression::make_operands(std::move($1))};}
+	| postfix_expression DEC_OP {$$ = {Expression::POST_DEC, Expression::make_operands(std::move($1))};}
 	;
 
 argument_expression_list
-	: assignment_expression {$$ = {$1};}
-	| argument_expression_list ',' assignment_expression {$1.emplace_back($3);$$ = $1; }
+	: assignment_expression {$$ = Expression::make_operands(std::move($1));}
+	| argument_expression_list ',' assignment_expression {$$ = std::move($1); $$.emplace_back(std::move($3));}
 	;
 
 unary_expression
-	: postfix_expression {$$ = $1;}
-	| INC_OP unary_expression {$$ = {Expression::PRE_INC, {$2}};}
-	| DEC_OP unary_expression {$$ = {Expression::PRE_DEC, {$2}};}
-	| unary_operator cast_expression {$$ = {$1, {$2}};}
+	: postfix_expression {$$ = std::move($1);}
+	| INC_OP unary_expression {$$ = {Expression::PRE_INC, Expression::make_operands(std::move($2))};}
+	| DEC_OP unary_expression {$$ = {Expression::PRE_DEC, Expression::make_operands(std::move($2))};}
+	| unary_operator cast_expression {$$ = {$1, Expression::make_operands(std::move($2))};}
 	| SIZEOF unary_expression {
 		Expression::DeduceType($2);
 		const SymbolTable::Constant* constant = symbolTable.new_constant(symbolTable.size_of($2.type.value()));
@@ -203,76 +201,76 @@ unary_operator
 	;
 
 cast_expression
-	: unary_expression {$$ = $1;}
-	| '(' type_name ')' cast_expression {$$ = {Expression::CAST, {$4}, Ast::parse_type_name($2)};}
+	: unary_expression {$$ = std::move($1);}
+	| '(' type_name ')' cast_expression {$$ = {Expression::CAST, Expression::make_operands(std::move($4)), Ast::parse_type_name($2)};}
 	;
 
 multiplicative_expression
-	: cast_expression {$$ = $1;}
-	| multiplicative_expression '*' cast_expression {$$ = {Expression::MUL, {$1, $3}};}
-	| multiplicative_expression '/' cast_expression {$$ = {Expression::DIV, {$1, $3}};}
-	| multiplicative_expression '%' cast_expression {$$ = {Expression::MOD, {$1, $3}};}
+	: cast_expression {$$ = std::move($1);}
+	| multiplicative_expression '*' cast_expression {$$ = {Expression::MUL, Expression::make_operands(std::move($1), std::move($3))};}
+	| multiplicative_expression '/' cast_expression {$$ = {Expression::DIV, Expression::make_operands(std::move($1), std::move($3))};}
+	| multiplicative_expression '%' cast_expression {$$ = {Expression::MOD, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 additive_expression
-	: multiplicative_expression {$$ = $1;}
-	| additive_expression '+' multiplicative_expression {$$ = {Expression::ADD, {$1, $3}};}
-	| additive_expression '-' multiplicative_expression {$$ = {Expression::SUB, {$1, $3}};}
+	: multiplicative_expression {$$ = std::move($1);}
+	| additive_expression '+' multiplicative_expression {$$ = {Expression::ADD, Expression::make_operands(std::move($1), std::move($3))};}
+	| additive_expression '-' multiplicative_expression {$$ = {Expression::SUB, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 shift_expression
-	: additive_expression {$$ = $1;}
-	| shift_expression LEFT_OP additive_expression {$$ = {Expression::BITSHIFT_LEFT, {$1, $3}};}
-	| shift_expression RIGHT_OP additive_expression {$$ = {Expression::BITSHIFT_RIGHT, {$1, $3}};}
+	: additive_expression {$$ = std::move($1);}
+	| shift_expression LEFT_OP additive_expression {$$ = {Expression::BITSHIFT_LEFT, Expression::make_operands(std::move($1), std::move($3))};}
+	| shift_expression RIGHT_OP additive_expression {$$ = {Expression::BITSHIFT_RIGHT, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 relational_expression
-	: shift_expression {$$ = $1;}
-	| relational_expression '<' shift_expression {$$ = {Expression::LESSER, {$1, $3}};}
-	| relational_expression '>' shift_expression {$$ = {Expression::GREATER, {$1, $3}};}
-	| relational_expression LE_OP shift_expression {$$ = {Expression::LESSER_EQUAL, {$1, $3}};}
-	| relational_expression GE_OP shift_expression {$$ = {Expression::GREATER_EQUAL, {$1, $3}};}
+	: shift_expression {$$ = std::move($1);}
+	| relational_expression '<' shift_expression {$$ = {Expression::LESSER, Expression::make_operands(std::move($1), std::move($3))};}
+	| relational_expression '>' shift_expression {$$ = {Expression::GREATER, Expression::make_operands(std::move($1), std::move($3))};}
+	| relational_expression LE_OP shift_expression {$$ = {Expression::LESSER_EQUAL, Expression::make_operands(std::move($1), std::move($3))};}
+	| relational_expression GE_OP shift_expression {$$ = {Expression::GREATER_EQUAL, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 equality_expression
-	: relational_expression {$$ = $1;}
-	| equality_expression EQ_OP relational_expression {$$ = {Expression::EQUAL, {$1, $3}};}
-	| equality_expression NE_OP relational_expression {$$ = {Expression::NOT_EQUAL, {$1, $3}};}
+	: relational_expression {$$ = std::move($1);}
+	| equality_expression EQ_OP relational_expression {$$ = {Expression::EQUAL, Expression::make_operands(std::move($1), std::move($3))};}
+	| equality_expression NE_OP relational_expression {$$ = {Expression::NOT_EQUAL, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 and_expression
-	: equality_expression {$$ = $1;}
-	| and_expression '&' equality_expression {$$ = {Expression::BITWISE_AND, {$1, $3}};}
+	: equality_expression {$$ = std::move($1);}
+	| and_expression '&' equality_expression {$$ = {Expression::BITWISE_AND, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 exclusive_or_expression
-	: and_expression {$$ = $1;}
-	| exclusive_or_expression '^' and_expression {$$ = {Expression::BITWISE_XOR, {$1, $3}};}
+	: and_expression {$$ = std::move($1);}
+	| exclusive_or_expression '^' and_expression {$$ = {Expression::BITWISE_XOR, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 inclusive_or_expression
-	: exclusive_or_expression {$$ = $1;}
-	| inclusive_or_expression '|' exclusive_or_expression {$$ = {Expression::BITWISE_OR, {$1, $3}};}
+	: exclusive_or_expression {$$ = std::move($1);}
+	| inclusive_or_expression '|' exclusive_or_expression {$$ = {Expression::BITWISE_OR, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 logical_and_expression
-	: inclusive_or_expression {$$ = $1;}
-	| logical_and_expression AND_OP inclusive_or_expression {$$ = {Expression::LOGICAL_AND, {$1, $3}};}
+	: inclusive_or_expression {$$ = std::move($1);}
+	| logical_and_expression AND_OP inclusive_or_expression {$$ = {Expression::LOGICAL_AND, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 logical_or_expression
-	: logical_and_expression {$$ = $1;}
-	| logical_or_expression OR_OP logical_and_expression {$$ = {Expression::LOGICAL_OR, {$1, $3}};}
+	: logical_and_expression {$$ = std::move($1);}
+	| logical_or_expression OR_OP logical_and_expression {$$ = {Expression::LOGICAL_OR, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 conditional_expression
-	: logical_or_expression {$$ = $1;}
-	| logical_or_expression '?' expression ':' conditional_expression {$$ = {Expression::TERNARY, {$1, $3, $5}};}
+	: logical_or_expression {$$ = std::move($1);}
+	| logical_or_expression '?' expression ':' conditional_expression {$$ = {Expression::TERNARY, Expression::make_operands(std::move($1), std::move($3), std::move($5))};}
 	;
 
 assignment_expression
-	: conditional_expression {$$ = $1;}
-	| unary_expression assignment_operator assignment_expression {$$ = {$2, {$1, $3}};}
+	: conditional_expression {$$ = std::move($1);}
+	| unary_expression assignment_operator assignment_expression {$$ = {$2, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 
 assignment_operator
@@ -290,50 +288,51 @@ assignment_operator
 	;
 
 comma_expression
-	: assignment_expression {$$ = $1;}
-	| comma_expression ',' assignment_expression {$$ = {Expression::COMMA, {$1, $3}};}
+	: assignment_expression {$$ = std::move($1);}
+	| comma_expression ',' assignment_expression {$$ = {Expression::COMMA, Expression::make_operands(std::move($1), std::move($3))};}
 	;
 	
 expression
-	: comma_expression {Expression::DeduceType($1);$$ = $1;}
+	: comma_expression {$$ = std::move($1);/* typed when it is emitted, or by constant_expression */}
 	;
 
 constant_expression
 	: expression {
+		Expression::DeduceType($1);
 		if (!Ast::is_const_expression($1))
 		{
 			yyerror("expression is not constant");
 			YYERROR;
 		}
-		$$ = $1;
+		$$ = std::move($1);
 	}
 	;
 
 declaration
-	: declaration_specifier_list ';' {$$ = {$1, std::nullopt}; }
-	| declaration_specifier_list init_declarator_list ';' {$$ = {$1, $2}; }
+	: declaration_specifier_list ';' {$$ = {std::move($1), std::nullopt}; }
+	| declaration_specifier_list init_declarator_list ';' {$$ = {std::move($1), std::move($2)}; }
 	;
 	
 declaration_specifier
-	: type_specifier {$$ = $1;}
-	| storage_class_specifier {$$ = $1;}
-	| type_qualifier {$$ = $1;}
+	: type_specifier {$$ = std::move($1);}
+	| storage_class_specifier {$$ = std::move($1);}
+	| type_qualifier {$$ = std::move($1);}
 	;
 
 
 declaration_specifier_list
-	: declaration_specifier {$$ = Ast::DeclarationSpecifierList(1, $1); current_declaration_specifier_list = $$;}
-	| declaration_specifier_list declaration_specifier  {$$ = $1; $$.emplace_back($2); current_declaration_specifier_list = $$;}
+	: declaration_specifier {$$ = Ast::DeclarationSpecifierList(); $$.emplace_back(std::move($1));}
+	| declaration_specifier_list declaration_specifier  {$$ = std::move($1); $$.emplace_back(std::move($2));}
 	;
 
 init_declarator_list
-	: init_declarator {$$ = Ast::InitDeclaratorList(1, $1);Ast::Declare(Ast::Declaration{$<Ast::DeclarationSpecifierList>0, {{$1}}});}
-	| init_declarator_list ',' init_declarator {$$ = $1; $$.emplace_back($3);Ast::Declare(Ast::Declaration{$<Ast::DeclarationSpecifierList>0, {{$3}}});}
+	: init_declarator {Ast::Declare($<Ast::DeclarationSpecifierList>0, $1);$$ = Ast::InitDeclaratorList(); $$.emplace_back(std::move($1));}
+	| init_declarator_list ',' init_declarator {Ast::Declare($<Ast::DeclarationSpecifierList>0, $3);$$ = std::move($1); $$.emplace_back(std::move($3));}
 	;
 
 init_declarator
-	: declarator {$$ = {$1, std::nullopt};}
-	| declarator '=' initializer {$$ = {$1, $3};}
+	: declarator {$$ = {std::move($1), std::nullopt};}
+	| declarator '=' initializer {$$ = {std::move($1), std::move($3)};}
 	;
 
 storage_class_specifier
@@ -354,14 +353,14 @@ type_specifier
 	| DOUBLE {$$ =  {Ast::TypeSpecifier::DOUBLE};}
 	| SIGNED {$$ =  {Ast::TypeSpecifier::SIGNED};}
 	| UNSIGNED {$$ =  {Ast::TypeSpecifier::UNSIGNED};}
-	| struct_or_union_specifier {$$ =  {Ast::TypeSpecifier::STRUCT_OR_UNION, $1};}
-	| enum_specifier {$$ = {Ast::TypeSpecifier::ENUM, $1};}
+	| struct_or_union_specifier {$$ =  {Ast::TypeSpecifier::STRUCT_OR_UNION, std::move($1)};}
+	| enum_specifier {$$ = {Ast::TypeSpecifier::ENUM, std::move($1)};}
 	| TYPE_NAME {$$ =  {Ast::TypeSpecifier::TYPE_NAME, $1};}
 	;
 
 struct_or_union_specifier
-	: struct_or_union IDENTIFIER '{' struct_declaration_list '}' {$$ = {$1, $2, $4};}
-	| struct_or_union '{' struct_declaration_list '}' {$$ = {$1, std::nullopt, $3};}
+	: struct_or_union IDENTIFIER '{' struct_declaration_list '}' {$$ = {$1, $2, std::move($4)};}
+	| struct_or_union '{' struct_declaration_list '}' {$$ = {$1, std::nullopt, std::move($3)};}
 	| struct_or_union IDENTIFIER {$$ = {$1, $2, std::nullopt};}
 	;
 
@@ -371,41 +370,41 @@ struct_or_union
 	;
 
 struct_declaration_list
-	: struct_declaration {$$ = {std::shared_ptr<Ast::StructDeclaration>(new Ast::StructDeclaration($1))};}
-	| struct_declaration_list struct_declaration {$$ = $1; $$.emplace_back(new Ast::StructDeclaration($2));}
+	: struct_declaration {$$ = {astArena.make<Ast::StructDeclaration>(std::move($1))};}
+	| struct_declaration_list struct_declaration {$$ = std::move($1); $$.emplace_back(astArena.make<Ast::StructDeclaration>(std::move($2)));}
 	;
 
 struct_declaration
-	: specifier_qualifier_list struct_declarator_list ';' {$$ = {$1, $2};}
+	: specifier_qualifier_list struct_declarator_list ';' {$$ = {std::move($1), std::move($2)};}
 	;
 
 specifier_qualifier_list
-	: type_specifier specifier_qualifier_list {$$ = $2; $$.emplace_front($1);}
-	| type_specifier {$$ = {$1};}
-	| type_qualifier specifier_qualifier_list {$$ = $2; $$.emplace_front($1);}
+	: type_specifier specifier_qualifier_list {$$ = std::move($2); $$.emplace_front(std::move($1));}
+	| type_specifier {$$ = Ast::DeclarationSpecifierList(); $$.emplace_back(std::move($1));}
+	| type_qualifier specifier_qualifier_list {$$ = std::move($2); $$.emplace_front($1);}
 	| type_qualifier {$$ = {$1};}
 	;
 
 struct_declarator_list
-	: struct_declarator {$$ = {$1};}
-	| struct_declarator_list ',' struct_declarator {$$ = $1; $$.emplace_back($3);}
+	: struct_declarator {$$ = Ast::StructDeclaratorList(); $$.emplace_back(std::move($1));}
+	| struct_declarator_list ',' struct_declarator {$$ = std::move($1); $$.emplace_back(std::move($3));}
 	;
 
 struct_declarator
-	: declarator {$$ = {$1, std::nullopt};}
-	| ':' constant_expression {$$ = {std::nullopt, $2};}
-	| declarator ':' constant_expression {$$ = {$1, $3};}
+	: declarator {$$ = {std::move($1), std::nullopt};}
+	| ':' constant_expression {$$ = {std::nullopt, std::move($2)};}
+	| declarator ':' constant_expression {$$ = {std::move($1), std::move($3)};}
 	;
 
 enum_specifier
-	: ENUM IDENTIFIER '{' enumerator_list '}' {$$ = {$2, $4};}
-	| ENUM '{' enumerator_list '}' {$$ = {std::nullopt, $3};}
+	: ENUM IDENTIFIER '{' enumerator_list '}' {$$ = {$2, std::move($4)};}
+	| ENUM '{' enumerator_list '}' {$$ = {std::nullopt, std::move($3)};}
 	| ENUM IDENTIFIER {$$ = {$2, std::nullopt};}
 	;
 
 enumerator_list
 	: enumerator {$$ = Ast::EnumeratorList(1, $1);}
-	| enumerator_list ',' enumerator {$$ = $1; $$.emplace_back($3);}
+	| enumerator_list ',' enumerator {$$ = std::move($1); $$.emplace_back($3);}
 	;
 
 enumerator
@@ -419,42 +418,42 @@ type_qualifier
 	;
 
 declarator
-	: pointer direct_declarator {$$ = {$1, $2};}
-	| direct_declarator {$$ = {{}, $1};}
+	: pointer direct_declarator {$$ = {std::move($1), std::move($2)};}
+	| direct_declarator {$$ = {{}, std::move($1)};}
 	;
 
 array_declarator
-	: direct_declarator_pointer '[' constant_expression ']' {$$ = {$1, $3};}
+	: direct_declarator_pointer '[' constant_expression ']' {$$ = {$1, std::move($3)};}
 	| direct_declarator_pointer '[' ']' {$$ = {$1, std::nullopt};}
 	;
 
 function_declarator
-	: direct_declarator_pointer '(' parameter_type_list ')' {$$ = {$1, $3};}
-	| direct_declarator_pointer '(' identifier_list ')' {$$ = {$1, $3};}
+	: direct_declarator_pointer '(' parameter_type_list ')' {$$ = {$1, std::move($3)};}
+	| direct_declarator_pointer '(' identifier_list ')' {$$ = {$1, std::move($3)};}
 	| direct_declarator_pointer '(' ')' {$$ = {$1};}
 	;
 
 nested_declarator
-	: '(' declarator ')' {$$ = Ast::NestedDeclarator(new Ast::Declarator($2));}
+	: '(' declarator ')' {$$ = astArena.make<Ast::Declarator>(std::move($2));}
 	;
 
 direct_declarator
-	: IDENTIFIER {$$ = $1;}
-	| TYPE_NAME {$$ = $1;}
-	| nested_declarator {$$ = $1;}
-	| array_declarator {$$ = $1;}
-	| function_declarator {$$ = $1;}
+	: IDENTIFIER {$$ = std::move($1);}
+	| TYPE_NAME {$$ = std::move($1);}
+	| nested_declarator {$$ = std::move($1);}
+	| array_declarator {$$ = std::move($1);}
+	| function_declarator {$$ = std::move($1);}
 	;
 
 direct_declarator_pointer
-	: direct_declarator {$$ = Ast::DirectDeclaratorPointer(new Ast::DirectDeclarator($1));}
+	: direct_declarator {$$ = astArena.make<Ast::DirectDeclarator>(std::move($1));}
 	;
 
 pointer
 	: '*' {$$ = {std::nullopt};}
 	| '*' type_qualifier_list {$$ = {$2};}
-	| '*' pointer {$$ = $2; $$.emplace_front(std::nullopt);}
-	| '*' type_qualifier_list pointer {$$ = $3; $$.emplace_front($2);}
+	| '*' pointer {$$ = std::move($2); $$.emplace_front(std::nullopt);}
+	| '*' type_qualifier_list pointer {$$ = std::move($3); $$.emplace_front($2);}
 	;
 
 type_qualifier_list
@@ -464,123 +463,123 @@ type_qualifier_list
 
 
 parameter_type_list
-	: parameter_list {$$ = {$1, false};}
-	| parameter_list ',' ELLIPSIS {$$ = {$1, true};}
+	: parameter_list {$$ = {std::move($1), false};}
+	| parameter_list ',' ELLIPSIS {$$ = {std::move($1), true};}
 	;
 
 parameter_list
-	: parameter_declaration {$$ = {$1};}
-	| parameter_list ',' parameter_declaration {$$ = $1; $$.emplace_back($3);}
+	: parameter_declaration {$$ = Ast::ParameterList(); $$.emplace_back(std::move($1));}
+	| parameter_list ',' parameter_declaration {$$ = std::move($1); $$.emplace_back(std::move($3));}
 	;
 
 parameter_declaration
-	: declaration_specifier_list declarator {$$ = {$1, Ast::NestedDeclarator(new Ast::Declarator($2))};}
-	| declaration_specifier_list abstract_declarator {$$ = {$1, Ast::NestedDeclarator(new Ast::Declarator($2))};}
-	| declaration_specifier_list {$$ = {$1, {}};}
+	: declaration_specifier_list declarator {$$ = {std::move($1), astArena.make<Ast::Declarator>(std::move($2))};}
+	| declaration_specifier_list abstract_declarator {$$ = {std::move($1), astArena.make<Ast::Declarator>(std::move($2))};}
+	| declaration_specifier_list {$$ = {std::move($1), {}};}
 	;
 
 identifier_list
 	: IDENTIFIER {$$ = {$1};}
-	| identifier_list ',' IDENTIFIER {$$ = $1; $$.emplace_back($3);}
+	| identifier_list ',' IDENTIFIER {$$ = std::move($1); $$.emplace_back($3);}
 	;
 
 type_name
-	: specifier_qualifier_list {$$ = {$1, std::nullopt};}
-	| specifier_qualifier_list abstract_declarator {$$ = {$1, $2};}
+	: specifier_qualifier_list {$$ = {std::move($1), std::nullopt};}
+	| specifier_qualifier_list abstract_declarator {$$ = {std::move($1), std::move($2)};}
 	;
 
 abstract_declarator
-	: pointer {$$ = {$1};}
-	| direct_abstract_declarator {$$ = {{}, $1};}
-	| pointer direct_abstract_declarator {$$ = {$1, $2};}
+	: pointer {$$ = {std::move($1)};}
+	| direct_abstract_declarator {$$ = {{}, std::move($1)};}
+	| pointer direct_abstract_declarator {$$ = {std::move($1), std::move($2)};}
 	;
 
 array_abstract_declarator
 	: '[' ']' {$$ = {nullptr, std::nullopt};}
-	| '[' constant_expression ']' {$$ = {nullptr, $2};}
+	| '[' constant_expression ']' {$$ = {nullptr, std::move($2)};}
 	| direct_abstract_declarator_pointer '[' ']' {$$ = {$1, std::nullopt};}
-	| direct_abstract_declarator_pointer '[' constant_expression ']' {$$ = {$1, $3};}
+	| direct_abstract_declarator_pointer '[' constant_expression ']' {$$ = {$1, std::move($3)};}
 	;
 
 function_abstract_declarator
 	: '(' ')' {$$ = {nullptr};}
-	| '(' parameter_type_list ')' {$$ = {nullptr, $2};}
+	| '(' parameter_type_list ')' {$$ = {nullptr, std::move($2)};}
 	| direct_abstract_declarator_pointer '(' ')' {$$ = {$1, {}};}
-	| direct_abstract_declarator_pointer '(' parameter_type_list ')' {$$ = {$1, $3};}
+	| direct_abstract_declarator_pointer '(' parameter_type_list ')' {$$ = {$1, std::move($3)};}
 	;
 
 nested_abstract_declarator
-	: '(' abstract_declarator ')' {$$ = Ast::NestedDeclarator(new Ast::Declarator($2));}
+	: '(' abstract_declarator ')' {$$ = astArena.make<Ast::Declarator>(std::move($2));}
 	;
 
 direct_abstract_declarator
-	: function_abstract_declarator {$$ = $1;}
-	| array_abstract_declarator {$$ = $1;}
-	| nested_abstract_declarator {$$ = $1;}
+	: function_abstract_declarator {$$ = std::move($1);}
+	| array_abstract_declarator {$$ = std::move($1);}
+	| nested_abstract_declarator {$$ = std::move($1);}
 	;
 
 direct_abstract_declarator_pointer
-	: direct_abstract_declarator {$$ = Ast::DirectDeclaratorPointer(new Ast::DirectDeclarator($1));}
+	: direct_abstract_declarator {$$ = astArena.make<Ast::DirectDeclarator>(std::move($1));}
 	;
 
 initializer
-	: assignment_expression {$$ = {$1};}
-	| '{' initializer_list '}' {$$ = {$2};}
-	| '{' initializer_list ',' '}' {$$ = {$2};}
+	: assignment_expression {$$ = {std::move($1)};}
+	| '{' initializer_list '}' {$$ = {std::move($2)};}
+	| '{' initializer_list ',' '}' {$$ = {std::move($2)};}
 	;
 
 initializer_list
-	: initializer {$$ = {$1};}
-	| initializer_list ',' initializer {$$ = $1; $$.emplace_back($3);}
+	: initializer {$$ = Ast::InitializerList(); $$.emplace_back(std::move($1));}
+	| initializer_list ',' initializer {$$ = std::move($1); $$.emplace_back(std::move($3));}
 	;
 
 statement
-	: labeled_statement {$$ = {$1};}
-	| enter_block compound_statement exit_block {$2.scope = $1;$$ = {$2};}
-	| expression_statement {$$ = {$1};}
-	| selection_statement {$$ = {$1};}
-	| iteration_statement {$$ = {$1};}
-	| jump_statement {$$ = {$1};}
+	: labeled_statement {$$ = {std::move($1)};}
+	| enter_block compound_statement exit_block {$2.scope = $1;$$ = {std::move($2)};}
+	| expression_statement {$$ = {std::move($1)};}
+	| selection_statement {$$ = {std::move($1)};}
+	| iteration_statement {$$ = {std::move($1)};}
+	| jump_statement {$$ = {std::move($1)};}
 	;
 
 statement_ptr
-	: statement {$$ = Ast::StatementPtr(new Ast::Statement($1));}
+	: statement {$$ = astArena.make<Ast::Statement>(std::move($1));}
 	;
 
 labeled_statement
 	: IDENTIFIER ':' statement_ptr {$$ = {$1, $3};}
-	| CASE constant_expression ':' statement_ptr {$$ = {$2, $4};}
+	| CASE constant_expression ':' statement_ptr {$$ = {std::move($2), $4};}
 	| DEFAULT ':' statement_ptr {$$ = {{}, $3};}
 	;
 
 compound_statement
 	: '{'  '}' {$$ = {-1, std::nullopt, std::nullopt};}
-	| '{'  statement_list '}' {$$ = {-1, std::nullopt, $2};}
-	| '{'  declaration_list_declared '}' {$$ = {-1, $2, std::nullopt};}
-	| '{'  declaration_list_declared statement_list '}' {$$ = {-1, $2, $3};}
+	| '{'  statement_list '}' {$$ = {-1, std::nullopt, std::move($2)};}
+	| '{'  declaration_list_declared '}' {$$ = {-1, std::move($2), std::nullopt};}
+	| '{'  declaration_list_declared statement_list '}' {$$ = {-1, std::move($2), std::move($3)};}
 	;
 
 enter_block: {$$ = symbolTable.enter_block();} ;
 exit_block: {symbolTable.exit_block();} ;
 
 declaration_list
-	: declaration {$$ = {$1};}
-	| declaration_list declaration {($$ = $1).emplace_back($2);}
+	: declaration {$$ = Ast::DeclarationList(); $$.emplace_back(std::move($1));}
+	| declaration_list declaration {($$ = std::move($1)).emplace_back(std::move($2));}
 	;
 
 declaration_list_declared
-	: declaration {$$ = {$1};/*Ast::Declare($$.back());*/}
-	| declaration_list_declared declaration {($$ = $1).emplace_back($2);/*Ast::Declare($$.back());*/}
+	: declaration {$$ = Ast::DeclarationList(); $$.emplace_back(std::move($1));/*Ast::Declare($$.back());*/}
+	| declaration_list_declared declaration {($$ = std::move($1)).emplace_back(std::move($2));/*Ast::Declare($$.back());*/}
 	;
 
 statement_list
-	: statement {$$ = {$1};}
-	| statement_list statement {($$ = $1).emplace_back($2);}
+	: statement {$$ = Ast::StatementList(); $$.emplace_back(std::move($1));}
+	| statement_list statement {($$ = std::move($1)).emplace_back(std::move($2));}
 	;
 
 expression_statement
 	: ';'  {$$ = {std::nullopt};}
-	| expression ';' {$$ = {$1};Expression::EmitTac($1);}
+	| expression ';' {Expression::EmitTac($1);$$ = {std::move($1)};}
 	;
 
 else
@@ -611,8 +610,8 @@ selection_statement
 	}
 	statement_ptr
 	else
-	{$$ = {Ast::SelectionStatement::IF, $3, $6, $7};}
-	| SWITCH '(' expression ')' statement_ptr {$$ = {Ast::SelectionStatement::SWITCH, $3, $5};}
+	{$$ = {Ast::SelectionStatement::IF, std::move($3), $6, $7};}
+	| SWITCH '(' expression ')' statement_ptr {$$ = {Ast::SelectionStatement::SWITCH, std::move($3), $5};}
 	;
 
 iteration_statement
@@ -632,17 +631,17 @@ iteration_statement
 		//std::cout << int($<TAC::Label>6) << std::endl;
 		TAC::currentFunction->set_label($<TAC::Label>6);
 	}
-	{$$ = {Ast::IterationStatement::WHILE, $4, $7};}
+	{$$ = {Ast::IterationStatement::WHILE, std::move($4), $7};}
 
 	| DO {$<TAC::Label>$ = TAC::currentFunction->new_label(true);} statement_ptr WHILE '(' expression ')' ';'
 	{
 		Expression::EmitTac($6);
 	//std::cout << "[label " << int($<TAC::Label>2) << "]" << std::endl;
-		$$ = {Ast::IterationStatement::DO_WHILE, $6, $3};
 		TAC::currentFunction->add_instruction({$<TAC::Label>2, TAC::JUMP_NOT_EQUAL, $6.ret_address, symbolTable.new_constant(0)});
+		$$ = {Ast::IterationStatement::DO_WHILE, std::move($6), $3};
 	}
-	| FOR '(' expression_statement expression_statement ')' statement_ptr {$$ = {Ast::IterationStatement::FOR, $4.expression, $6, $3.expression};}
-	| FOR '(' expression_statement expression_statement expression ')' statement_ptr {$$ = {Ast::IterationStatement::FOR, $4.expression, $7, $3.expression, $5};}
+	| FOR '(' expression_statement expression_statement ')' statement_ptr {$$ = {Ast::IterationStatement::FOR, std::move($4.expression), $6, std::move($3.expression)};}
+	| FOR '(' expression_statement expression_statement expression ')' statement_ptr {$$ = {Ast::IterationStatement::FOR, std::move($4.expression), $7, std::move($3.expression), std::move($5)};}
 	;
 
 jump_statement
@@ -652,29 +651,30 @@ jump_statement
 	| RETURN ';' {$$ = {Ast::JumpStatement::RETURN};TAC::currentFunction->add_instruction({{}, TAC::RETURN});}
 	| RETURN expression ';' {
 		Expression::EmitTac($2);
-		$$ = {Ast::JumpStatement::RETURN, $2};TAC::currentFunction->add_instruction({{}, TAC::RETURN, $2.ret_address, {}, symbolTable.size_of($2.type.value()), Types::is_signed($2.type.value())});
+		TAC::currentFunction->add_instruction({{}, TAC::RETURN, $2.ret_address, {}, symbolTable.size_of($2.type.value()), Types::is_signed($2.type.value())});
+		$$ = {Ast::JumpStatement::RETURN, std::move($2)};
 	}
 	;
 
 translation_unit
-	: external_declaration {tree = {$1};}
-	| translation_unit external_declaration {tree.emplace_back($2);}
+	: external_declaration {tree.emplace_back(std::move($1));}
+	| translation_unit external_declaration {tree.emplace_back(std::move($2));}
 	;
 
 external_declaration
-	: function_definition {$$ = $1;}
-	| declaration {$$ = $1;/*Ast::Declare($1);*/}
+	: function_definition {$$ = std::move($1);}
+	| declaration {$$ = std::move($1);/*Ast::Declare($1);*/}
 	;
 
 function_declaration_specifier_list
-	: declaration_specifier_list {symbolTable.enter_block();symbolTable.enter_prototype(); $$ = $1;}
+	: declaration_specifier_list {symbolTable.enter_block();symbolTable.enter_prototype(); $$ = std::move($1);}
 	|  {symbolTable.enter_block();symbolTable.enter_prototype(); $$ = std::nullopt;}
 	;
 
 function_definition_declaration
 	: declarator
 	{
-		$$ = {std::nullopt, $1};
+		$$ = {std::nullopt, std::move($1)};
 		symbolTable.enter_block();
 		symbolTable.enter_prototype();
 		Ast::DeclareFunction($$);
@@ -685,7 +685,7 @@ function_definition_declaration
 	}
 	| declarator declaration_list
 	{
-		$$ = {std::nullopt, $1};
+		$$ = {std::nullopt, std::move($1)};
 		symbolTable.enter_block();
 		symbolTable.enter_prototype();
 		Ast::Declare($2);
@@ -697,7 +697,7 @@ function_definition_declaration
 	}
 	| declaration_specifier_list declarator
 	{
-		$$ = {$1, $2};
+		$$ = {std::move($1), std::move($2)};
 		symbolTable.enter_block();
 		symbolTable.enter_prototype();
 		Ast::DeclareFunction($$);
@@ -708,7 +708,7 @@ function_definition_declaration
 	}
 	| declaration_specifier_list declarator declaration_list
 	{
-		$$ = {$1, $2};
+		$$ = {std::move($1), std::move($2)};
 		symbolTable.enter_block();
 		symbolTable.enter_prototype();
 		Ast::Declare($3);
@@ -721,7 +721,7 @@ function_definition_declaration
 	;
 
 function_definition
-	: function_definition_declaration compound_statement {$$ = {$1, std::nullopt, $2};symbolTable.exit_function();symbolTable.exit_block();}
+	: function_definition_declaration compound_statement {$$ = {std::move($1), std::nullopt, std::move($2)};symbolTable.exit_function();symbolTable.exit_block();}
 	;
 
 enter_function: {$$ = symbolTable.enter_block();symbolTable.enter_prototype();};
@@ -733,7 +733,6 @@ enter_function: {$$ = symbolTable.enter_block();symbolTable.enter_prototype();};
 #include "Diagnostic.hpp"
 
 extern char yytext[];
-Ast::DeclarationSpecifierList current_declaration_specifier_list;
 
 int yyerror(char *s)
 {